@@ -0,0 +1,335 @@
+//=======================================================================
+// Author: Donovan Parks
+//
+// Copyright 2011 Donovan Parks
+//
+// This file is part of ExpressBetaDiversity.
+//
+// ExpressBetaDiversity is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// ExpressBetaDiversity is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ExpressBetaDiversity. If not, see
+// <http://www.gnu.org/licenses/>.
+//=======================================================================
+
+#include "Precompiled.hpp"
+
+#include "BinarySampleTable.hpp"
+#include "CompressedStream.hpp"
+
+const char BINARY_MAGIC[8] = { 'N', 'D', 'C', 'O', 'U', 'N', 'T', 'S' };
+const uint BINARY_BYTE_ORDER = 0x01020304;
+const uint BINARY_VERSION = 1;
+
+namespace
+{
+	uint64 Align8(uint64 offset)
+	{
+		return (offset + 7) & ~(uint64)7;
+	}
+
+	void Pad8(std::ofstream& out)
+	{
+		static const char zeros[8] = { 0 };
+		uint64 pos = out.tellp();
+		out.write(zeros, Align8(pos) - pos);
+	}
+
+	void WriteNames(std::ofstream& out, const std::vector<std::string>& names)
+	{
+		for(uint i = 0; i < names.size(); ++i)
+		{
+			uint len = names[i].size();
+			out.write((const char*)&len, sizeof(len));
+			out.write(names[i].c_str(), len);
+		}
+
+		Pad8(out);
+	}
+}
+
+BinarySampleTable::BinarySampleTable(): m_indexOffset(0)
+{
+
+}
+
+bool BinarySampleTable::IsBinary(const std::string& filename)
+{
+	CompressedStream in(filename);
+	char magic[sizeof(BINARY_MAGIC)];
+	if(!in.read(magic, sizeof(magic)))
+		return false;
+
+	return memcmp(magic, BINARY_MAGIC, sizeof(magic)) == 0;
+}
+
+bool BinarySampleTable::Write(const SampleTable& table, const std::string& filename)
+{
+	std::vector<std::string> sampleNames;
+	for(uint i = 0; i < table.GetNumSamples(); ++i)
+		sampleNames.push_back(table.GetSampleName(i));
+
+	BinarySampleWriter writer;
+	if(!writer.Open(filename, table.GetTaxa(), sampleNames))
+		return false;
+
+	// sparse run of non-zero counts for each sample
+	std::vector<double> count;
+	std::vector<uint> runIds;
+	std::vector<double> runCounts;
+	bool bReadError = false;
+	table.SetAccessPattern(MappedFile::SEQUENTIAL_ACCESS);
+	for(uint i = 0; i < table.GetNumSamples(); ++i)
+	{
+		if(!table.GetCounts(i, count))
+		{
+			bReadError = true;
+			break;
+		}
+
+		runIds.clear();
+		runCounts.clear();
+		double total = 0;
+		for(uint taxonId = 0; taxonId < count.size(); ++taxonId)
+		{
+			if(count[taxonId] != 0)
+			{
+				runIds.push_back(taxonId);
+				runCounts.push_back(count[taxonId]);
+				total += count[taxonId];
+			}
+		}
+
+		writer.AddSample(runIds, runCounts, total);
+	}
+	table.SetAccessPattern(MappedFile::NORMAL_ACCESS);
+
+	// header is only written on close, so an incomplete file is never mistaken for a binary sample file
+	if(bReadError)
+	{
+		std::cerr << "Failed to convert sample file to binary: " << filename << std::endl;
+		return false;
+	}
+
+	return writer.Close();
+}
+
+bool BinarySampleTable::Open(const std::string& filename)
+{
+	// samples are read in place from the mapped file, which is not possible for a compressed file
+	if(DecompressBuf::GetCompression(filename) != DecompressBuf::NO_COMPRESSION)
+	{
+		std::cerr << "Compressed binary sample files are not supported, please decompress: " << filename << std::endl;
+		return false;
+	}
+
+	if(!m_file.Open(filename))
+	{
+		std::cerr << "Unable to open sample file: " << filename << std::endl;
+		return false;
+	}
+
+	BinaryHeader header;
+	if(m_file.GetSize() < sizeof(header))
+	{
+		std::cerr << "Invalid binary sample file: " << filename << std::endl;
+		return false;
+	}
+	memcpy(&header, m_file.GetData(), sizeof(header));
+
+	if(memcmp(header.magic, BINARY_MAGIC, sizeof(BINARY_MAGIC)) != 0 || header.byteOrder != BINARY_BYTE_ORDER)
+	{
+		std::cerr << "Invalid binary sample file (or created on a machine with a different byte order): " << filename << std::endl;
+		return false;
+	}
+
+	if(header.version != BINARY_VERSION)
+	{
+		std::cerr << "Unsupported version of binary sample file: " << filename << std::endl;
+		return false;
+	}
+
+	if(header.indexOffset % 8 != 0 || header.indexOffset > m_file.GetSize() 
+				|| header.numSamples > (m_file.GetSize() - header.indexOffset) / sizeof(BinaryIndexEntry))
+	{
+		std::cerr << "Binary sample file is truncated: " << filename << std::endl;
+		return false;
+	}
+
+	if(!ReadNames(header.taxaOffset, header.numTaxa, m_taxa) || !ReadNames(header.samplesOffset, header.numSamples, m_sampleNames))
+	{
+		std::cerr << "Binary sample file is truncated: " << filename << std::endl;
+		return false;
+	}
+
+	m_indexOffset = header.indexOffset;
+
+	// check each count run is within the file so counts can be read without further checks
+	for(uint i = 0; i < m_sampleNames.size(); ++i)
+	{
+		const BinaryIndexEntry& entry = ((const BinaryIndexEntry*)(m_file.GetData() + m_indexOffset))[i];
+		uint64 runSize = Align8(entry.numCounts*sizeof(uint)) + entry.numCounts*sizeof(double);
+		if(entry.runOffset % 8 != 0 || entry.runOffset > m_indexOffset || entry.numCounts > header.numTaxa || runSize > m_indexOffset - entry.runOffset)
+		{
+			std::cerr << "Invalid binary sample file: " << filename << std::endl;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool BinarySampleTable::ReadNames(uint64 offset, uint64 num, std::vector<std::string>& names) const
+{
+	names.clear();
+	names.reserve(num);
+
+	for(uint64 i = 0; i < num; ++i)
+	{
+		uint len;
+		if(offset + sizeof(len) > m_file.GetSize())
+			return false;
+		memcpy(&len, m_file.GetData() + offset, sizeof(len));
+		offset += sizeof(len);
+
+		if(offset + len > m_file.GetSize())
+			return false;
+		names.push_back(std::string(m_file.GetData() + offset, len));
+		offset += len;
+	}
+
+	return true;
+}
+
+bool BinarySampleTable::GetCounts(uint index, std::vector<double>& count) const
+{
+	// counts are read in place from the mapped file
+	const BinaryIndexEntry& entry = ((const BinaryIndexEntry*)(m_file.GetData() + m_indexOffset))[index];
+	const uint* taxonIds = (const uint*)(m_file.GetData() + entry.runOffset);
+	const double* counts = (const double*)(m_file.GetData() + entry.runOffset + Align8(entry.numCounts*sizeof(uint)));
+
+	count.assign(m_taxa.size(), 0);
+	for(uint64 i = 0; i < entry.numCounts; ++i)
+	{
+		if(taxonIds[i] < count.size())
+			count[taxonIds[i]] = counts[i];
+	}
+
+	return true;
+}
+
+bool BinarySampleTable::GetCounts(uint index, const std::vector<uint>& columnToIndex, const std::vector<uint64>& keptColumns, std::vector<double>& count) const
+{
+	const BinaryIndexEntry& entry = ((const BinaryIndexEntry*)(m_file.GetData() + m_indexOffset))[index];
+	const uint* taxonIds = (const uint*)(m_file.GetData() + entry.runOffset);
+	const double* counts = (const double*)(m_file.GetData() + entry.runOffset + Align8(entry.numCounts*sizeof(uint)));
+
+	for(uint64 i = 0; i < entry.numCounts; ++i)
+	{
+		uint taxonId = taxonIds[i];
+		if(taxonId < columnToIndex.size() && ((keptColumns[taxonId / 64] >> (taxonId % 64)) & 1))
+			count[columnToIndex[taxonId]] = counts[i];
+	}
+
+	return true;
+}
+
+void BinarySampleTable::Prefetch(uint firstIndex, uint numSamples) const
+{
+	if(numSamples == 0 || firstIndex >= GetNumSamples())
+		return;
+
+	const BinaryIndexEntry* index = (const BinaryIndexEntry*)(m_file.GetData() + m_indexOffset);
+	uint lastIndex = std::min<uint>(firstIndex + numSamples, GetNumSamples()) - 1;
+	uint64 end = index[lastIndex].runOffset + Align8(index[lastIndex].numCounts*sizeof(uint)) + index[lastIndex].numCounts*sizeof(double);
+
+	m_file.Prefetch(index[firstIndex].runOffset, end - index[firstIndex].runOffset);
+}
+
+BinarySampleWriter::BinarySampleWriter()
+{
+	memset(&m_header, 0, sizeof(m_header));
+}
+
+bool BinarySampleWriter::Open(const std::string& filename, const std::vector<std::string>& taxa, const std::vector<std::string>& sampleNames)
+{
+	m_filename = filename;
+	m_out.open(filename.c_str(), std::ios::binary);
+	if(!m_out.is_open())
+	{
+		std::cerr << "Unable to open binary sample file: " << filename << std::endl;
+		return false;
+	}
+
+	memset(&m_header, 0, sizeof(m_header));
+	memcpy(m_header.magic, BINARY_MAGIC, sizeof(BINARY_MAGIC));
+	m_header.byteOrder = BINARY_BYTE_ORDER;
+	m_header.version = BINARY_VERSION;
+	m_header.numTaxa = taxa.size();
+	m_header.numSamples = sampleNames.size();
+
+	// header is rewritten once the offset of each section is known
+	m_out.write((const char*)&m_header, sizeof(m_header));
+
+	m_header.taxaOffset = m_out.tellp();
+	WriteNames(m_out, taxa);
+
+	m_header.samplesOffset = m_out.tellp();
+	WriteNames(m_out, sampleNames);
+
+	m_header.runsOffset = m_out.tellp();
+	m_index.clear();
+	m_index.reserve(sampleNames.size());
+
+	return true;
+}
+
+void BinarySampleWriter::AddSample(const std::vector<uint>& taxonIds, const std::vector<double>& counts, double total)
+{
+	BinaryIndexEntry entry;
+	entry.runOffset = m_out.tellp();
+	entry.numCounts = taxonIds.size();
+	entry.total = total;
+	m_index.push_back(entry);
+
+	if(!taxonIds.empty())
+	{
+		m_out.write((const char*)&taxonIds[0], taxonIds.size()*sizeof(uint));
+		Pad8(m_out);
+		m_out.write((const char*)&counts[0], counts.size()*sizeof(double));
+	}
+}
+
+bool BinarySampleWriter::Close()
+{
+	if(m_index.size() != m_header.numSamples)
+	{
+		std::cerr << "(Bug) Binary sample file has " << m_index.size() << " of " << m_header.numSamples << " samples. Please report this bug." << std::endl;
+		m_out.close();
+		return false;
+	}
+
+	m_header.indexOffset = m_out.tellp();
+	if(!m_index.empty())
+		m_out.write((const char*)&m_index[0], m_index.size()*sizeof(BinaryIndexEntry));
+
+	m_out.seekp(0);
+	m_out.write((const char*)&m_header, sizeof(m_header));
+	m_out.close();
+
+	if(m_out.fail())
+	{
+		std::cerr << "Failed to write binary sample file: " << m_filename << std::endl;
+		return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,156 @@
+//=======================================================================
+// Author: Donovan Parks
+//
+// Copyright 2011 Donovan Parks
+//
+// This file is part of ExpressBetaDiversity.
+//
+// ExpressBetaDiversity is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// ExpressBetaDiversity is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ExpressBetaDiversity. If not, see
+// <http://www.gnu.org/licenses/>.
+//=======================================================================
+
+#ifndef _BINARY_SAMPLE_TABLE_
+#define _BINARY_SAMPLE_TABLE_
+
+#include "Precompiled.hpp"
+
+#include "SampleTable.hpp"
+#include "MappedFile.hpp"
+
+/** Header of a binary sample table. */
+struct BinaryHeader
+{
+	char magic[8];
+	uint byteOrder;
+	uint version;
+	uint64 numTaxa;
+	uint64 numSamples;
+	uint64 taxaOffset;
+	uint64 samplesOffset;
+	uint64 runsOffset;
+	uint64 indexOffset;
+};
+
+/** Entry of sample index in a binary sample table. */
+struct BinaryIndexEntry
+{
+	uint64 runOffset;
+	uint64 numCounts;
+	double total;
+};
+
+/**
+ * @brief Compact binary sample table which is memory mapped and read without parsing.
+ *
+ * Layout (native byte order, all sections aligned to 8 bytes):
+ *   header:       magic ('NDCOUNTS'), byte order mark, version, number of taxa and samples,
+ *                 and offsets to the remaining sections
+ *   taxa names:   for each taxon, uint32 length followed by the name
+ *   sample names: for each sample, uint32 length followed by the name
+ *   count runs:   for each sample, the uint32 ids of taxa with a non-zero count followed
+ *                 by the double precision count of each of these taxa
+ *   sample index: for each sample, uint64 offset to its count run, uint64 number of 
+ *                 non-zero counts, and double precision total count
+ */
+class BinarySampleTable : public SampleTable
+{
+public:
+	/** Constructor. */
+	BinarySampleTable();
+
+	/** Destructor. */
+	~BinarySampleTable() {}
+
+	/** Check if a file is a binary sample table. */
+	static bool IsBinary(const std::string& filename);
+
+	/**
+	* @brief Write a sample table in binary format.
+	*
+	* @param table Sample table to write.
+	* @param filename File to write binary sample table to.
+	* @return True if table was written successfully, else false.
+	*/
+	static bool Write(const SampleTable& table, const std::string& filename);
+
+	bool Open(const std::string& filename);
+
+	const std::vector<std::string>& GetTaxa() const { return m_taxa; }
+
+	uint GetNumSamples() const { return m_sampleNames.size(); }
+
+	const std::string& GetSampleName(uint index) const { return m_sampleNames[index]; }
+
+	bool GetCounts(uint index, std::vector<double>& count) const;
+
+	bool GetCounts(uint index, const std::vector<uint>& columnToIndex, const std::vector<uint64>& keptColumns, std::vector<double>& count) const;
+
+	void SetAccessPattern(MappedFile::ACCESS_PATTERN accessPattern) const { m_file.Advise(accessPattern); }
+
+	void Prefetch(uint firstIndex, uint numSamples) const;
+
+private:
+	/** Read names from name table, checking the table is within the file. */
+	bool ReadNames(uint64 offset, uint64 num, std::vector<std::string>& names) const;
+
+private:
+	/** Binary sample table mapped into memory. */
+	MappedFile m_file;
+
+	/** Name of taxa. */
+	std::vector<std::string> m_taxa;
+
+	/** Name of samples. */
+	std::vector<std::string> m_sampleNames;
+
+	/** Offset to sample index. */
+	uint64 m_indexOffset;
+};
+
+/**
+ * @brief Write a binary sample table one sample at a time.
+ */
+class BinarySampleWriter
+{
+public:
+	/** Constructor. */
+	BinarySampleWriter();
+
+	/** Destructor. */
+	~BinarySampleWriter() {}
+
+	/** Create binary sample table with the given taxa and samples. */
+	bool Open(const std::string& filename, const std::vector<std::string>& taxa, const std::vector<std::string>& sampleNames);
+
+	/** Add non-zero counts, in order of taxon id, of the next sample. */
+	void AddSample(const std::vector<uint>& taxonIds, const std::vector<double>& counts, double total);
+
+	/** Write sample index and header. All samples must have been added. */
+	bool Close();
+
+private:
+	/** Path to binary sample table. */
+	std::string m_filename;
+
+	/** Stream to binary sample table. */
+	std::ofstream m_out;
+
+	/** Header, completed once all samples are written. */
+	BinaryHeader m_header;
+
+	/** Location of the counts of each sample written so far. */
+	std::vector<BinaryIndexEntry> m_index;
+};
+
+#endif
@@ -0,0 +1,401 @@
+//=======================================================================
+// Author: Donovan Parks
+//
+// Copyright 2011 Donovan Parks
+//
+// This file is part of ExpressBetaDiversity.
+//
+// ExpressBetaDiversity is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// ExpressBetaDiversity is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ExpressBetaDiversity. If not, see
+// <http://www.gnu.org/licenses/>.
+//=======================================================================
+
+#include "Precompiled.hpp"
+
+#include "BiomSampleTable.hpp"
+#include "CompressedStream.hpp"
+#include "Utils.hpp"
+
+// first bytes of an HDF5 file (used by BIOM 2.x)
+const char HDF5_MAGIC[8] = { '\x89', 'H', 'D', 'F', '\r', '\n', '\x1a', '\n' };
+
+namespace
+{
+	/** Minimal pull parser for JSON read from a stream. */
+	class JsonStream
+	{
+	public:
+		JsonStream(std::streambuf* buf): m_buf(buf), m_bGood(true) {}
+
+		bool IsGood() const { return m_bGood; }
+
+		/** Get next non-whitespace character without consuming it. */
+		int Peek()
+		{
+			int c = m_buf->sgetc();
+			while(c == ' ' || c == '\t' || c == '\n' || c == '\r')
+			{
+				m_buf->sbumpc();
+				c = m_buf->sgetc();
+			}
+
+			return c;
+		}
+
+		/** Consume the given character, which must be next. */
+		bool Expect(char expected)
+		{
+			if(Peek() != expected)
+				return Fail();
+
+			m_buf->sbumpc();
+			return true;
+		}
+
+		/** Consume the given character if it is next. */
+		bool Accept(char c)
+		{
+			if(Peek() != c)
+				return false;
+
+			m_buf->sbumpc();
+			return true;
+		}
+
+		bool ReadString(std::string& str)
+		{
+			str.clear();
+			if(!Expect('"'))
+				return false;
+
+			int c;
+			while((c = m_buf->sbumpc()) != '"')
+			{
+				if(c == EOF)
+					return Fail();
+
+				if(c == '\\')
+				{
+					c = m_buf->sbumpc();
+					switch(c)
+					{
+						case 'b': str += '\b'; break;
+						case 'f': str += '\f'; break;
+						case 'n': str += '\n'; break;
+						case 'r': str += '\r'; break;
+						case 't': str += '\t'; break;
+						case 'u': 
+							if(!ReadCodePoint(str))
+								return false;
+							break;
+						case EOF: return Fail();
+						default: str += (char)c;
+					}
+				}
+				else
+					str += (char)c;
+			}
+
+			return true;
+		}
+
+		bool ReadNumber(double& value)
+		{
+			char buffer[64];
+			uint len = 0;
+			int c = Peek();
+			while(len < sizeof(buffer)-1 && (valid_digit(c) || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E'))
+			{
+				buffer[len++] = (char)m_buf->sbumpc();
+				c = m_buf->sgetc();
+			}
+			buffer[len] = 0;
+
+			char* end;
+			value = strtod(buffer, &end);
+			if(len == 0 || end != buffer + len)
+				return Fail();
+
+			return true;
+		}
+
+		/** Skip over next value of any type. */
+		bool SkipValue()
+		{
+			int c = Peek();
+			if(c == '"')
+			{
+				std::string str;
+				return ReadString(str);
+			}
+			else if(c == '{' || c == '[')
+			{
+				char close = (c == '{') ? '}' : ']';
+				m_buf->sbumpc();
+				if(Accept(close))
+					return true;
+
+				do
+				{
+					if(c == '{')
+					{
+						std::string key;
+						if(!ReadString(key) || !Expect(':'))
+							return false;
+					}
+
+					if(!SkipValue())
+						return false;
+				} while(Accept(','));
+
+				return Expect(close);
+			}
+			else if(c == 't' || c == 'f' || c == 'n')
+			{
+				// true, false, or null
+				while(isalpha(m_buf->sgetc()))
+					m_buf->sbumpc();
+				return true;
+			}
+
+			double value;
+			return ReadNumber(value);
+		}
+
+	private:
+		bool Fail()
+		{
+			m_bGood = false;
+			return false;
+		}
+
+		/** Read 4 hex digits of a \u escape and append the code point as UTF-8. */
+		bool ReadCodePoint(std::string& str)
+		{
+			uint codePoint = 0;
+			for(uint i = 0; i < 4; ++i)
+			{
+				int c = m_buf->sbumpc();
+				if(!isxdigit(c))
+					return Fail();
+
+				codePoint = codePoint*16 + (isdigit(c) ? c - '0' : (tolower(c) - 'a' + 10));
+			}
+
+			if(codePoint < 0x80)
+				str += (char)codePoint;
+			else if(codePoint < 0x800)
+			{
+				str += (char)(0xC0 | (codePoint >> 6));
+				str += (char)(0x80 | (codePoint & 0x3F));
+			}
+			else
+			{
+				str += (char)(0xE0 | (codePoint >> 12));
+				str += (char)(0x80 | ((codePoint >> 6) & 0x3F));
+				str += (char)(0x80 | (codePoint & 0x3F));
+			}
+
+			return true;
+		}
+
+	private:
+		std::streambuf* m_buf;
+		bool m_bGood;
+	};
+
+	/** Read ids from an array of objects (e.g., BIOM rows or columns). */
+	bool ReadIds(JsonStream& json, std::vector<std::string>& ids)
+	{
+		ids.clear();
+		if(!json.Expect('['))
+			return false;
+
+		if(json.Accept(']'))
+			return true;
+
+		do
+		{
+			if(!json.Expect('{'))
+				return false;
+
+			std::string id;
+			if(!json.Accept('}'))
+			{
+				do
+				{
+					std::string key;
+					if(!json.ReadString(key) || !json.Expect(':'))
+						return false;
+
+					if(key == "id")
+					{
+						if(!json.ReadString(id))
+							return false;
+					}
+					else if(!json.SkipValue())
+						return false;
+				} while(json.Accept(','));
+
+				if(!json.Expect('}'))
+					return false;
+			}
+
+			ids.push_back(id);
+		} while(json.Accept(','));
+
+		return json.Expect(']');
+	}
+}
+
+bool BiomSampleTable::IsBiom(const std::string& filename)
+{
+	CompressedStream in(filename);
+	char magic[sizeof(HDF5_MAGIC)];
+	if(in.read(magic, sizeof(magic)) && memcmp(magic, HDF5_MAGIC, sizeof(magic)) == 0)
+		return true;
+
+	// JSON object
+	in.clear();
+	in.seekg(0);
+	char c;
+	while(in.get(c) && isspace((unsigned char)c));
+
+	return in && c == '{';
+}
+
+bool BiomSampleTable::Open(const std::string& filename)
+{
+	CompressedStream in(filename);
+	if(!in.is_open())
+	{
+		std::cerr << "Unable to open BIOM file: " << filename << std::endl;
+		return false;
+	}
+
+	char magic[sizeof(HDF5_MAGIC)];
+	if(in.read(magic, sizeof(magic)) && memcmp(magic, HDF5_MAGIC, sizeof(magic)) == 0)
+	{
+		std::cerr << "BIOM 2.x (HDF5) files are not supported. Convert to BIOM 1.0 with: biom convert --to-json" << std::endl;
+		return false;
+	}
+	in.clear();
+	in.seekg(0);
+
+	return Read(in, filename);
+}
+
+bool BiomSampleTable::Read(std::istream& in, const std::string& filename)
+{
+	// taxa are rows and samples are columns
+	JsonStream json(in.rdbuf());
+	std::string matrixType;
+	bool bData = false;
+	bool bDenseData = false;
+	if(json.Expect('{') && !json.Accept('}'))
+	{
+		do
+		{
+			std::string key;
+			if(!json.ReadString(key) || !json.Expect(':'))
+				break;
+
+			if(key == "rows")
+				ReadIds(json, m_taxa);
+			else if(key == "columns")
+				ReadIds(json, m_sampleNames);
+			else if(key == "matrix_type")
+				json.ReadString(matrixType);
+			else if(key == "data")
+			{
+				bData = true;
+				bDenseData = (matrixType == "dense");
+				if(!json.Expect('[') || json.Accept(']'))
+					continue;
+
+				uint row = 0;
+				do
+				{
+					if(!json.Expect('['))
+						break;
+
+					double value[3];
+					if(bDenseData)
+					{
+						// dense: one array of counts per row
+						uint col = 0;
+						if(!json.Accept(']'))
+						{
+							do
+							{
+								if(!json.ReadNumber(value[0]))
+									break;
+								AddCount(col++, row, value[0]);
+							} while(json.Accept(','));
+							json.Expect(']');
+						}
+						row++;
+					}
+					else
+					{
+						// sparse: [row, column, count]
+						if(json.ReadNumber(value[0]) && json.Expect(',') && json.ReadNumber(value[1]) && json.Expect(',') && json.ReadNumber(value[2]) && json.Expect(']'))
+						{
+							if(value[0] < 0 || value[1] < 0)
+							{
+								std::cerr << "Negative row or column index in BIOM file: " << filename << std::endl;
+								return false;
+							}
+							AddCount((uint)value[1], (uint)value[0], value[2]);
+						}
+					}
+				} while(json.IsGood() && json.Accept(','));
+
+				json.Expect(']');
+			}
+			else
+				json.SkipValue();
+		} while(json.IsGood() && json.Accept(','));
+
+		json.Expect('}');
+	}
+
+	if(!json.IsGood())
+	{
+		if(bData && !bDenseData)
+			std::cerr << "Invalid JSON in BIOM file (for dense tables, matrix_type must be given before the data): " << filename << std::endl;
+		else
+			std::cerr << "Invalid JSON in BIOM file: " << filename << std::endl;
+		return false;
+	}
+
+	if(matrixType != "sparse" && matrixType != "dense")
+	{
+		std::cerr << "Unknown matrix_type in BIOM file: " << filename << std::endl;
+		return false;
+	}
+
+	if(!bData)
+	{
+		std::cerr << "BIOM file does not contain a data section: " << filename << std::endl;
+		return false;
+	}
+
+	if(bDenseData != (matrixType == "dense"))
+	{
+		std::cerr << "The matrix_type of a dense BIOM file must be given before its data: " << filename << std::endl;
+		return false;
+	}
+
+	return Finalize();
+}
@@ -0,0 +1,56 @@
+//=======================================================================
+// Author: Donovan Parks
+//
+// Copyright 2011 Donovan Parks
+//
+// This file is part of ExpressBetaDiversity.
+//
+// ExpressBetaDiversity is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// ExpressBetaDiversity is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ExpressBetaDiversity. If not, see
+// <http://www.gnu.org/licenses/>.
+//=======================================================================
+
+#ifndef _BIOM_SAMPLE_TABLE_
+#define _BIOM_SAMPLE_TABLE_
+
+#include "Precompiled.hpp"
+
+#include "SparseSampleTable.hpp"
+
+/**
+ * @brief Sample table read from a BIOM 1.0 (JSON) file.
+ *
+ * Rows of the BIOM table are taxa and columns are samples. The file is parsed in a 
+ * single streaming pass, with counts in the data section added directly to the sparse
+ * count store. Both sparse and dense matrix types are supported, although for dense
+ * tables the matrix_type must be given before the data section.
+ */
+class BiomSampleTable : public SparseSampleTable
+{
+public:
+	/** Constructor. */
+	BiomSampleTable() {}
+
+	/** Destructor. */
+	~BiomSampleTable() {}
+
+	/** Check if a file appears to be a BIOM file (JSON or HDF5). */
+	static bool IsBiom(const std::string& filename);
+
+	bool Open(const std::string& filename);
+
+	/** Read BIOM 1.0 (JSON) table from a stream. */
+	bool Read(std::istream& in, const std::string& name);
+};
+
+#endif
@@ -0,0 +1,148 @@
+//=======================================================================
+// Author: Donovan Parks
+//
+// Copyright 2011 Donovan Parks
+//
+// This file is part of ExpressBetaDiversity.
+//
+// ExpressBetaDiversity is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// ExpressBetaDiversity is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ExpressBetaDiversity. If not, see
+// <http://www.gnu.org/licenses/>.
+//=======================================================================
+
+#include "Precompiled.hpp"
+
+#include "BlockCompressor.hpp"
+
+#include <zlib.h>
+
+#ifdef HAVE_ZSTD
+	#include <zstd.h>
+#endif
+
+// zlib window bits for a deflate stream with a gzip wrapper
+const int GZIP_WINDOW_BITS = 15 + 16;
+
+// compression levels favouring speed, as output is typically very large
+const int GZIP_LEVEL = 6;
+const int ZSTD_LEVEL = 3;
+
+const uint BlockCompressor::BLOCK_SIZE;
+
+BlockCompressor::BlockCompressor(COMPRESSION compression): m_compression(compression)
+{
+
+}
+
+bool BlockCompressor::Parse(const std::string& name, COMPRESSION& compression)
+{
+	if(name == "none")
+		compression = NO_COMPRESSION;
+	else if(name == "gzip")
+		compression = GZIP_COMPRESSION;
+	else if(name == "zstd")
+	{
+	#ifdef HAVE_ZSTD
+		compression = ZSTD_COMPRESSION;
+	#else
+		std::cerr << "Unable to write zstd compressed files (built without zstd support)." << std::endl;
+		return false;
+	#endif
+	}
+	else
+	{
+		std::cerr << "Unknown compression: " << name << " (expected none, gzip, or zstd)" << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+bool BlockCompressor::Compress(const char* data, uint64 size, std::vector<char>& out) const
+{
+	if(m_compression == NO_COMPRESSION)
+	{
+		out.assign(data, data + size);
+		return true;
+	}
+
+	uint numBlocks = (size + BLOCK_SIZE - 1) / BLOCK_SIZE;
+	std::vector< std::vector<char> > blocks(numBlocks);
+	bool bError = false;
+
+	#pragma omp parallel for schedule(dynamic)
+	for(int b = 0; b < (int)numBlocks; ++b)
+	{
+		uint64 start = (uint64)b*BLOCK_SIZE;
+		uint blockSize = std::min<uint64>(BLOCK_SIZE, size - start);
+		if(!CompressBlock(data + start, blockSize, blocks[b]))
+		{
+			#pragma omp critical(CompressError)
+			bError = true;
+		}
+	}
+
+	if(bError)
+	{
+		std::cerr << "Failed to compress output." << std::endl;
+		return false;
+	}
+
+	uint64 outSize = 0;
+	for(uint b = 0; b < numBlocks; ++b)
+		outSize += blocks[b].size();
+
+	out.resize(outSize);
+	uint64 pos = 0;
+	for(uint b = 0; b < numBlocks; ++b)
+	{
+		if(!blocks[b].empty())
+			memcpy(&out[0] + pos, &blocks[b][0], blocks[b].size());
+		pos += blocks[b].size();
+	}
+
+	return true;
+}
+
+bool BlockCompressor::CompressBlock(const char* data, uint size, std::vector<char>& out) const
+{
+#ifdef HAVE_ZSTD
+	if(m_compression == ZSTD_COMPRESSION)
+	{
+		out.resize(ZSTD_compressBound(size));
+		size_t ret = ZSTD_compress(&out[0], out.size(), data, size, ZSTD_LEVEL);
+		if(ZSTD_isError(ret))
+			return false;
+
+		out.resize(ret);
+		return true;
+	}
+#endif
+
+	z_stream strm;
+	memset(&strm, 0, sizeof(strm));
+	if(deflateInit2(&strm, GZIP_LEVEL, Z_DEFLATED, GZIP_WINDOW_BITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+		return false;
+
+	out.resize(deflateBound(&strm, size));
+	strm.next_in = (Bytef*)data;
+	strm.avail_in = size;
+	strm.next_out = (Bytef*)&out[0];
+	strm.avail_out = out.size();
+
+	int ret = deflate(&strm, Z_FINISH);
+	out.resize(strm.total_out);
+	deflateEnd(&strm);
+
+	return ret == Z_STREAM_END;
+}
@@ -0,0 +1,83 @@
+//=======================================================================
+// Author: Donovan Parks
+//
+// Copyright 2011 Donovan Parks
+//
+// This file is part of ExpressBetaDiversity.
+//
+// ExpressBetaDiversity is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// ExpressBetaDiversity is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ExpressBetaDiversity. If not, see
+// <http://www.gnu.org/licenses/>.
+//=======================================================================
+
+#ifndef _BLOCK_COMPRESSOR_
+#define _BLOCK_COMPRESSOR_
+
+#include "Precompiled.hpp"
+
+/**
+ * @brief Compress data as a series of independent gzip members or zstd frames.
+ *
+ * Data is split into blocks which are compressed in parallel by the worker threads. Each 
+ * block is a complete gzip member or zstd frame, and gzip and zstd decompressors read 
+ * concatenated members or frames as a single stream, so the output of successive calls can 
+ * be appended to the same file. zstd support requires building with HAVE_ZSTD defined and 
+ * linking against libzstd.
+ */
+class BlockCompressor
+{
+public:
+	enum COMPRESSION { NO_COMPRESSION, GZIP_COMPRESSION, ZSTD_COMPRESSION };
+
+public:
+	/** Constructor. */
+	BlockCompressor(COMPRESSION compression = NO_COMPRESSION);
+
+	/** Destructor. */
+	~BlockCompressor() {}
+
+	/**
+	* @brief Determine compression from its name.
+	*
+	* @param name Name of compression ('none', 'gzip', or 'zstd').
+	* @param compression Set to compression with the given name.
+	* @return True if the compression is known and supported by this build, else false.
+	*/
+	static bool Parse(const std::string& name, COMPRESSION& compression);
+
+	/** Get compression being applied. */
+	COMPRESSION GetCompression() const { return m_compression; }
+
+	/**
+	* @brief Compress data.
+	*
+	* @param data Data to compress.
+	* @param size Size of data.
+	* @param out Set to compressed data.
+	* @return True if data was compressed successfully, else false.
+	*/
+	bool Compress(const char* data, uint64 size, std::vector<char>& out) const;
+
+	/** Size of blocks compressed independently. */
+	static const uint BLOCK_SIZE = 1024*1024;
+
+private:
+	/** Compress a single block into a gzip member or zstd frame. */
+	bool CompressBlock(const char* data, uint size, std::vector<char>& out) const;
+
+private:
+	/** Compression being applied. */
+	COMPRESSION m_compression;
+};
+
+#endif
@@ -0,0 +1,123 @@
+//=======================================================================
+// Author: Donovan Parks
+//
+// Copyright 2011 Donovan Parks
+//
+// This file is part of ExpressBetaDiversity.
+//
+// ExpressBetaDiversity is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// ExpressBetaDiversity is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ExpressBetaDiversity. If not, see
+// <http://www.gnu.org/licenses/>.
+//=======================================================================
+
+#include "Precompiled.hpp"
+
+#include "Checkpoint.hpp"
+#include "Utils.hpp"
+
+const std::string CHECKPOINT_HEADER = "NetworkDiversity checkpoint";
+
+Checkpoint::Checkpoint(const std::string& outputFile, uint64 fingerprint)
+	: m_filename(outputFile + ".ckpt"), m_fingerprint(fingerprint)
+{
+
+}
+
+bool Checkpoint::Read(uint& numCompletedBlocks, uint64& outputSize)
+{
+	std::ifstream in(m_filename.c_str());
+	if(!in.is_open())
+		return false;
+
+	std::string header;
+	std::getline(in, header);
+	if(header != CHECKPOINT_HEADER)
+	{
+		std::cerr << "Invalid checkpoint file: " << m_filename << std::endl;
+		return false;
+	}
+
+	std::string label;
+	uint64 fingerprint;
+	in >> label >> std::hex >> fingerprint >> std::dec;
+	if(!in.good() || label != "fingerprint")
+	{
+		std::cerr << "Invalid checkpoint file: " << m_filename << std::endl;
+		return false;
+	}
+
+	if(fingerprint != m_fingerprint)
+	{
+		std::cerr << "Checkpoint file " << m_filename << " was created from different input data or settings." << std::endl;
+		return false;
+	}
+
+	// use the last complete checkpoint line
+	bool bFound = false;
+	std::string line;
+	while(std::getline(in, line))
+	{
+		std::istringstream lineStream(line);
+		uint blocks;
+		uint64 size;
+		std::string end;
+		if(lineStream >> label >> blocks >> size >> end && label == "blocks" && end == ".")
+		{
+			numCompletedBlocks = blocks;
+			outputSize = size;
+			bFound = true;
+		}
+	}
+
+	if(!bFound)
+		std::cerr << "Checkpoint file " << m_filename << " does not contain any completed blocks." << std::endl;
+
+	return bFound;
+}
+
+bool Checkpoint::Record(uint numCompletedBlocks, uint64 outputSize)
+{
+	std::string tempFile = m_filename + ".tmp";
+	std::ofstream out(tempFile.c_str());
+	out << CHECKPOINT_HEADER << std::endl;
+	out << "fingerprint " << std::hex << m_fingerprint << std::dec << std::endl;
+
+	// trailing '.' marks the line as complete
+	out << "blocks " << numCompletedBlocks << " " << outputSize << " ." << std::endl;
+	out.close();
+
+	// if the rename is lost the previous checkpoint remains, which refers to data already on disk
+	if(out.fail() || !SyncFile(tempFile))
+	{
+		::remove(tempFile.c_str());
+		std::cerr << "Unable to write checkpoint file: " << tempFile << std::endl;
+		return false;
+	}
+
+#ifdef WIN32
+	::remove(m_filename.c_str());
+#endif
+
+	if(rename(tempFile.c_str(), m_filename.c_str()) != 0)
+	{
+		std::cerr << "Unable to write checkpoint file: " << m_filename << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+void Checkpoint::Remove()
+{
+	::remove(m_filename.c_str());
+}
@@ -0,0 +1,78 @@
+//=======================================================================
+// Author: Donovan Parks
+//
+// Copyright 2011 Donovan Parks
+//
+// This file is part of ExpressBetaDiversity.
+//
+// ExpressBetaDiversity is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// ExpressBetaDiversity is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ExpressBetaDiversity. If not, see
+// <http://www.gnu.org/licenses/>.
+//=======================================================================
+
+#ifndef _CHECKPOINT_
+#define _CHECKPOINT_
+
+#include "Precompiled.hpp"
+
+/**
+ * @brief Record progress of a dissimilarity matrix computation in a sidecar file.
+ *
+ * The sidecar file (<output file>.ckpt) starts with a fingerprint of the input data and 
+ * calculator settings, followed by a line giving the number of completed row blocks and 
+ * the size of the output file once these blocks were written. The output file must be on 
+ * disk before a checkpoint is recorded. Each checkpoint is written to a temporary file which 
+ * is forced to disk and renamed over the sidecar file, so the sidecar file always holds a 
+ * complete checkpoint even if the machine fails while it is being recorded.
+ */
+class Checkpoint
+{
+public:
+	/** 
+	 * @brief Constructor.
+	 *
+	 * @param outputFile Output file whose progress is being recorded.
+	 * @param fingerprint Fingerprint of the input data and settings used to produce the output file.
+	 */
+	Checkpoint(const std::string& outputFile, uint64 fingerprint);
+
+	/** Destructor. */
+	~Checkpoint() {}
+
+	/** Get path to sidecar file. */
+	const std::string& GetFilename() const { return m_filename; }
+
+	/**
+	* @brief Read last checkpoint from an existing sidecar file.
+	*
+	* @param numCompletedBlocks Number of row blocks completed at last checkpoint.
+	* @param outputSize Size of output file in bytes at last checkpoint.
+	* @return True if a checkpoint matching the fingerprint was found, else false.
+	*/
+	bool Read(uint& numCompletedBlocks, uint64& outputSize);
+
+	/** Record that the given number of row blocks are complete and the output file, already on disk, has the given size. */
+	bool Record(uint numCompletedBlocks, uint64 outputSize);
+
+	/** Remove sidecar file once the output file is complete. */
+	void Remove();
+
+private:
+	/** Path to sidecar file. */
+	std::string m_filename;
+
+	/** Fingerprint of input data and settings. */
+	uint64 m_fingerprint;
+};
+
+#endif
@@ -0,0 +1,588 @@
+//=======================================================================
+// Author: Donovan Parks
+//
+// Copyright 2011 Donovan Parks
+//
+// This file is part of ExpressBetaDiversity.
+//
+// ExpressBetaDiversity is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// ExpressBetaDiversity is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ExpressBetaDiversity. If not, see
+// <http://www.gnu.org/licenses/>.
+//=======================================================================
+
+#include "Precompiled.hpp"
+
+#include "CompressedFile.hpp"
+#include "Utils.hpp"
+
+#include <zlib.h>
+
+#ifdef HAVE_ZSTD
+	#include <zstd.h>
+#endif
+
+// identifies block index files and the layout of this version
+const char BLOCK_INDEX_MAGIC[8] = { 'N', 'D', 'Z', 'I', 'D', 'X', '0', '1' };
+
+// written in native byte order so an index from a machine with different endianness is rejected
+const uint BLOCK_INDEX_BYTE_ORDER = 0x01020304;
+
+// approximate spacing of access points within a gzip member, in bytes of decompressed data
+const uint64 ACCESS_POINT_SPAN = 4*1024*1024;
+
+// size of the deflate history window
+const uint WINDOW_SIZE = 32768;
+
+// largest amount of input given to zlib at once since its counts are 32-bit
+const uint64 MAX_ZLIB_INPUT = 1 << 30;
+
+// zlib window bits for a raw deflate stream and for automatic gzip or zlib header detection
+const int RAW_WINDOW_BITS = -15;
+const int AUTO_WINDOW_BITS = 47;
+
+namespace
+{
+	template<typename T> void WriteValue(std::ofstream& out, const T& value)
+	{
+		out.write((const char*)&value, sizeof(T));
+	}
+
+	template<typename T> bool ReadValue(std::ifstream& in, T& value)
+	{
+		return (bool)in.read((char*)&value, sizeof(T));
+	}
+
+	uint ReadLE16(const unsigned char* data)
+	{
+		return data[0] | (data[1] << 8);
+	}
+
+	uint ReadLE32(const unsigned char* data)
+	{
+		return data[0] | (data[1] << 8) | (data[2] << 16) | ((uint)data[3] << 24);
+	}
+
+	bool IsGzipMember(const unsigned char* data, uint64 size)
+	{
+		return size >= 2 && data[0] == 0x1f && data[1] == 0x8b;
+	}
+
+	/** Give zlib as much of the remaining input as it can take at once. */
+	void FeedInput(z_stream& strm, const unsigned char* data, uint64 size)
+	{
+		uint64 consumed = strm.next_in - data;
+		strm.avail_in = (uInt)std::min<uint64>(MAX_ZLIB_INPUT, size - consumed);
+	}
+}
+
+CompressedFile::CompressedFile()
+	: m_compression(DecompressBuf::NO_COMPRESSION), m_size(0)
+{
+
+}
+
+bool CompressedFile::Open(const std::string& filename)
+{
+	m_points.clear();
+	m_size = 0;
+	m_cache.clear();
+
+	if(!m_file.Open(filename))
+		return false;
+
+	m_compression = DecompressBuf::GetCompression(filename);
+
+	// one cached block per worker thread
+	m_cache.resize(omp_get_max_threads());
+
+	return true;
+}
+
+void CompressedFile::AddStreamStart(uint64 in, uint64 out)
+{
+	AccessPoint point;
+	point.in = in;
+	point.out = out;
+	point.bits = 0;
+	point.bStreamStart = true;
+	m_points.push_back(point);
+}
+
+bool CompressedFile::BuildIndex()
+{
+	m_points.clear();
+	m_size = 0;
+
+	bool bBuilt = false;
+	if(m_compression == DecompressBuf::GZIP_COMPRESSION)
+		bBuilt = BuildBgzfIndex() || BuildGzipIndex();
+	else if(m_compression == DecompressBuf::ZSTD_COMPRESSION)
+		bBuilt = BuildZstdIndex();
+
+	if(!bBuilt)
+	{
+		m_points.clear();
+		m_size = 0;
+	}
+
+	return bBuilt;
+}
+
+bool CompressedFile::BuildBgzfIndex()
+{
+	// each BGZF member gives its compressed size in a 'BC' extra field and ends with its decompressed size
+	const unsigned char* data = (const unsigned char*)m_file.GetData();
+	uint64 fileSize = m_file.GetSize();
+
+	uint64 pos = 0;
+	uint64 out = 0;
+	while(pos < fileSize)
+	{
+		const unsigned char* member = data + pos;
+		uint64 remaining = fileSize - pos;
+		if(remaining < 18 || !IsGzipMember(member, remaining) || member[2] != Z_DEFLATED || !(member[3] & 0x04))
+			return false;
+
+		uint extraLen = ReadLE16(member + 10);
+		if(12 + extraLen > remaining)
+			return false;
+
+		uint64 memberSize = 0;
+		for(uint i = 12; i + 4 <= 12 + extraLen; )
+		{
+			uint fieldLen = ReadLE16(member + i + 2);
+			if(member[i] == 'B' && member[i+1] == 'C' && fieldLen == 2)
+				memberSize = ReadLE16(member + i + 4) + 1;
+
+			i += 4 + fieldLen;
+		}
+
+		if(memberSize < 18 || memberSize > remaining)
+			return false;
+
+		// empty members, such as the BGZF end-of-file marker, are not blocks
+		uint memberOut = ReadLE32(member + memberSize - 4);
+		if(memberOut > 0)
+			AddStreamStart(pos, out);
+
+		out += memberOut;
+		pos += memberSize;
+	}
+
+	m_size = out;
+
+	return !m_points.empty();
+}
+
+bool CompressedFile::BuildGzipIndex()
+{
+	// record decompressor state at deflate block boundaries roughly every ACCESS_POINT_SPAN bytes (see zran.c in zlib)
+	const unsigned char* data = (const unsigned char*)m_file.GetData();
+	uint64 fileSize = m_file.GetSize();
+
+	z_stream strm;
+	memset(&strm, 0, sizeof(strm));
+	if(inflateInit2(&strm, AUTO_WINDOW_BITS) != Z_OK)
+		return false;
+
+	std::vector<unsigned char> window(WINDOW_SIZE, 0);
+	strm.next_in = (Bytef*)data;
+	strm.avail_in = 0;
+	strm.avail_out = 0;
+
+	uint64 out = 0;
+	uint64 lastPoint = 0;
+	AddStreamStart(0, 0);
+
+	bool bSuccess = false;
+	while(true)
+	{
+		if(strm.avail_in == 0)
+		{
+			FeedInput(strm, data, fileSize);
+			if(strm.avail_in == 0)
+			{
+				std::cerr << "Compressed file is truncated." << std::endl;
+				break;
+			}
+		}
+
+		if(strm.avail_out == 0)
+		{
+			strm.next_out = &window[0];
+			strm.avail_out = WINDOW_SIZE;
+		}
+
+		uInt availOut = strm.avail_out;
+		int ret = inflate(&strm, Z_BLOCK);
+		out += availOut - strm.avail_out;
+		uint64 in = strm.next_in - data;
+
+		if(ret == Z_STREAM_END)
+		{
+			// another gzip member may follow; anything else (e.g., padding) is ignored
+			if(!IsGzipMember(data + in, fileSize - in))
+			{
+				bSuccess = true;
+				break;
+			}
+
+			inflateReset(&strm);
+			AddStreamStart(in, out);
+			lastPoint = out;
+			continue;
+		}
+
+		if(ret != Z_OK && ret != Z_BUF_ERROR)
+		{
+			std::cerr << "Error decompressing gzip file: " << (strm.msg != NULL ? strm.msg : "invalid data") << std::endl;
+			break;
+		}
+
+		// at the end of a deflate block which is not the last block of the member
+		if((strm.data_type & 128) && !(strm.data_type & 64) && out - lastPoint > ACCESS_POINT_SPAN)
+		{
+			AccessPoint point;
+			point.in = in;
+			point.out = out;
+			point.bits = strm.data_type & 7;
+			point.bStreamStart = false;
+
+			// window is written circularly, so the oldest data follows the current output position
+			point.window.resize(WINDOW_SIZE);
+			uint oldest = strm.avail_out;
+			memcpy(&point.window[0], &window[0] + WINDOW_SIZE - oldest, oldest);
+			memcpy(&point.window[0] + oldest, &window[0], WINDOW_SIZE - oldest);
+
+			m_points.push_back(point);
+			lastPoint = out;
+		}
+	}
+
+	inflateEnd(&strm);
+	m_size = out;
+
+	return bSuccess;
+}
+
+bool CompressedFile::BuildZstdIndex()
+{
+#ifdef HAVE_ZSTD
+	const char* data = m_file.GetData();
+	uint64 fileSize = m_file.GetSize();
+
+	uint64 pos = 0;
+	uint64 out = 0;
+	while(pos < fileSize)
+	{
+		size_t frameSize = ZSTD_findFrameCompressedSize(data + pos, fileSize - pos);
+		unsigned long long frameOut = ZSTD_getFrameContentSize(data + pos, fileSize - pos);
+		if(ZSTD_isError(frameSize) || frameOut == ZSTD_CONTENTSIZE_ERROR)
+		{
+			std::cerr << "Error reading zstd file: invalid frame." << std::endl;
+			return false;
+		}
+
+		if(frameOut == ZSTD_CONTENTSIZE_UNKNOWN)
+		{
+			// frame does not record its decompressed size, so decompress it to find the size
+			ZSTD_DStream* stream = ZSTD_createDStream();
+			ZSTD_initDStream(stream);
+
+			std::vector<char> buffer(ZSTD_DStreamOutSize());
+			ZSTD_inBuffer input = { data + pos, frameSize, 0 };
+			frameOut = 0;
+			size_t ret = 1;
+			while(ret != 0 && !ZSTD_isError(ret))
+			{
+				ZSTD_outBuffer output = { &buffer[0], buffer.size(), 0 };
+				ret = ZSTD_decompressStream(stream, &output, &input);
+				frameOut += output.pos;
+				if(ret != 0 && input.pos == input.size && output.pos == 0)
+					break;
+			}
+			ZSTD_freeDStream(stream);
+
+			if(ret != 0)
+			{
+				std::cerr << "Error decompressing zstd file: " << (ZSTD_isError(ret) ? ZSTD_getErrorName(ret) : "truncated frame") << std::endl;
+				return false;
+			}
+		}
+
+		// skippable frames hold no data
+		if(frameOut > 0)
+			AddStreamStart(pos, out);
+
+		out += frameOut;
+		pos += frameSize;
+	}
+
+	m_size = out;
+
+	return !m_points.empty();
+#else
+	std::cerr << "Unable to read zstd compressed file (built without zstd support)." << std::endl;
+	return false;
+#endif
+}
+
+uint64 CompressedFile::GetBlockSize(uint block) const
+{
+	uint64 end = (block + 1 < m_points.size()) ? m_points[block+1].out : m_size;
+	return end - m_points[block].out;
+}
+
+uint CompressedFile::FindBlock(uint64 offset) const
+{
+	// last block starting at or before offset
+	uint first = 0;
+	uint last = m_points.size();
+	while(last - first > 1)
+	{
+		uint mid = first + (last - first) / 2;
+		if(m_points[mid].out <= offset)
+			first = mid;
+		else
+			last = mid;
+	}
+
+	return first;
+}
+
+bool CompressedFile::ReadBlock(uint block, std::vector<char>& data) const
+{
+	const AccessPoint& point = m_points[block];
+	data.resize((size_t)GetBlockSize(block));
+	if(data.empty())
+		return true;
+
+	const unsigned char* fileData = (const unsigned char*)m_file.GetData();
+	uint64 fileSize = m_file.GetSize();
+
+	if(m_compression == DecompressBuf::ZSTD_COMPRESSION)
+	{
+	#ifdef HAVE_ZSTD
+		ZSTD_DStream* stream = ZSTD_createDStream();
+		ZSTD_initDStream(stream);
+
+		ZSTD_inBuffer input = { fileData + point.in, fileSize - point.in, 0 };
+		ZSTD_outBuffer output = { &data[0], data.size(), 0 };
+		size_t ret = 0;
+		while(output.pos < output.size && input.pos < input.size && !ZSTD_isError(ret))
+			ret = ZSTD_decompressStream(stream, &output, &input);
+		ZSTD_freeDStream(stream);
+
+		return !ZSTD_isError(ret) && output.pos == output.size;
+	#else
+		return false;
+	#endif
+	}
+
+	z_stream strm;
+	memset(&strm, 0, sizeof(strm));
+	if(inflateInit2(&strm, point.bStreamStart ? AUTO_WINDOW_BITS : RAW_WINDOW_BITS) != Z_OK)
+		return false;
+
+	if(!point.bStreamStart)
+	{
+		// restore decompressor state: remaining bits of the previous byte and the history window
+		if(point.bits > 0)
+			inflatePrime(&strm, point.bits, fileData[point.in-1] >> (8 - point.bits));
+
+		inflateSetDictionary(&strm, &point.window[0], WINDOW_SIZE);
+	}
+
+	strm.next_in = (Bytef*)(fileData + point.in);
+	strm.avail_in = 0;
+
+	uint64 produced = 0;
+	bool bSuccess = true;
+	while(produced < data.size())
+	{
+		if(strm.avail_in == 0)
+		{
+			FeedInput(strm, fileData, fileSize);
+			if(strm.avail_in == 0)
+			{
+				bSuccess = false;
+				break;
+			}
+		}
+
+		strm.next_out = (Bytef*)&data[produced];
+		strm.avail_out = (uInt)std::min<uint64>(MAX_ZLIB_INPUT, data.size() - produced);
+		uInt availOut = strm.avail_out;
+
+		int ret = inflate(&strm, Z_NO_FLUSH);
+		produced += availOut - strm.avail_out;
+
+		if(ret == Z_STREAM_END && produced < data.size() && point.bStreamStart)
+		{
+			// empty gzip members may precede the next block
+			inflateReset(&strm);
+		}
+		else if(ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR)
+		{
+			bSuccess = false;
+			break;
+		}
+		else if(ret == Z_STREAM_END && produced < data.size())
+		{
+			bSuccess = false;
+			break;
+		}
+	}
+
+	inflateEnd(&strm);
+
+	return bSuccess;
+}
+
+const std::vector<char>* CompressedFile::GetBlock(uint block, std::vector<char>& buffer) const
+{
+	uint thread = omp_get_thread_num();
+	if(thread >= m_cache.size())
+		return ReadBlock(block, buffer) ? &buffer : NULL;
+
+	BlockCache& cache = m_cache[thread];
+	if(cache.block != (int)block)
+	{
+		cache.block = -1;
+		if(!ReadBlock(block, cache.data))
+			return NULL;
+
+		cache.block = block;
+	}
+
+	return &cache.data;
+}
+
+bool CompressedFile::Read(uint64 offset, uint64 length, std::vector<char>& data) const
+{
+	data.resize((size_t)length);
+	if(offset + length > m_size)
+		return false;
+
+	std::vector<char> buffer;
+	uint64 pos = 0;
+	while(pos < length)
+	{
+		uint block = FindBlock(offset + pos);
+		const std::vector<char>* blockData = GetBlock(block, buffer);
+		if(blockData == NULL)
+			return false;
+
+		uint64 blockOffset = offset + pos - m_points[block].out;
+		uint64 bytes = std::min<uint64>(length - pos, blockData->size() - blockOffset);
+		if(bytes == 0)
+			return false;
+
+		memcpy(&data[pos], &(*blockData)[blockOffset], bytes);
+		pos += bytes;
+	}
+
+	return true;
+}
+
+bool CompressedFile::LoadIndex(const std::string& indexFile, uint64 fingerprint)
+{
+	m_points.clear();
+	m_size = 0;
+
+	std::ifstream in(indexFile.c_str(), std::ios::binary);
+	if(!in.is_open())
+		return false;
+
+	char magic[sizeof(BLOCK_INDEX_MAGIC)];
+	uint byteOrder;
+	uint64 indexFingerprint;
+	if(!in.read(magic, sizeof(magic)) || memcmp(magic, BLOCK_INDEX_MAGIC, sizeof(magic)) != 0)
+		return false;
+
+	if(!ReadValue(in, byteOrder) || byteOrder != BLOCK_INDEX_BYTE_ORDER)
+		return false;
+
+	if(!ReadValue(in, indexFingerprint) || indexFingerprint != fingerprint)
+		return false;
+
+	uint numPoints;
+	if(!ReadValue(in, m_size) || !ReadValue(in, numPoints))
+		return false;
+
+	m_points.resize(numPoints);
+	for(uint i = 0; i < numPoints; ++i)
+	{
+		AccessPoint& point = m_points[i];
+		char bStreamStart;
+		if(!ReadValue(in, point.in) || !ReadValue(in, point.out) || !ReadValue(in, point.bits) || !ReadValue(in, bStreamStart))
+		{
+			m_points.clear();
+			return false;
+		}
+
+		point.bStreamStart = (bStreamStart != 0);
+		if(!point.bStreamStart)
+		{
+			point.window.resize(WINDOW_SIZE);
+			if(!in.read((char*)&point.window[0], WINDOW_SIZE))
+			{
+				m_points.clear();
+				return false;
+			}
+		}
+	}
+
+	return !m_points.empty();
+}
+
+bool CompressedFile::SaveIndex(const std::string& indexFile, uint64 fingerprint) const
+{
+	// write to a temporary file of this process which replaces the index once complete, 
+	// so concurrent runs never see a partially written index
+	std::string tempFile = TempSiblingFilename(indexFile);
+	std::ofstream out(tempFile.c_str(), std::ios::binary);
+	if(!out.is_open())
+		return false;
+
+	out.write(BLOCK_INDEX_MAGIC, sizeof(BLOCK_INDEX_MAGIC));
+	WriteValue(out, BLOCK_INDEX_BYTE_ORDER);
+	WriteValue(out, fingerprint);
+	WriteValue(out, m_size);
+
+	WriteValue(out, (uint)m_points.size());
+	for(uint i = 0; i < m_points.size(); ++i)
+	{
+		const AccessPoint& point = m_points[i];
+		WriteValue(out, point.in);
+		WriteValue(out, point.out);
+		WriteValue(out, point.bits);
+		WriteValue(out, (char)point.bStreamStart);
+
+		if(!point.bStreamStart)
+			out.write((const char*)&point.window[0], WINDOW_SIZE);
+	}
+
+	out.close();
+	if(out.fail())
+	{
+		remove(tempFile.c_str());
+		return false;
+	}
+
+#ifdef WIN32
+	remove(indexFile.c_str());
+#endif
+
+	return rename(tempFile.c_str(), indexFile.c_str()) == 0;
+}
@@ -0,0 +1,150 @@
+//=======================================================================
+// Author: Donovan Parks
+//
+// Copyright 2011 Donovan Parks
+//
+// This file is part of ExpressBetaDiversity.
+//
+// ExpressBetaDiversity is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// ExpressBetaDiversity is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ExpressBetaDiversity. If not, see
+// <http://www.gnu.org/licenses/>.
+//=======================================================================
+
+#ifndef _COMPRESSED_FILE_
+#define _COMPRESSED_FILE_
+
+#include "Precompiled.hpp"
+
+#include "MappedFile.hpp"
+#include "CompressedStream.hpp"
+
+/**
+ * @brief Random access to the decompressed contents of a gzip or zstd file.
+ *
+ * The compressed file is memory mapped and divided into blocks which can each be decompressed
+ * on their own, so blocks can be decompressed in parallel and any offset can be reached without
+ * decompressing the file from its start. Blocks start at each gzip member (e.g., BGZF blocks) or 
+ * zstd frame, and roughly every 4 MB within a gzip member where the decompressor history is 
+ * recorded. The last block decompressed by each thread is kept, so a thread reading sequentially
+ * decompresses each block once.
+ */
+class CompressedFile
+{
+public:
+	/** Constructor. */
+	CompressedFile();
+
+	/** Destructor. */
+	~CompressedFile() {}
+
+	/** Map compressed file into memory. The block index must then be built or loaded. */
+	bool Open(const std::string& filename);
+
+	/** Get compressed file. */
+	const MappedFile& GetCompressedFile() const { return m_file; }
+
+	/** Build block index by scanning the compressed file. */
+	bool BuildIndex();
+
+	/**
+	* @brief Load a saved block index.
+	*
+	* @param indexFile Path to index file.
+	* @param fingerprint Fingerprint of the compressed file the index must have been built from.
+	* @return True if a matching index was loaded, else false.
+	*/
+	bool LoadIndex(const std::string& indexFile, uint64 fingerprint);
+
+	/** Save block index. */
+	bool SaveIndex(const std::string& indexFile, uint64 fingerprint) const;
+
+	/** Get size of decompressed data in bytes. */
+	uint64 GetSize() const { return m_size; }
+
+	/** Get number of independently decompressible blocks. */
+	uint GetNumBlocks() const { return m_points.size(); }
+
+	/** Decompress a block. Safe to call from multiple threads. */
+	bool ReadBlock(uint block, std::vector<char>& data) const;
+
+	/** Decompress a range of the file. Safe to call from multiple threads. */
+	bool Read(uint64 offset, uint64 length, std::vector<char>& data) const;
+
+private:
+	/** Point in the compressed file where decompression can start. */
+	struct AccessPoint
+	{
+		/** Offset in compressed file of first byte to decompress. */
+		uint64 in;
+
+		/** Offset in decompressed data. */
+		uint64 out;
+
+		/** Number of bits of the byte before 'in' which are still to be decompressed. */
+		int bits;
+
+		/** Flag indicating point is the start of a gzip member or zstd frame, so no history is needed. */
+		bool bStreamStart;
+
+		/** Last 32 KB of decompressed data before a point within a gzip member. */
+		std::vector<unsigned char> window;
+	};
+
+	/** Last block decompressed by a thread. */
+	struct BlockCache
+	{
+		BlockCache(): block(-1) {}
+
+		int block;
+		std::vector<char> data;
+	};
+
+	/** Block index of a BGZF file, read from the size of each member without decompressing. */
+	bool BuildBgzfIndex();
+
+	/** Block index of any gzip file, found by decompressing the file. */
+	bool BuildGzipIndex();
+
+	/** Block index of a zstd file with one block per frame. */
+	bool BuildZstdIndex();
+
+	/** Add point where a gzip member or zstd frame starts. */
+	void AddStreamStart(uint64 in, uint64 out);
+
+	/** Get size of decompressed block. */
+	uint64 GetBlockSize(uint block) const;
+
+	/** Get index of block containing an offset in the decompressed data. */
+	uint FindBlock(uint64 offset) const;
+
+	/** Get decompressed block, using the block cache of the calling thread if possible. */
+	const std::vector<char>* GetBlock(uint block, std::vector<char>& buffer) const;
+
+private:
+	/** Compressed file mapped into memory. */
+	MappedFile m_file;
+
+	/** Compression of file. */
+	DecompressBuf::COMPRESSION m_compression;
+
+	/** Size of decompressed data. */
+	uint64 m_size;
+
+	/** Start of each block, in order. */
+	std::vector<AccessPoint> m_points;
+
+	/** Last block decompressed by each thread. */
+	mutable std::vector<BlockCache> m_cache;
+};
+
+#endif
@@ -0,0 +1,279 @@
+//=======================================================================
+// Author: Donovan Parks
+//
+// Copyright 2011 Donovan Parks
+//
+// This file is part of ExpressBetaDiversity.
+//
+// ExpressBetaDiversity is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// ExpressBetaDiversity is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ExpressBetaDiversity. If not, see
+// <http://www.gnu.org/licenses/>.
+//=======================================================================
+
+#include "Precompiled.hpp"
+
+#include "CompressedStream.hpp"
+
+#include <zlib.h>
+
+#ifdef HAVE_ZSTD
+	#include <zstd.h>
+#endif
+
+// leading bytes identifying compressed files
+const unsigned char GZIP_MAGIC[2] = { 0x1f, 0x8b };
+const unsigned char ZSTD_MAGIC[4] = { 0x28, 0xb5, 0x2f, 0xfd };
+
+// size of decompressed data handed to the stream at once
+const uint DECOMPRESS_BUFFER_SIZE = 256*1024;
+
+DecompressBuf::DecompressBuf()
+	: m_compression(NO_COMPRESSION), m_gzFile(NULL), m_file(NULL), m_zstdStream(NULL), 
+		m_inPos(0), m_inSize(0), m_bufferPos(0), m_bError(false)
+{
+
+}
+
+DecompressBuf::~DecompressBuf()
+{
+	Close();
+}
+
+DecompressBuf::COMPRESSION DecompressBuf::GetCompression(const std::string& filename)
+{
+	std::ifstream in(filename.c_str(), std::ios::binary);
+	unsigned char magic[sizeof(ZSTD_MAGIC)];
+	if(!in.read((char*)magic, sizeof(magic)))
+		return NO_COMPRESSION;
+
+	if(memcmp(magic, GZIP_MAGIC, sizeof(GZIP_MAGIC)) == 0)
+		return GZIP_COMPRESSION;
+
+	if(memcmp(magic, ZSTD_MAGIC, sizeof(ZSTD_MAGIC)) == 0)
+		return ZSTD_COMPRESSION;
+
+	return NO_COMPRESSION;
+}
+
+bool DecompressBuf::Open(const std::string& filename)
+{
+	Close();
+
+	m_compression = GetCompression(filename);
+	if(m_compression == ZSTD_COMPRESSION)
+	{
+	#ifdef HAVE_ZSTD
+		m_file = fopen(filename.c_str(), "rb");
+		if(m_file == NULL)
+			return false;
+
+		m_zstdStream = ZSTD_createDStream();
+		ZSTD_initDStream((ZSTD_DStream*)m_zstdStream);
+		m_inBuffer.resize(ZSTD_DStreamInSize());
+	#else
+		std::cerr << "Unable to read zstd compressed file (built without zstd support): " << filename << std::endl;
+		return false;
+	#endif
+	}
+	else
+	{
+		// zlib reads files which are not compressed unchanged
+		gzFile file = gzopen(filename.c_str(), "rb");
+		if(file == NULL)
+			return false;
+
+		gzbuffer(file, DECOMPRESS_BUFFER_SIZE);
+		m_gzFile = file;
+	}
+
+	m_buffer.resize(DECOMPRESS_BUFFER_SIZE);
+	setg(&m_buffer[0], &m_buffer[0], &m_buffer[0]);
+
+	return true;
+}
+
+void DecompressBuf::Close()
+{
+	if(m_gzFile != NULL)
+		gzclose((gzFile)m_gzFile);
+
+	if(m_file != NULL)
+		fclose(m_file);
+
+#ifdef HAVE_ZSTD
+	if(m_zstdStream != NULL)
+		ZSTD_freeDStream((ZSTD_DStream*)m_zstdStream);
+#endif
+
+	m_compression = NO_COMPRESSION;
+	m_gzFile = NULL;
+	m_file = NULL;
+	m_zstdStream = NULL;
+	m_inPos = m_inSize = 0;
+	m_bufferPos = 0;
+	m_bError = false;
+	setg(NULL, NULL, NULL);
+}
+
+int DecompressBuf::Fill()
+{
+	if(m_gzFile != NULL)
+	{
+		int bytes = gzread((gzFile)m_gzFile, &m_buffer[0], m_buffer.size());
+		if(bytes < 0 && !m_bError)
+		{
+			int errnum;
+			std::cerr << "Error decompressing gzip file: " << gzerror((gzFile)m_gzFile, &errnum) << std::endl;
+			m_bError = true;
+		}
+
+		return bytes;
+	}
+
+#ifdef HAVE_ZSTD
+	if(m_file != NULL)
+	{
+		ZSTD_outBuffer out = { &m_buffer[0], m_buffer.size(), 0 };
+		while(out.pos == 0)
+		{
+			if(m_inPos == m_inSize)
+			{
+				m_inSize = fread(&m_inBuffer[0], 1, m_inBuffer.size(), m_file);
+				m_inPos = 0;
+				if(m_inSize == 0)
+					break;
+			}
+
+			ZSTD_inBuffer in = { &m_inBuffer[0], m_inSize, m_inPos };
+			size_t ret = ZSTD_decompressStream((ZSTD_DStream*)m_zstdStream, &out, &in);
+			m_inPos = in.pos;
+			if(ZSTD_isError(ret))
+			{
+				if(!m_bError)
+					std::cerr << "Error decompressing zstd file: " << ZSTD_getErrorName(ret) << std::endl;
+				m_bError = true;
+				return -1;
+			}
+		}
+
+		return (int)out.pos;
+	}
+#endif
+
+	return -1;
+}
+
+DecompressBuf::int_type DecompressBuf::underflow()
+{
+	if(gptr() < egptr())
+		return traits_type::to_int_type(*gptr());
+
+	if(!IsOpen())
+		return traits_type::eof();
+
+	m_bufferPos += egptr() - eback();
+
+	int bytes = Fill();
+	if(bytes <= 0)
+	{
+		setg(&m_buffer[0], &m_buffer[0], &m_buffer[0]);
+		return traits_type::eof();
+	}
+
+	setg(&m_buffer[0], &m_buffer[0], &m_buffer[0] + bytes);
+	return traits_type::to_int_type(*gptr());
+}
+
+bool DecompressBuf::Rewind()
+{
+	if(m_gzFile != NULL && gzrewind((gzFile)m_gzFile) != 0)
+		return false;
+
+#ifdef HAVE_ZSTD
+	if(m_file != NULL)
+	{
+		if(fseek(m_file, 0, SEEK_SET) != 0)
+			return false;
+
+		ZSTD_initDStream((ZSTD_DStream*)m_zstdStream);
+		m_inPos = m_inSize = 0;
+	}
+#endif
+
+	m_bufferPos = 0;
+	setg(&m_buffer[0], &m_buffer[0], &m_buffer[0]);
+
+	return true;
+}
+
+DecompressBuf::pos_type DecompressBuf::seekoff(off_type offset, std::ios_base::seekdir dir, std::ios_base::openmode which)
+{
+	uint64 curPos = m_bufferPos + (gptr() - eback());
+	if(dir == std::ios_base::cur)
+		return seekpos(curPos + offset, which);
+	else if(dir == std::ios_base::beg)
+		return seekpos(offset, which);
+
+	// end of a compressed file is unknown
+	return pos_type(off_type(-1));
+}
+
+DecompressBuf::pos_type DecompressBuf::seekpos(pos_type pos, std::ios_base::openmode which)
+{
+	if(!IsOpen() || !(which & std::ios_base::in) || off_type(pos) < 0)
+		return pos_type(off_type(-1));
+
+	uint64 target = (uint64)off_type(pos);
+	if(target >= m_bufferPos && target <= m_bufferPos + (egptr() - eback()))
+	{
+		// position is within the buffered data
+		setg(eback(), eback() + (target - m_bufferPos), egptr());
+		return pos;
+	}
+
+	if(target < m_bufferPos && !Rewind())
+		return pos_type(off_type(-1));
+
+	// decompress up to the requested position
+	while(m_bufferPos + (egptr() - eback()) < target)
+	{
+		setg(eback(), egptr(), egptr());
+		if(traits_type::eq_int_type(underflow(), traits_type::eof()))
+			return pos_type(off_type(-1));
+	}
+
+	setg(eback(), eback() + (target - m_bufferPos), egptr());
+
+	return pos;
+}
+
+CompressedStream::CompressedStream()
+	: std::istream(NULL)
+{
+	rdbuf(&m_buf);
+}
+
+CompressedStream::CompressedStream(const std::string& filename)
+	: std::istream(NULL)
+{
+	rdbuf(&m_buf);
+	open(filename);
+}
+
+void CompressedStream::open(const std::string& filename)
+{
+	if(m_buf.Open(filename))
+		clear();
+	else
+		setstate(std::ios_base::failbit);
+}
@@ -0,0 +1,132 @@
+//=======================================================================
+// Author: Donovan Parks
+//
+// Copyright 2011 Donovan Parks
+//
+// This file is part of ExpressBetaDiversity.
+//
+// ExpressBetaDiversity is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// ExpressBetaDiversity is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ExpressBetaDiversity. If not, see
+// <http://www.gnu.org/licenses/>.
+//=======================================================================
+
+#ifndef _COMPRESSED_STREAM_
+#define _COMPRESSED_STREAM_
+
+#include "Precompiled.hpp"
+
+/**
+ * @brief Stream buffer which decompresses a gzip or zstd file as it is read.
+ *
+ * Files which are not compressed are read unchanged. Seeking is supported, but seeking 
+ * backwards in a zstd file restarts decompression from the start of the file.
+ */
+class DecompressBuf : public std::streambuf
+{
+public:
+	enum COMPRESSION { NO_COMPRESSION, GZIP_COMPRESSION, ZSTD_COMPRESSION };
+
+public:
+	/** Constructor. */
+	DecompressBuf();
+
+	/** Destructor. */
+	~DecompressBuf();
+
+	/** Determine compression of a file from its first bytes. */
+	static COMPRESSION GetCompression(const std::string& filename);
+
+	/** Open file for reading. */
+	bool Open(const std::string& filename);
+
+	/** Close file. */
+	void Close();
+
+	/** Check if a file is open. */
+	bool IsOpen() const { return m_gzFile != NULL || m_file != NULL; }
+
+protected:
+	int_type underflow();
+	pos_type seekoff(off_type offset, std::ios_base::seekdir dir, std::ios_base::openmode which);
+	pos_type seekpos(pos_type pos, std::ios_base::openmode which);
+
+private:
+	/** Stream buffer owns the file so copying is not supported. */
+	DecompressBuf(const DecompressBuf&);
+	DecompressBuf& operator=(const DecompressBuf&);
+
+	/** Decompress next bytes of file into buffer. Returns number of bytes, 0 at end of file, or -1 on error. */
+	int Fill();
+
+	/** Restart reading from the start of the file. */
+	bool Rewind();
+
+private:
+	/** Compression of open file (uncompressed files are read through zlib). */
+	COMPRESSION m_compression;
+
+	/** zlib handle of a gzip or uncompressed file. */
+	void* m_gzFile;
+
+	/** File and decompression context of a zstd file. */
+	FILE* m_file;
+	void* m_zstdStream;
+
+	/** Compressed data read from zstd file but not yet decompressed. */
+	std::vector<char> m_inBuffer;
+	size_t m_inPos;
+	size_t m_inSize;
+
+	/** Decompressed data. */
+	std::vector<char> m_buffer;
+
+	/** Position in decompressed file of the start of the buffer. */
+	uint64 m_bufferPos;
+
+	/** Flag indicating a decompression error has been reported. */
+	bool m_bError;
+};
+
+/**
+ * @brief Input file stream which transparently decompresses gzip (.gz) and zstd (.zst) files.
+ *
+ * Compression is determined from the contents of the file rather than its extension. zstd 
+ * support requires building with HAVE_ZSTD defined and linking against libzstd.
+ */
+class CompressedStream : public std::istream
+{
+public:
+	/** Constructor. */
+	CompressedStream();
+
+	/** Constructor. Opens file for reading. */
+	explicit CompressedStream(const std::string& filename);
+
+	/** Destructor. */
+	~CompressedStream() {}
+
+	/** Open file for reading. */
+	void open(const std::string& filename);
+
+	/** Check if a file is open. */
+	bool is_open() const { return m_buf.IsOpen(); }
+
+	/** Close file. */
+	void close() { m_buf.Close(); }
+
+private:
+	/** Stream buffer doing the decompression. */
+	DecompressBuf m_buf;
+};
+
+#endif
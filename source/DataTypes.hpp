@@ -27,6 +27,7 @@
 typedef unsigned int uint;
 typedef unsigned char byte;
 typedef unsigned long ulong;
+typedef unsigned long long uint64;
 
 typedef std::vector< std::vector<double> > Matrix;
 
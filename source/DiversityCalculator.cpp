@@ -23,22 +23,42 @@
 #include "Precompiled.hpp"
 
 #include "DiversityCalculator.hpp"
+#include "Checkpoint.hpp"
+#include "MatrixStore.hpp"
+#include "NpyMatrixWriter.hpp"
+#include "Utils.hpp"
 
-bool DiversityCalculator::m_bWeighted;
-std::vector< std::vector<double> > DiversityCalculator::m_dataVecRows;
-std::vector< std::vector<double> > DiversityCalculator::m_dataVecCols;
-std::vector<double> DiversityCalculator::m_minExtent;
-std::vector<double> DiversityCalculator::m_maxExtent;
-std::vector<double> DiversityCalculator::m_colSum;
-std::vector<double> DiversityCalculator::m_rowLeafSum;
-std::vector<double> DiversityCalculator::m_rowLeafSumSqrd;
-std::vector<double> DiversityCalculator::m_weightedRowSum;
-std::vector<double> DiversityCalculator::m_splitWeights;
-double DiversityCalculator::m_totalSplitWeight;
-
-DiversityCalculator::DiversityCalculator(SplitSystem& splitSystem, const std::string& calcStr, 
+namespace
+{
+	/** Dissimilarity to a sample and index of the sample. */
+	typedef std::pair<double, uint> Neighbor;
+
+	/** Add sample to a max-heap of the k nearest neighbors found so far. */
+	void AddNeighbor(std::vector<Neighbor>& heap, uint k, double value, uint index)
+	{
+		// undefined dissimilarities are never neighbors
+		if(value != value)
+			return;
+
+		Neighbor neighbor(value, index);
+		if(heap.size() < k)
+		{
+			heap.push_back(neighbor);
+			std::push_heap(heap.begin(), heap.end());
+		}
+		else if(neighbor < heap.front())
+		{
+			std::pop_heap(heap.begin(), heap.end());
+			heap.back() = neighbor;
+			std::push_heap(heap.begin(), heap.end());
+		}
+	}
+}
+
+DiversityCalculator::DiversityCalculator(const SplitSystem& splitSystem, const std::string& calcStr, 
 																								bool bWeighted, bool bCount, uint maxDataVecs, bool bVerbose)
-	: m_maxDataVecs(maxDataVecs), m_bCount(bCount), m_bVerbose(bVerbose), m_bPhylogenetic(false), m_bGood(true), m_splitSystem(splitSystem)
+	: m_splitSystem(splitSystem), m_calcStr(calcStr), m_bGood(true), m_maxDataVecs(maxDataVecs), m_bWeighted(bWeighted), m_bCount(bCount), 
+		m_bPhylogenetic(false), m_bVerbose(bVerbose), m_bSampleStatistics(false), m_totalSplitWeight(0)
 {
 	if(calcStr == "")
 	{
@@ -46,9 +66,7 @@ DiversityCalculator::DiversityCalculator(SplitSystem& splitSystem, const std::st
 		return;
 	}
 
-	std::clock_t divCalcStart = std::clock();
-
-	m_bWeighted = bWeighted;
+	double divCalcStart = omp_get_wtime();
 
 	if(!SetCalculator(calcStr))
 	{
@@ -56,11 +74,11 @@ DiversityCalculator::DiversityCalculator(SplitSystem& splitSystem, const std::st
 		return;
 	}
 
-	std::clock_t divCalcEnd = std::clock();
+	double divCalcEnd = omp_get_wtime();
 
 	if(m_bVerbose)
 	{
-		std::cout << "  Total time to initialize diversity calculator: " << ( divCalcEnd - divCalcStart ) / (double)CLOCKS_PER_SEC << " s" << std::endl; 
+		std::cout << "  Total time to initialize diversity calculator: " << ( divCalcEnd - divCalcStart ) << " s" << std::endl; 
 		std::cout << std::endl;
 	}
 }
@@ -80,58 +98,58 @@ bool DiversityCalculator::SetCalculator(const std::string& calcStr)
 	bool bNeedTotalBranchLen = false;
 
 	if(calcStr == "Bray-Curtis" || calcStr == "BC" || calcStr == "BrayCurtis")
-		m_calculator = std::tr1::bind(&DiversityCalculator::BrayCurtis, _1, _2, _3, _4);
+		m_calculator = std::tr1::bind(&DiversityCalculator::BrayCurtis, this, _1, _2, _3, _4);
 	else if(calcStr == "Canberra")
-		m_calculator = std::tr1::bind(&DiversityCalculator::Canberra, _1, _2, _3, _4);
+		m_calculator = std::tr1::bind(&DiversityCalculator::Canberra, this, _1, _2, _3, _4);
 	else if(calcStr == "Coefficient of similarity" || calcStr == "CS" || calcStr == "CoefficientOfSimilarity")
-		m_calculator = std::tr1::bind(&DiversityCalculator::CoefficientOfSimilarity, _1, _2, _3, _4);
+		m_calculator = std::tr1::bind(&DiversityCalculator::CoefficientOfSimilarity, this, _1, _2, _3, _4);
 	else if(calcStr == "Complete tree" || calcStr == "CT" || calcStr == "CompleteTree" || calcStr == "Complete Tree")
 	{
 		bNeedColumnExtents = true;
-		m_calculator = std::tr1::bind(&DiversityCalculator::CompleteTree, _1, _2, _3, _4);
+		m_calculator = std::tr1::bind(&DiversityCalculator::CompleteTree, this, _1, _2, _3, _4);
 	}
 	else if(calcStr == "Euclidean")
-		m_calculator = std::tr1::bind(&DiversityCalculator::Euclidean, _1, _2, _3, _4);
+		m_calculator = std::tr1::bind(&DiversityCalculator::Euclidean, this, _1, _2, _3, _4);
 	else if(calcStr == "Gower")
 	{
 		bNeedColumnExtents = true;
-		m_calculator = std::tr1::bind(&DiversityCalculator::Gower, _1, _2, _3, _4);
+		m_calculator = std::tr1::bind(&DiversityCalculator::Gower, this, _1, _2, _3, _4);
 	}
 	else if(calcStr == "Kulczynski")
 	{
 		bNeedWeightedRowSums = true;
-		m_calculator = std::tr1::bind(&DiversityCalculator::Kulczynski, _1, _2, _3, _4);
+		m_calculator = std::tr1::bind(&DiversityCalculator::Kulczynski, this, _1, _2, _3, _4);
 	}
 	else if(calcStr == "Lennon compositional difference" || calcStr == "Lennon" || calcStr == "LCD")
-		m_calculator = std::tr1::bind(&DiversityCalculator::LennonCD, _1, _2, _3, _4);
+		m_calculator = std::tr1::bind(&DiversityCalculator::LennonCD, this, _1, _2, _3, _4);
 	else if(calcStr == "Manhattan")
-		m_calculator = std::tr1::bind(&DiversityCalculator::Manhattan, _1, _2, _3, _4);
+		m_calculator = std::tr1::bind(&DiversityCalculator::Manhattan, this, _1, _2, _3, _4);
 	else if(calcStr == "Morisita-Horn"|| calcStr == "MH" || calcStr == "MorisitaHorn")
 	{
 		bNeedWeightedRowSums = true;
-		m_calculator = std::tr1::bind(&DiversityCalculator::MorisitaHorn, _1, _2, _3, _4);
+		m_calculator = std::tr1::bind(&DiversityCalculator::MorisitaHorn, this, _1, _2, _3, _4);
 	}
 	else if(calcStr == "Soergel" || calcStr == "Ruzicka")
-		m_calculator = std::tr1::bind(&DiversityCalculator::Soergel, _1, _2, _3, _4);
+		m_calculator = std::tr1::bind(&DiversityCalculator::Soergel, this, _1, _2, _3, _4);
 	else if(calcStr == "Tamas coefficient" || calcStr == "TC" || calcStr == "TamasCoefficient")
 	{
 		bNeedColumnExtents = true;
-		m_calculator = std::tr1::bind(&DiversityCalculator::TamasCoefficient, _1, _2, _3, _4);
+		m_calculator = std::tr1::bind(&DiversityCalculator::TamasCoefficient, this, _1, _2, _3, _4);
 	}
 	else if(calcStr == "Weighted correlation" || calcStr == "WC" || calcStr == "WeightedCorrelation")
 	{
 		bNeedTotalBranchLen = true;
 		bNeedWeightedRowSums = true;
-		m_calculator = std::tr1::bind(&DiversityCalculator::WeightedCorrelation, _1, _2, _3, _4);
+		m_calculator = std::tr1::bind(&DiversityCalculator::WeightedCorrelation, this, _1, _2, _3, _4);
 	}
 	else if(calcStr == "Yue-Clayton" || calcStr == "YC" || calcStr == "YueClayton")
-		m_calculator = std::tr1::bind(&DiversityCalculator::YueClayton, _1, _2, _3, _4);
+		m_calculator = std::tr1::bind(&DiversityCalculator::YueClayton, this, _1, _2, _3, _4);
 	else if(calcStr == "Sum")
-		m_calculator = std::tr1::bind(&DiversityCalculator::Sum, _1, _2, _3, _4);
+		m_calculator = std::tr1::bind(&DiversityCalculator::Sum, this, _1, _2, _3, _4);
 	else if(calcStr == "Extents")
 	{
 		bNeedColumnExtents = true;
-		m_calculator = std::tr1::bind(&DiversityCalculator::Extents, _1, _2, _3, _4);
+		m_calculator = std::tr1::bind(&DiversityCalculator::Extents, this, _1, _2, _3, _4);
 	}
 	else
 	{
@@ -142,14 +160,9 @@ bool DiversityCalculator::SetCalculator(const std::string& calcStr)
 	// required to calculate intermediate terms
 	GetSplitWeights();
 
-	if(bNeedColumnExtents)
-		CalculateColumnExtents();
-
-	if(bNeedColumnSums)
-		CalculateColumnSums();
-
-	if(bNeedWeightedRowSums)
-		CalculateWeightedRowSums();
+	m_bSampleStatistics = bNeedColumnExtents || bNeedColumnSums || bNeedWeightedRowSums;
+	if(m_bSampleStatistics && !CalculateStatistics(bNeedColumnExtents, bNeedColumnSums, bNeedWeightedRowSums))
+		return false;
 
 	if(bNeedTotalBranchLen)
 	{
@@ -161,217 +174,852 @@ bool DiversityCalculator::SetCalculator(const std::string& calcStr)
 	return true;
 }
 
-void DiversityCalculator::CalculateDataVectors(uint startIndex, uint numSamples, std::vector< std::vector<double> >& dataVec)
+SplitSystem::DATA_TYPE DiversityCalculator::GetDataType() const
 {
-	std::clock_t startDataVecs = std::clock();
-	
-	// calculate data vector for each sample
+	if(m_bWeighted && !m_bCount)
+		return SplitSystem::WEIGHTED_DATA;
+	else if(m_bWeighted && m_bCount)
+		return SplitSystem::COUNT_DATA;
+
+	return SplitSystem::UNWEIGHTED_DATA;
+}
+
+bool DiversityCalculator::CalculateDataVectors(uint startIndex, uint numSamples, std::vector< std::vector<double> >& dataVec) const
+{
+	uint endIndex = std::min<uint>(m_splitSystem.GetNumSamples(), startIndex+numSamples);
+	SplitSystem::DATA_TYPE dataType = GetDataType();
+
+	// calculate data vector for each sample; each vector is allocated and first touched by
+	// the worker thread which processes the same index in the (statically scheduled) inner loop
+	// so it is placed on that worker's NUMA node
 	dataVec.clear();
-	dataVec.reserve(numSamples);
+	dataVec.resize(endIndex - startIndex);
 
-	uint endIndex;
-	if(m_splitSystem.IsOutgroup())
-		endIndex = std::min<uint>(m_splitSystem.GetNumSamples()+1, startIndex+numSamples);
-	else
-		endIndex = std::min<uint>(m_splitSystem.GetNumSamples(), startIndex+numSamples);
+	m_splitSystem.PrefetchSamples(startIndex, endIndex - startIndex);
+
+	bool bReadError = false;
 
-	for(uint sampleId = startIndex; sampleId < endIndex; ++sampleId)
+	#pragma omp parallel
 	{
-		if(sampleId == m_splitSystem.GetOutgroupSampleId())
-			continue;
+		std::vector<double> seqCount;
 
-		if(m_bWeighted && !m_bCount)
-			dataVec.push_back(m_splitSystem.GetSampleData(sampleId, SplitSystem::WEIGHTED_DATA));
-		else if(m_bWeighted && m_bCount)
-			dataVec.push_back(m_splitSystem.GetSampleData(sampleId, SplitSystem::COUNT_DATA));
-		else
-			dataVec.push_back(m_splitSystem.GetSampleData(sampleId, SplitSystem::UNWEIGHTED_DATA));
+		#pragma omp for schedule(static)
+		for(int i = 0; i < (int)dataVec.size(); ++i)
+		{
+			if(!m_splitSystem.GetSampleData(startIndex + i, dataType, dataVec[i], seqCount))
+			{
+				#pragma omp critical(ReadError)
+				bReadError = true;
+			}
+		}
 	}
 
-	std::clock_t endDataVecs = std::clock();
+	return !bReadError;
 }
 
-void DiversityCalculator::CalculateColumnExtents()
+bool DiversityCalculator::CalculateDataVectors(const std::vector<uint>& sampleIds, uint startIndex, uint numSamples, std::vector< std::vector<double> >& dataVec) const
 {
-	std::clock_t extentsStart = std::clock();
+	uint endIndex = std::min<uint>(sampleIds.size(), startIndex+numSamples);
+	SplitSystem::DATA_TYPE dataType = GetDataType();
+
+	dataVec.clear();
+	dataVec.resize(endIndex - startIndex);
 
-	m_minExtent.clear();
-	m_maxExtent.clear();
-	m_minExtent.resize(m_splitSystem.GetNumSplits(), std::numeric_limits<double>::max());
-	m_maxExtent.resize(m_splitSystem.GetNumSplits(), 0);
+	bool bReadError = false;
 
-	for(uint i = 0; i < m_splitSystem.GetNumSamples(); i += m_maxDataVecs)
+	#pragma omp parallel
 	{
-		std::vector< std::vector<double> > data;
-		CalculateDataVectors(i*m_maxDataVecs, m_maxDataVecs, data);
-	
-		for(uint j = 0; j < data.size(); ++j)
+		std::vector<double> seqCount;
+
+		#pragma omp for schedule(static)
+		for(int i = 0; i < (int)dataVec.size(); ++i)
+		{
+			if(!m_splitSystem.GetSampleData(sampleIds[startIndex + i], dataType, dataVec[i], seqCount))
+			{
+				#pragma omp critical(ReadError)
+				bReadError = true;
+			}
+		}
+	}
+
+	return !bReadError;
+}
+
+bool DiversityCalculator::CalculateStatistics(bool bColumnExtents, bool bColumnSums, bool bRowSums)
+{
+	double statsStart = omp_get_wtime();
+
+	uint numSamples = m_splitSystem.GetNumSamples();
+	uint numSplits = m_splitSystem.GetNumSplits();
+	SplitSystem::DATA_TYPE dataType = GetDataType();
+
+	if(bColumnExtents)
+	{
+		m_minExtent.assign(numSplits, std::numeric_limits<double>::max());
+		m_maxExtent.assign(numSplits, 0);
+	}
+
+	if(bColumnSums)
+		m_colSum.assign(numSplits, 0);
+
+	if(bRowSums)
+		m_weightedRowSum.assign(numSamples, 0);
+
+	// samples are read once, in file order
+	m_splitSystem.SetSampleAccessPattern(MappedFile::SEQUENTIAL_ACCESS);
+
+	bool bReadError = false;
+
+	// Samples are processed in pages of fixed size. Within a page, samples are split into blocks 
+	// of fixed size and each block is processed by a single worker. A data vector is discarded 
+	// as soon as it has contributed to all statistics, so at most one vector per worker is held.
+	for(uint pageStart = 0; pageStart < numSamples && !bReadError; pageStart += m_maxDataVecs)
+	{
+		uint pageEnd = std::min<uint>(numSamples, pageStart + m_maxDataVecs);
+		uint numBlocks = (pageEnd - pageStart + STATS_BLOCK_SIZE - 1) / STATS_BLOCK_SIZE;
+
+		// column sums are accumulated per block, independent of the number of workers
+		std::vector< std::vector<double> > partialColSums;
+		if(bColumnSums)
+			partialColSums.resize(numBlocks);
+
+		#pragma omp parallel
 		{
-			for(uint k = 0; k < data[j].size(); ++k)
+			std::vector<double> seqCount;
+			std::vector<double> minExtent;
+			std::vector<double> maxExtent;
+			if(bColumnExtents)
 			{
-				if(data[j][k] < m_minExtent[k])
-					m_minExtent[k] = data[j][k];
+				minExtent.resize(numSplits, std::numeric_limits<double>::max());
+				maxExtent.resize(numSplits, 0);
+			}
+
+			#pragma omp for schedule(static)
+			for(int b = 0; b < (int)numBlocks; ++b)
+			{
+				std::vector<double>* colSum = NULL;
+				if(bColumnSums)
+				{
+					colSum = &partialColSums[b];
+					colSum->resize(numSplits, 0);
+				}
 
-				if(data[j][k] > m_maxExtent[k])
-					m_maxExtent[k] = data[j][k];
+				uint blockEnd = std::min<uint>(pageEnd, pageStart + (b+1)*STATS_BLOCK_SIZE);
+				std::vector<double> data;
+				for(uint sampleId = pageStart + b*STATS_BLOCK_SIZE; sampleId < blockEnd; ++sampleId)
+				{
+					if(!m_splitSystem.GetSampleData(sampleId, dataType, data, seqCount))
+					{
+						#pragma omp critical(ReadError)
+						bReadError = true;
+						break;
+					}
+
+					for(uint k = 0; k < numSplits; ++k)
+					{
+						if(bColumnExtents)
+						{
+							if(data[k] < minExtent[k])
+								minExtent[k] = data[k];
+
+							if(data[k] > maxExtent[k])
+								maxExtent[k] = data[k];
+						}
+
+						if(bColumnSums)
+							(*colSum)[k] += data[k];
+
+						if(bRowSums)
+							m_weightedRowSum[sampleId] += m_splitWeights[k] * data[k];
+					}
+				}
 			}
+
+			// extents do not depend on the order in which workers are combined
+			if(bColumnExtents)
+			{
+				#pragma omp critical
+				{
+					for(uint k = 0; k < numSplits; ++k)
+					{
+						m_minExtent[k] = std::min<double>(m_minExtent[k], minExtent[k]);
+						m_maxExtent[k] = std::max<double>(m_maxExtent[k], maxExtent[k]);
+					}
+				}
+			}
+		}
+
+		// block sums are combined in block order
+		for(uint b = 0; b < partialColSums.size(); ++b)
+		{
+			for(uint k = 0; k < numSplits; ++k)
+				m_colSum[k] += partialColSums[b][k];
 		}
 	}
 
-	std::clock_t extentsEnd = std::clock();
+	m_splitSystem.SetSampleAccessPattern(MappedFile::NORMAL_ACCESS);
+
+	if(bReadError)
+	{
+		std::cerr << "Failed to read sample data." << std::endl;
+		return false;
+	}
+
+	double statsEnd = omp_get_wtime();
 
 	if(m_bVerbose)
 	{
-		std::cout << "  Time to calculate column extents: " << ( extentsEnd - extentsStart ) / (double)CLOCKS_PER_SEC << " s" << std::endl; 
+		std::cout << "  Time to calculate column and sample statistics: " << ( statsEnd - statsStart ) << " s" << std::endl; 
 		std::cout << std::endl;
 	}
+
+	return true;
+}
+
+void DiversityCalculator::GetSplitWeights()
+{
+	m_splitWeights.clear();
+	m_splitWeights.reserve(m_splitSystem.GetNumSplits());
+
+	for(uint i = 0; i < m_splitSystem.GetNumSplits(); ++i)
+		m_splitWeights.push_back(m_splitSystem.GetSplit(i).GetWeight());
 }
 
-void DiversityCalculator::CalculateColumnSums()
+uint64 DiversityCalculator::GetFingerprint(uint blockLen, const MatrixFormat& matrixFormat) const
 {
-	std::clock_t colSumStart = std::clock();
+	uint64 hash = m_splitSystem.GetFingerprint();
+	hash = HashString(m_calcStr, hash);
+
+	byte flags[2] = { m_bWeighted, m_bCount };
+	hash = HashBytes(flags, sizeof(flags), hash);
+	hash = HashBytes(&blockLen, sizeof(blockLen), hash);
+	hash = HashString(matrixFormat.format, hash);
+	hash = HashString(matrixFormat.layout, hash);
+	hash = HashString(matrixFormat.valueType, hash);
+	hash = HashString(matrixFormat.rounding, hash);
+	hash = HashString(matrixFormat.compression, hash);
+	hash = HashBytes(&matrixFormat.topK, sizeof(matrixFormat.topK), hash);
+
+	byte sparse = matrixFormat.bSparse;
+	hash = HashBytes(&sparse, sizeof(sparse), hash);
+	if(matrixFormat.bSparse)
+		hash = HashBytes(&matrixFormat.maxDissimilarity, sizeof(matrixFormat.maxDissimilarity), hash);
+	hash = HashBytes(&matrixFormat.precision, sizeof(matrixFormat.precision), hash);
+
+	byte fixedWidth = matrixFormat.bFixedWidth;
+	hash = HashBytes(&fixedWidth, sizeof(fixedWidth), hash);
+
+	return hash;
+}
 
-	m_colSum.clear();
-	m_colSum.resize(m_splitSystem.GetNumSplits(), 0);
+bool DiversityCalculator::Dissimilarity(const std::string& dissFile, bool bResume, uint checkpointInterval, 
+																				const MatrixFormat& matrixFormat, uint outputMemoryMB)
+{
+	double dissStart = omp_get_wtime();	
 
-	for(uint i = 0; i < m_splitSystem.GetNumSamples(); i += m_maxDataVecs)
+	// get blocking information
+	uint blockLen = m_maxDataVecs / 2;
+	uint numBlocks = m_splitSystem.GetNumSamples() / blockLen;
+	if(numBlocks*blockLen != m_splitSystem.GetNumSamples())
+		++numBlocks;	// extra block if samples do not fit perfectly into blocks
+
+	MatrixWriter* dissOut = MatrixWriter::Create(matrixFormat);
+	if(dissOut == NULL)
+		return false;
+
+	// determine row blocks already written by a previous run
+	std::string progressFile = dissOut->GetProgressFilename(dissFile);
+	uint64 fingerprint = GetFingerprint(blockLen, matrixFormat);
+	Checkpoint checkpoint(dissFile, fingerprint);
+	uint startBlock = 0;
+	uint64 outputSize = 0;
+	uint64 fileSize = 0;
+	if(bResume)
 	{
-		std::vector< std::vector<double> > data;
-		CalculateDataVectors(i*m_maxDataVecs, m_maxDataVecs, data);
-	
-		for(uint j = 0; j < data.size(); ++j)
+		// rows written after the last checkpoint are discarded
+		if(checkpoint.Read(startBlock, outputSize) && GetFileSize(progressFile, fileSize) 
+					&& fileSize >= outputSize && TruncateFile(progressFile, outputSize))
 		{
-			for(uint k = 0; k < data[j].size(); ++k)
-				m_colSum[k] = data[j][k];
+			if(m_bVerbose)
+				std::cout << "  Resuming from checkpoint: " << startBlock << " of " << numBlocks << " row blocks complete." << std::endl;
+		}
+		else
+		{
+			std::cout << "(Warning) Unable to resume from checkpoint, calculating full dissimilarity matrix." << std::endl;
+			bResume = false;
+			startBlock = 0;
 		}
 	}
 
-	std::clock_t colSumEnd = std::clock();
+	MatrixInfo info;
+	for(uint i = 0; i < m_splitSystem.GetNumSamples(); ++i)
+		info.sampleNames.push_back(m_splitSystem.GetSampleName(i));
+	info.calculator = m_calcStr;
+	info.bWeighted = m_bWeighted;
+	info.bCount = m_bCount;
+	info.inputFingerprint = m_splitSystem.GetFingerprint();
+	info.fingerprint = fingerprint;
+
+	// open dissimilarity file, keeping rows from completed blocks when resuming
+	if(!dissOut->Open(dissFile, info, bResume, outputSize))
+	{
+		std::cerr << "Unable to open dissimilarity matrix file: " << dissFile << std::endl;
+		delete dissOut;
+		return false;
+	}
 
-	if(m_bVerbose)
+	// header is written when the file is opened
+	if(!bResume && (!dissOut->Sync() || !checkpoint.Record(0, dissOut->GetOffset())))
 	{
-		std::cout << "  Time to calculate column sums: " << ( colSumEnd - colSumStart ) / (double)CLOCKS_PER_SEC << " s" << std::endl; 
-		std::cout << std::endl;
+		dissOut->Close();
+		delete dissOut;
+		return false;
 	}
-}
 
-void DiversityCalculator::CalculateWeightedRowSums()
-{
-	std::clock_t weightedRowSumStart = std::clock();
+	std::time_t lastCheckpoint = std::time(NULL);
+
+	// unless the writer is positional, rows of a block are calculated and written in strips whose values fit in the output memory budget
+	uint64 maxStripValues = (uint64)outputMemoryMB * 1024 * 1024 / sizeof(double);
+	std::vector<double> strip;
 
-	m_weightedRowSum.clear();
-	m_weightedRowSum.resize(m_splitSystem.GetNumSamples(), 0);
+	// pairs of each row of the current block kept in a sparse matrix
+	std::vector< std::vector<MatrixEdge> > rowEdges;
 
-	for(uint i = 0; i < m_splitSystem.GetNumSamples(); i += m_maxDataVecs)
+	// data vectors for the rows and columns of the block currently being processed
+	std::vector< std::vector<double> > dataVecRows;
+	std::vector< std::vector<double> > dataVecCols;
+
+	bool bReadError = false;
+	bool bWriteError = false;
+	double innerLoopTime = 0;
+	for(uint row = startBlock; row < numBlocks; ++row)
 	{
-		std::vector< std::vector<double> > data;
-		CalculateDataVectors(i*m_maxDataVecs, m_maxDataVecs, data);
-	
-		for(uint j = 0; j < data.size(); ++j)
+		if(!CalculateDataVectors(row*blockLen, blockLen, dataVecRows))
+		{
+			bReadError = true;
+			break;
+		}
+
+		uint firstRow = row*blockLen;
+		uint numStrips = 0;
+		if(matrixFormat.bSparse)
+		{
+			// only pairs within the threshold are kept, so the rows of the block are never materialized
+			rowEdges.clear();
+			rowEdges.resize(dataVecRows.size());
+			for(uint col = 0; col <= row; ++col)
+			{
+				const std::vector< std::vector<double> >* dataVecs = &dataVecRows;
+				if(col != row)
+				{
+					if(!CalculateDataVectors(col*blockLen, blockLen, dataVecCols))
+					{
+						bReadError = true;
+						break;
+					}
+					dataVecs = &dataVecCols;
+				}
+
+				double innerDissLoopStart = omp_get_wtime();	
+
+				#pragma omp parallel for schedule(static)
+				for(int r = 0; r < (int)dataVecRows.size(); ++r)
+				{
+					uint colStop = dataVecs->size();
+					if(col == row)
+						colStop = std::min<uint>(r, dataVecs->size());
+
+					for(uint c = 0; c < colStop; ++c)
+					{
+						double value = m_calculator(dataVecRows[r], (*dataVecs)[c], firstRow + r, col*blockLen + c);
+						if(value <= matrixFormat.maxDissimilarity)
+							rowEdges[r].push_back(MatrixEdge(col*blockLen + c, value));
+					}
+				}
+
+				double innerDissLoopEnd = omp_get_wtime();	
+				innerLoopTime += (innerDissLoopEnd - innerDissLoopStart);
+			}
+
+			if(!bReadError)
+				dissOut->WriteEdges(firstRow, rowEdges);
+		}
+		else if(dissOut->IsPositional())
+		{
+			// each thread writes the segments of its rows directly at their offsets in the file
+			for(uint col = 0; col <= row; ++col)
+			{
+				const std::vector< std::vector<double> >* dataVecs = &dataVecRows;
+				if(col != row)
+				{
+					if(!CalculateDataVectors(col*blockLen, blockLen, dataVecCols))
+					{
+						bReadError = true;
+						break;
+					}
+					dataVecs = &dataVecCols;
+				}
+
+				double innerDissLoopStart = omp_get_wtime();	
+
+				WriteBlockSegments(dissOut, firstRow, dataVecRows, col*blockLen, *dataVecs, col == row);
+
+				double innerDissLoopEnd = omp_get_wtime();	
+				innerLoopTime += (innerDissLoopEnd - innerDissLoopStart);
+			}
+
+			if(!bReadError)
+				dissOut->CompleteRows(firstRow + dataVecRows.size());
+		}
+		else
+		{
+			for(uint stripStart = 0; stripStart < dataVecRows.size(); )
+			{
+				// largest strip whose rows, each as long as the last, fit in the budget
+				uint stripLen = 1;
+				while(stripStart + stripLen < dataVecRows.size() 
+								&& (uint64)(stripLen+1)*(firstRow + stripStart + stripLen + 1) <= maxStripValues)
+					stripLen++;
+
+				uint64 rowStride = firstRow + stripStart + stripLen;
+				strip.resize(stripLen*rowStride);
+				numStrips++;
+
+				for(uint col = 0; col <= row; ++col)
+				{
+					// data vectors of the diagonal block are those of the rows
+					const std::vector< std::vector<double> >* dataVecs = &dataVecRows;
+					if(col != row)
+					{
+						if(!CalculateDataVectors(col*blockLen, blockLen, dataVecCols))
+						{
+							bReadError = true;
+							break;
+						}
+						dataVecs = &dataVecCols;
+					}
+
+					double innerDissLoopStart = omp_get_wtime();	
+
+					#pragma omp parallel for schedule(static)
+					for(int s = 0; s < (int)stripLen; ++s)
+					{
+						uint r = stripStart + s;
+						uint colStop = dataVecs->size();
+						if(col == row)
+							colStop = std::min<uint>(r, dataVecs->size());
+
+						double* stripRow = &strip[0] + s*rowStride + (uint64)col*blockLen;
+						for(uint c = 0; c < colStop; ++c)
+							stripRow[c] = m_calculator(dataVecRows[r], (*dataVecs)[c], firstRow + r, col*blockLen + c);
+					}
+
+					double innerDissLoopEnd = omp_get_wtime();	
+					innerLoopTime += (innerDissLoopEnd - innerDissLoopStart);
+				}
+
+				if(bReadError)
+					break;
+
+				// completed rows are written in order
+				dissOut->WriteRows(firstRow + stripStart, stripLen, &strip[0], rowStride);
+
+				stripStart += stripLen;
+			}
+		}
+
+		if(bReadError)
+			break;
+
+		if(m_bVerbose && numStrips > 1)
+			std::cout << "  Rows " << firstRow << " to " << firstRow + dataVecRows.size() - 1 << " written in " << numStrips << " strips to fit output memory." << std::endl;
+
+		// output must be on disk so all rows of completed blocks survive the machine failing
+		if(std::time(NULL) - lastCheckpoint >= (std::time_t)checkpointInterval && row+1 < numBlocks)
 		{
-			for(uint k = 0; k < data[j].size(); ++k)
-				m_weightedRowSum[j] += m_splitWeights[k] * data[j][k];
+			if(!dissOut->Sync() || !checkpoint.Record(row+1, dissOut->GetOffset()))
+			{
+				bWriteError = true;
+				break;
+			}
+
+			lastCheckpoint = std::time(NULL);
 		}
 	}
 
-	std::clock_t weightedRowSumEnd = std::clock();
+	bool bClosed = dissOut->Close();
+	if(m_bVerbose && bClosed && !bWriteError && !bReadError)
+		dissOut->Report();
+	delete dissOut;
+
+	// rows of completed blocks are kept, so the run can be resumed from the last checkpoint
+	if(bReadError)
+	{
+		std::cerr << "Failed to read sample data, dissimilarity matrix is incomplete: " << dissFile << std::endl;
+		return false;
+	}
+
+	if(!bClosed || bWriteError)
+	{
+		std::cerr << "Failed to write dissimilarity matrix file: " << dissFile << std::endl;
+		return false;
+	}
+
+	checkpoint.Remove();
+
+	double dissEnd = omp_get_wtime();
 
 	if(m_bVerbose)
 	{
-		std::cout << "  Time to calculate weighted row sums: " << ( weightedRowSumEnd - weightedRowSumStart ) / (double)CLOCKS_PER_SEC << " s" << std::endl; 
+		std::cout << std::endl;
+		std::cout << "  Total time to calculate inner loop of dissimilarity matrix: " << innerLoopTime << " s" << std::endl; 
+		std::cout << "  Total time to calculate dissimilarity matrix: " << (dissEnd - dissStart) << " s" << std::endl; 
 		std::cout << std::endl;
 	}
+
+	return true;
 }
 
-void DiversityCalculator::GetSplitWeights()
+bool DiversityCalculator::NearestNeighbors(const std::string& neighborsFile, const MatrixFormat& matrixFormat)
 {
-	m_splitWeights.clear();
-	m_splitWeights.reserve(m_splitSystem.GetNumSplits());
+	double neighborsStart = omp_get_wtime();	
 
-	for(uint i = 0; i < m_splitSystem.GetNumSplits(); ++i)
-		m_splitWeights.push_back(m_splitSystem.GetSplit(i).GetWeight());
-}
+	uint k = matrixFormat.topK;
+	uint numSamples = m_splitSystem.GetNumSamples();
+	uint blockLen = m_maxDataVecs / 2;
+	uint numBlocks = numSamples / blockLen;
+	if(numBlocks*blockLen != numSamples)
+		++numBlocks;
 
-bool DiversityCalculator::Dissimilarity(const std::string& dissFile)
-{
-	std::clock_t dissStart = std::clock();	
+	MatrixWriter* neighborsOut = MatrixWriter::Create(matrixFormat);
+	if(neighborsOut == NULL)
+		return false;
+
+	MatrixInfo info;
+	for(uint i = 0; i < numSamples; ++i)
+		info.sampleNames.push_back(m_splitSystem.GetSampleName(i));
+	info.calculator = m_calcStr;
+	info.bWeighted = m_bWeighted;
+	info.bCount = m_bCount;
+	info.inputFingerprint = m_splitSystem.GetFingerprint();
+	info.fingerprint = GetFingerprint(blockLen, matrixFormat);
 
-	// open dissimilarity file
-	std::ofstream dissOut(dissFile.c_str());
-	if(!dissOut.is_open())
+	if(!neighborsOut->Open(neighborsFile, info))
 	{
-		std::cerr << "Unable to open dissimilarity matrix file: " << dissFile << std::endl;
+		std::cerr << "Unable to open nearest neighbors file: " << neighborsFile << std::endl;
+		delete neighborsOut;
 		return false;
 	}
 
-	// get blocking information
-	uint blockLen = m_maxDataVecs / 2;
-	uint numBlocks = m_splitSystem.GetNumSamples() / blockLen;
-	if(numBlocks*blockLen != m_splitSystem.GetNumSamples())
-		++numBlocks;	// extra block if samples do not fit perfectly into blocks
+	std::vector< std::vector<Neighbor> > heaps(numSamples);
 
-	// calculate dissimilarity
-	dissOut << m_splitSystem.GetNumSamples() << std::endl;
+	// dissimilarities of the block currently being processed
+	std::vector<double> tile;
 
-	double* partialDissMatrix = new double[blockLen*m_splitSystem.GetNumSamples()];
+	std::vector< std::vector<double> > dataVecRows;
+	std::vector< std::vector<double> > dataVecCols;
 
+	bool bReadError = false;
 	double innerLoopTime = 0;
-	for(uint row = 0; row < numBlocks; ++row)
+	for(uint row = 0; row < numBlocks && !bReadError; ++row)
 	{
-		CalculateDataVectors(row*blockLen, blockLen, m_dataVecRows);
+		if(!CalculateDataVectors(row*blockLen, blockLen, dataVecRows))
+		{
+			bReadError = true;
+			break;
+		}
+		uint firstRow = row*blockLen;
 
 		for(uint col = 0; col <= row; ++col)
 		{
-			CalculateDataVectors(col*blockLen, blockLen, m_dataVecCols);
-
-			std::clock_t innerDissLoopStart = std::clock();	
-			for(uint r = 0; r < m_dataVecRows.size(); ++r)
+			const std::vector< std::vector<double> >* dataVecs = &dataVecRows;
+			if(col != row)
 			{
-				uint colStop = m_dataVecCols.size();
-				if(row == 0)
-					colStop = std::min<uint>(r, m_dataVecCols.size());
+				if(!CalculateDataVectors(col*blockLen, blockLen, dataVecCols))
+				{
+					bReadError = true;
+					break;
+				}
+				dataVecs = &dataVecCols;
+			}
 
+			double innerLoopStart = omp_get_wtime();	
+
+			uint numCols = dataVecs->size();
+			tile.resize((uint64)dataVecRows.size()*numCols);
+
+			// each dissimilarity is a candidate neighbor of both samples, so the heaps of the rows 
+			// and the heaps of the columns are updated in separate passes to give each heap a single writer
+			#pragma omp parallel for schedule(static)
+			for(int r = 0; r < (int)dataVecRows.size(); ++r)
+			{
+				uint colStop = (col == row) ? std::min<uint>(r, numCols) : numCols;
 				for(uint c = 0; c < colStop; ++c)
 				{
-					double diss = m_calculator(m_dataVecRows[r], m_dataVecCols[c], r, c);
-					partialDissMatrix[r*m_splitSystem.GetNumSamples() + col*blockLen + c] = diss;
+					double value = m_calculator(dataVecRows[r], (*dataVecs)[c], firstRow + r, col*blockLen + c);
+					tile[(uint64)r*numCols + c] = value;
+					AddNeighbor(heaps[firstRow + r], k, value, col*blockLen + c);
 				}
 			}
 
-			std::clock_t innerDissLoopEnd = std::clock();	
-			innerLoopTime += (innerDissLoopEnd - innerDissLoopStart);
+			#pragma omp parallel for schedule(static)
+			for(int c = 0; c < (int)numCols; ++c)
+			{
+				uint rowStart = (col == row) ? c + 1 : 0;
+				for(uint r = rowStart; r < dataVecRows.size(); ++r)
+					AddNeighbor(heaps[col*blockLen + c], k, tile[(uint64)r*numCols + c], firstRow + r);
+			}
+
+			double innerLoopEnd = omp_get_wtime();	
+			innerLoopTime += (innerLoopEnd - innerLoopStart);
+		}
+	}
+
+	if(bReadError)
+	{
+		neighborsOut->Close();
+		delete neighborsOut;
+		std::cerr << "Failed to read sample data, nearest neighbors file is incomplete: " << neighborsFile << std::endl;
+		return false;
+	}
+
+	// write neighbors from nearest to farthest, a batch of samples at a time
+	std::vector< std::vector<MatrixEdge> > neighbors;
+	for(uint firstRow = 0; firstRow < numSamples; firstRow += NEIGHBOR_BATCH_SIZE)
+	{
+		uint endRow = std::min<uint>(firstRow + NEIGHBOR_BATCH_SIZE, numSamples);
+		neighbors.resize(endRow - firstRow);
+
+		#pragma omp parallel for schedule(static)
+		for(int i = (int)firstRow; i < (int)endRow; ++i)
+		{
+			std::vector<Neighbor>& heap = heaps[i];
+			std::sort_heap(heap.begin(), heap.end());
+
+			std::vector<MatrixEdge>& sampleNeighbors = neighbors[i - firstRow];
+			sampleNeighbors.clear();
+			for(uint n = 0; n < heap.size(); ++n)
+				sampleNeighbors.push_back(MatrixEdge(heap[n].second, heap[n].first));
+
+			std::vector<Neighbor>().swap(heap);
+		}
+
+		neighborsOut->WriteEdges(firstRow, neighbors);
+	}
+
+	bool bClosed = neighborsOut->Close();
+	delete neighborsOut;
+
+	if(!bClosed)
+	{
+		std::cerr << "Failed to write nearest neighbors file: " << neighborsFile << std::endl;
+		return false;
+	}
+
+	double neighborsEnd = omp_get_wtime();
+
+	if(m_bVerbose)
+	{
+		std::cout << std::endl;
+		std::cout << "  Total time to calculate inner loop of nearest neighbors: " << innerLoopTime << " s" << std::endl; 
+		std::cout << "  Total time to find nearest neighbors: " << (neighborsEnd - neighborsStart) << " s" << std::endl; 
+		std::cout << std::endl;
+	}
+
+	return true;
+}
+
+void DiversityCalculator::WriteBlockSegments(MatrixWriter* out, uint firstRow, const std::vector< std::vector<double> >& dataVecRows,
+																										uint firstCol, const std::vector< std::vector<double> >& dataVecCols, bool bDiagonal) const
+{
+	// each thread writes the segments of its rows directly at their offsets in the file
+	#pragma omp parallel
+	{
+		std::vector<double> segment;
+		std::vector<char> buffer;
+
+		#pragma omp for schedule(static)
+		for(int r = 0; r < (int)dataVecRows.size(); ++r)
+		{
+			uint colStop = dataVecCols.size();
+			if(bDiagonal)
+				colStop = std::min<uint>(r, dataVecCols.size());
+
+			segment.resize(colStop + 1);
+			for(uint c = 0; c < colStop; ++c)
+				segment[c] = m_calculator(dataVecRows[r], dataVecCols[c], firstRow + r, firstCol + c);
+
+			out->WriteSegment(firstRow + r, firstCol, colStop, &segment[0], buffer);
+		}
+	}
+}
+
+bool DiversityCalculator::UpdateStore(const std::string& storeFile, const MatrixFormat& matrixFormat)
+{
+	double storeStart = omp_get_wtime();	
+
+	if(m_bSampleStatistics)
+	{
+		std::cerr << "The " << m_calcStr << " calculator depends on statistics over all samples, so it cannot be used with a matrix store." << std::endl;
+		return false;
+	}
+
+	// store is always a condensed .npy matrix
+	MatrixFormat storeFormat;
+	storeFormat.format = "npy";
+	storeFormat.valueType = matrixFormat.valueType;
+	storeFormat.rounding = matrixFormat.rounding;
+	NpyMatrixWriter* storeOut = static_cast<NpyMatrixWriter*>(MatrixWriter::Create(storeFormat));
+	if(storeOut == NULL)
+		return false;
+
+	// data vectors and dissimilarities of stored samples must not depend on the current sample file
+	uint64 splitsFingerprint = m_splitSystem.GetSplitsFingerprint(HASH_SEED);
+
+	std::string dataStr = m_bWeighted ? (m_bCount ? "count" : "weighted") : "unweighted";
+	std::string settings = m_calcStr + ", " + dataStr + ", " + storeFormat.valueType + ", " + storeFormat.rounding + " rounding";
+	uint64 fingerprint = HashString(settings, splitsFingerprint);
+
+	MatrixStore store(storeFile, splitsFingerprint, m_splitSystem.GetNumSplits(), settings);
+	if(!store.Open())
+	{
+		delete storeOut;
+		return false;
+	}
+
+	// samples not yet in the store are appended in the order of the sample file
+	uint numStored = store.GetNumSamples();
+	std::vector<std::string> sampleNames = store.GetSampleNames();
+	std::set<std::string> storedNames(sampleNames.begin(), sampleNames.end());
+	std::vector<uint> newSampleIds;
+	for(uint i = 0; i < m_splitSystem.GetNumSamples(); ++i)
+	{
+		if(storedNames.insert(m_splitSystem.GetSampleName(i)).second)
+		{
+			newSampleIds.push_back(i);
+			sampleNames.push_back(m_splitSystem.GetSampleName(i));
 		}
+	}
+
+	if(m_bVerbose)
+		std::cout << "  Matrix store has " << numStored << " samples, appending " << newSampleIds.size() << " new samples." << std::endl;
+
+	MatrixInfo info;
+	info.sampleNames = sampleNames;
+	info.calculator = m_calcStr;
+	info.bWeighted = m_bWeighted;
+	info.bCount = m_bCount;
+	info.inputFingerprint = m_splitSystem.GetFingerprint();
+	info.fingerprint = fingerprint;
+
+	// rows written after the last commit are discarded
+	bool bOpened = storeOut->Open(storeFile, info, numStored > 0, 0);
+	uint64 committedSize = storeOut->GetRowOffset(numStored);
+	uint64 fileSize = 0;
+	if(bOpened && numStored > 0)
+		bOpened = GetFileSize(storeFile, fileSize) && fileSize >= committedSize && TruncateFile(storeFile, committedSize);
+
+	// header and sidecar file describe only committed samples until new rows are committed, repairing an interrupted update
+	if(bOpened && numStored > 0)
+		bOpened = storeOut->UpdateHeader(numStored);
+
+	if(!bOpened)
+	{
+		std::cerr << "Unable to open matrix of store: " << storeFile << std::endl;
+		delete storeOut;
+		return false;
+	}
+
+	// data vectors for the rows and columns of the block currently being processed
+	std::vector< std::vector<double> > dataVecRows;
+	std::vector< std::vector<double> > dataVecCols;
 
-		// write out partial dissimilarity matrix to file
-		for(uint r = 0; r < m_dataVecRows.size(); ++r)
+	bool bReadError = false;
+	bool bWriteError = false;
+	double innerLoopTime = 0;
+	uint blockLen = m_maxDataVecs / 2;
+	for(uint newStart = 0; newStart < newSampleIds.size(); newStart += blockLen)
+	{
+		if(!CalculateDataVectors(newSampleIds, newStart, blockLen, dataVecRows))
 		{
-			dissOut << m_splitSystem.GetSampleName(row*blockLen + r);
+			bReadError = true;
+			break;
+		}
+		uint firstRow = numStored + newStart;
 
-			for(uint c = 0; c < (row*blockLen + r); ++c)
-				dissOut << '\t' << partialDissMatrix[r*m_splitSystem.GetNumSamples() + c];
+		// columns of stored samples use their cached data vectors
+		for(uint firstCol = 0; firstCol < firstRow; firstCol += dataVecCols.size())
+		{
+			if(firstCol < numStored)
+				store.GetDataVectors(firstCol, std::min<uint>(blockLen, numStored - firstCol), dataVecCols);
+			else if(!CalculateDataVectors(newSampleIds, firstCol - numStored, blockLen, dataVecCols))
+			{
+				bReadError = true;
+				break;
+			}
 
-			dissOut << std::endl;
+			double innerDissLoopStart = omp_get_wtime();	
+			WriteBlockSegments(storeOut, firstRow, dataVecRows, firstCol, dataVecCols, false);
+			innerLoopTime += (omp_get_wtime() - innerDissLoopStart);
+		}
+
+		if(bReadError)
+			break;
+
+		double innerDissLoopStart = omp_get_wtime();	
+		WriteBlockSegments(storeOut, firstRow, dataVecRows, firstRow, dataVecRows, true);
+		innerLoopTime += (omp_get_wtime() - innerDissLoopStart);
+
+		// rows and data vectors must be on disk before the samples are committed
+		uint numCommitted = firstRow + dataVecRows.size();
+		storeOut->CompleteRows(numCommitted);
+		if(!storeOut->Sync() || !store.AppendDataVectors(dataVecRows) 
+					|| !storeOut->UpdateHeader(numCommitted) || !store.Commit(sampleNames, numCommitted))
+		{
+			bWriteError = true;
+			break;
 		}
 	}
 
-	dissOut.close();
+	// index is rewritten even if there are no new samples so an interrupted update is repaired
+	if(!bReadError && !bWriteError && newSampleIds.empty())
+		bWriteError = !store.Commit(sampleNames, numStored);
 
-	delete[] partialDissMatrix;
+	bool bClosed = storeOut->Close();
+	if(m_bVerbose && bClosed && !bWriteError && !bReadError)
+		storeOut->Report();
+	delete storeOut;
 
-	std::clock_t dissEnd = std::clock();
+	// samples committed before the failure remain in the store
+	if(bReadError)
+	{
+		std::cerr << "Failed to read sample data, matrix store was only partially updated: " << storeFile << std::endl;
+		return false;
+	}
+
+	if(!bClosed || bWriteError)
+	{
+		std::cerr << "Failed to write matrix store: " << storeFile << std::endl;
+		return false;
+	}
+
+	double storeEnd = omp_get_wtime();
 
 	if(m_bVerbose)
 	{
+		if(newSampleIds.empty())
+			std::cout << "  Matrix store is up to date." << std::endl;
+
 		std::cout << std::endl;
-		std::cout << "  Total time to calculate inner loop of dissimilarity matrix: " << innerLoopTime / (double)CLOCKS_PER_SEC << " s" << std::endl; 
-		std::cout << "  Total time to calculate dissimilarity matrix: " << (dissEnd - dissStart) / (double)CLOCKS_PER_SEC << " s" << std::endl; 
+		std::cout << "  Total time to calculate inner loop of matrix store: " << innerLoopTime << " s" << std::endl; 
+		std::cout << "  Total time to update matrix store: " << (storeEnd - storeStart) << " s" << std::endl; 
 		std::cout << std::endl;
 	}
 
 	return true;
 }
 
-double DiversityCalculator::BrayCurtis(const std::vector<double>& com1, const std::vector<double>& com2, uint i, uint j)
+double DiversityCalculator::BrayCurtis(const std::vector<double>& com1, const std::vector<double>& com2, uint i, uint j) const
 {
 	double num = 0;
 	double den = 0;
@@ -384,7 +1032,7 @@ double DiversityCalculator::BrayCurtis(const std::vector<double>& com1, const st
 	return num / den;
 }
 
-double DiversityCalculator::Canberra(const std::vector<double>& com1, const std::vector<double>& com2, uint i, uint j)
+double DiversityCalculator::Canberra(const std::vector<double>& com1, const std::vector<double>& com2, uint i, uint j) const
 {
 	double diss = 0;
 	for(uint n = 0; n < com1.size(); ++n)
@@ -397,7 +1045,7 @@ double DiversityCalculator::Canberra(const std::vector<double>& com1, const std:
 	return diss;
 }
 
-double DiversityCalculator::CoefficientOfSimilarity(const std::vector<double>& com1, const std::vector<double>& com2, uint i, uint j)
+double DiversityCalculator::CoefficientOfSimilarity(const std::vector<double>& com1, const std::vector<double>& com2, uint i, uint j) const
 {
 	double diss = 0;
 	for(uint n = 0; n < com1.size(); ++n)
@@ -410,7 +1058,7 @@ double DiversityCalculator::CoefficientOfSimilarity(const std::vector<double>& c
 	return diss;
 }
 
-double DiversityCalculator::CompleteTree(const std::vector<double>& com1, const std::vector<double>& com2, uint i, uint j)
+double DiversityCalculator::CompleteTree(const std::vector<double>& com1, const std::vector<double>& com2, uint i, uint j) const
 {
 	double num = 0;
 	double den = 0;
@@ -426,7 +1074,7 @@ double DiversityCalculator::CompleteTree(const std::vector<double>& com1, const
 	return num / den;
 }
 
-double DiversityCalculator::Euclidean(const std::vector<double>& com1, const std::vector<double>& com2, uint i, uint j)
+double DiversityCalculator::Euclidean(const std::vector<double>& com1, const std::vector<double>& com2, uint i, uint j) const
 {
 	double diss = 0;
 	for(uint n = 0; n < com1.size(); ++n)
@@ -438,7 +1086,7 @@ double DiversityCalculator::Euclidean(const std::vector<double>& com1, const std
 	return sqrt(diss);
 }
 
-double DiversityCalculator::Gower(const std::vector<double>& com1, const std::vector<double>& com2, uint i, uint j)
+double DiversityCalculator::Gower(const std::vector<double>& com1, const std::vector<double>& com2, uint i, uint j) const
 {
 	double diss = 0;
 	for(uint n = 0; n < com1.size(); ++n)
@@ -451,7 +1099,7 @@ double DiversityCalculator::Gower(const std::vector<double>& com1, const std::ve
 	return diss;
 }
 
-double DiversityCalculator::Kulczynski(const std::vector<double>& com1, const std::vector<double>& com2, uint i, uint j)
+double DiversityCalculator::Kulczynski(const std::vector<double>& com1, const std::vector<double>& com2, uint i, uint j) const
 {
 	double sumMin = 0;
 	for(uint n = 0; n < com1.size(); ++n)
@@ -460,7 +1108,7 @@ double DiversityCalculator::Kulczynski(const std::vector<double>& com1, const st
 	return 1 - 0.5*(sumMin/m_weightedRowSum[i] + sumMin/m_weightedRowSum[j]);
 }
 
-double DiversityCalculator::LennonCD(const std::vector<double>& com1, const std::vector<double>& com2, uint i, uint j)
+double DiversityCalculator::LennonCD(const std::vector<double>& com1, const std::vector<double>& com2, uint i, uint j) const
 {
 	double A = 0;
 	double B = 0;
@@ -475,7 +1123,7 @@ double DiversityCalculator::LennonCD(const std::vector<double>& com1, const std:
 	return std::min<double>(B, C) / (std::min<double>(B, C) + A);
 }
 
-double DiversityCalculator::Manhattan(const std::vector<double>& com1, const std::vector<double>& com2, uint i, uint j)
+double DiversityCalculator::Manhattan(const std::vector<double>& com1, const std::vector<double>& com2, uint i, uint j) const
 {
 	double diss = 0;
 	for(uint n = 0; n < com1.size(); ++n)
@@ -484,7 +1132,7 @@ double DiversityCalculator::Manhattan(const std::vector<double>& com1, const std
 	return diss;
 }
 
-double DiversityCalculator::MorisitaHorn(const std::vector<double>& com1, const std::vector<double>& com2, uint i, uint j)
+double DiversityCalculator::MorisitaHorn(const std::vector<double>& com1, const std::vector<double>& com2, uint i, uint j) const
 {
 	double prodSum = 0;
 	double com1SumSqrd = 0;
@@ -503,7 +1151,7 @@ double DiversityCalculator::MorisitaHorn(const std::vector<double>& com1, const
 	return 1.0 - num / den;
 }
 
-double DiversityCalculator::WeightedCorrelation(const std::vector<double>& com1, const std::vector<double>& com2, uint i, uint j)
+double DiversityCalculator::WeightedCorrelation(const std::vector<double>& com1, const std::vector<double>& com2, uint i, uint j) const
 {
 	double meanCol1 = m_weightedRowSum[i] / m_totalSplitWeight;
 	double meanCol2 = m_weightedRowSum[j] / m_totalSplitWeight;
@@ -533,7 +1181,7 @@ double DiversityCalculator::WeightedCorrelation(const std::vector<double>& com1,
 	return diss;
 }
 
-double DiversityCalculator::Soergel(const std::vector<double>& com1, const std::vector<double>& com2, uint i, uint j)
+double DiversityCalculator::Soergel(const std::vector<double>& com1, const std::vector<double>& com2, uint i, uint j) const
 {
 	double num = 0;
 	double den = 0;
@@ -546,7 +1194,7 @@ double DiversityCalculator::Soergel(const std::vector<double>& com1, const std::
 	return num / den;
 }
 
-double DiversityCalculator::TamasCoefficient(const std::vector<double>& com1, const std::vector<double>& com2, uint i, uint j)
+double DiversityCalculator::TamasCoefficient(const std::vector<double>& com1, const std::vector<double>& com2, uint i, uint j) const
 {
 	double num = 0;
 	double den = 0;
@@ -559,7 +1207,7 @@ double DiversityCalculator::TamasCoefficient(const std::vector<double>& com1, co
 	return num / den;
 }
 
-double DiversityCalculator::YueClayton(const std::vector<double>& com1, const std::vector<double>& com2, uint i, uint j)
+double DiversityCalculator::YueClayton(const std::vector<double>& com1, const std::vector<double>& com2, uint i, uint j) const
 {
 	double num = 0;
 	double den = 0;
@@ -574,7 +1222,7 @@ double DiversityCalculator::YueClayton(const std::vector<double>& com1, const st
 	return 1.0 - num / den;
 }
 
-double DiversityCalculator::Sum(const std::vector<double>& com1, const std::vector<double>& com2, uint i, uint j)
+double DiversityCalculator::Sum(const std::vector<double>& com1, const std::vector<double>& com2, uint i, uint j) const
 {
 	double sum = 0;
 	for(uint n = 0; n < com1.size(); ++n)
@@ -583,7 +1231,7 @@ double DiversityCalculator::Sum(const std::vector<double>& com1, const std::vect
 	return sum;
 }
 
-double DiversityCalculator::Extents(const std::vector<double>& com1, const std::vector<double>& com2, uint i, uint j)
+double DiversityCalculator::Extents(const std::vector<double>& com1, const std::vector<double>& com2, uint i, uint j) const
 {
 	double extents = 0;
 	for(uint n = 0; n < com1.size(); ++n)
@@ -26,6 +26,8 @@
 #include "Precompiled.hpp"
 
 #include "SplitSystem.hpp"
+#include "MatrixWriter.hpp"
+
 /**
  * @brief Measure beta-diversity with a variety of calculators.
  */
@@ -33,7 +35,7 @@ class DiversityCalculator
 {
 public:		
 	/** Constructor. */
-	DiversityCalculator(SplitSystem& splitSystem, const std::string& calcStr, 
+	DiversityCalculator(const SplitSystem& splitSystem, const std::string& calcStr, 
 													bool bWeighted, bool bCount = false, uint maxDataVecs = 1000, bool bVerbose = false);
 
 	/** Destructor. */
@@ -42,51 +44,133 @@ public:
 	/** Check good flag. */
 	bool IsGood() const { return m_bGood; }
 
-	/** Calculate dissimilarity between all pairs of samples. */
-	bool Dissimilarity(const std::string& dissFile);
+	/** 
+	 * @brief Calculate dissimilarity between all pairs of samples.
+	 *
+	 * Progress is recorded in a sidecar checkpoint file (<dissFile>.ckpt) after a block of 
+	 * rows is written once at least checkpointInterval seconds have passed since the last 
+	 * checkpoint. The sidecar file is removed once the matrix is complete.
+	 *
+	 * @param dissFile File to write dissimilarity matrix to.
+	 * @param bResume Skip row blocks recorded in an existing checkpoint and append remaining rows.
+	 * @param checkpointInterval Minimum number of seconds between checkpoints.
+	 * @param matrixFormat Format of dissimilarity matrix file.
+	 * @param outputMemoryMB Memory for dissimilarities waiting to be written. Rows of a block are calculated in strips 
+	 *                        which fit in this memory, which requires reading the data vectors of columns once per strip.
+	 */
+	bool Dissimilarity(const std::string& dissFile, bool bResume = false, uint checkpointInterval = 60, 
+											const MatrixFormat& matrixFormat = MatrixFormat(), uint outputMemoryMB = 1024);
+
+	/** Get fingerprint of input data and settings that determine a dissimilarity matrix calculated in blocks of blockLen rows. */
+	uint64 GetFingerprint(uint blockLen, const MatrixFormat& matrixFormat) const;
+
+	/** 
+	 * @brief Find the nearest neighbors of each sample.
+	 *
+	 * A bounded heap of the matrixFormat.topK nearest samples is kept for each sample while 
+	 * blocks of dissimilarities are calculated, so memory grows with the number of samples 
+	 * times the number of neighbors rather than with the full matrix. Ties are broken in 
+	 * favour of samples which come first. Neighbors are only known once all blocks are 
+	 * calculated, so no checkpoints are recorded.
+	 *
+	 * @param neighborsFile File to write the neighbors of each sample to.
+	 * @param matrixFormat Format of file, with topK giving the number of neighbors.
+	 */
+	bool NearestNeighbors(const std::string& neighborsFile, const MatrixFormat& matrixFormat);
+
+	/** 
+	 * @brief Append samples not yet in a matrix store to the store.
+	 *
+	 * Only the rows of new samples are calculated. Columns of samples already in the store 
+	 * use their cached data vectors, so these samples need not be in the sample file. Rows are 
+	 * committed a block at a time, so an interrupted update is continued by running it again.
+	 * Calculators which depend on statistics over all samples are not supported as adding 
+	 * samples would change existing dissimilarities.
+	 *
+	 * @param storeFile Matrix file of store.
+	 * @param matrixFormat Format of dissimilarity matrix, of which only the .npy value type and rounding are used.
+	 */
+	bool UpdateStore(const std::string& storeFile, const MatrixFormat& matrixFormat);
 
 private:
 	/** Set desired calculator. */
 	bool SetCalculator(const std::string& calcStr);
 
-	/** Calculate data vectors . */
-	void CalculateDataVectors(uint startIndex, uint numSamples, std::vector< std::vector<double> >& dataVec);
-
-	/** Calculate minimum and maximum value of each column in the sample data matrix. */
-	void CalculateColumnExtents();
-
-	/** Calculate sum of each column in the sample data matrix. */
-	void CalculateColumnSums();
-
-	/** Calculate branch length weighted sum for each row in the data matrix. */
-	void CalculateWeightedRowSums();
+	/** Calculate data vectors. Returns false if a sample could not be read. */
+	bool CalculateDataVectors(uint startIndex, uint numSamples, std::vector< std::vector<double> >& dataVec) const;
+
+	/** Calculate data vectors of samples with the given ids. Returns false if a sample could not be read. */
+	bool CalculateDataVectors(const std::vector<uint>& sampleIds, uint startIndex, uint numSamples, std::vector< std::vector<double> >& dataVec) const;
+
+	/** 
+	 * @brief Calculate dissimilarities between a block of rows and a block of columns and write them at their offsets.
+	 *
+	 * @param out Positional writer of matrix.
+	 * @param firstRow Index of first row.
+	 * @param dataVecRows Data vectors of rows.
+	 * @param firstCol Index of first column.
+	 * @param dataVecCols Data vectors of columns.
+	 * @param bDiagonal Flag indicating rows and columns are the same samples, so only the lower triangle is calculated.
+	 */
+	void WriteBlockSegments(MatrixWriter* out, uint firstRow, const std::vector< std::vector<double> >& dataVecRows,
+														uint firstCol, const std::vector< std::vector<double> >& dataVecCols, bool bDiagonal) const;
+
+	/** 
+	 * @brief Calculate statistics of the data matrix in a single pass over all samples.
+	 *
+	 * Sums across samples are accumulated over blocks of a fixed size which are combined in 
+	 * block order, so results are bitwise identical for any number of threads.
+	 *
+	 * @param bColumnExtents Calculate minimum and maximum value of each column.
+	 * @param bColumnSums Calculate sum of each column.
+	 * @param bRowSums Calculate branch length weighted sum of each row (i.e., sample).
+	 * @return False if a sample could not be read.
+	 */
+	bool CalculateStatistics(bool bColumnExtents, bool bColumnSums, bool bRowSums);
+
+	/** Get type of data vectors to calculate. */
+	SplitSystem::DATA_TYPE GetDataType() const;
 
 	/** Get weight of each split. */
 	void GetSplitWeights();
 
-	static double BrayCurtis(const std::vector<double>& com1, const std::vector<double>& com2, uint i, uint j);
-	static double Canberra(const std::vector<double>& com1, const std::vector<double>& com2, uint i, uint j);
-	static double CoefficientOfSimilarity(const std::vector<double>& com1, const std::vector<double>& com2, uint i, uint j);
-	static double CompleteTree(const std::vector<double>& com1, const std::vector<double>& com2, uint i, uint j);
-	static double Euclidean(const std::vector<double>& com1, const std::vector<double>& com2, uint i, uint j);
-	static double Gower(const std::vector<double>& com1, const std::vector<double>& com2, uint i, uint j);
-	static double Kulczynski(const std::vector<double>& com1, const std::vector<double>& com2, uint i, uint j);
-	static double LennonCD(const std::vector<double>& com1, const std::vector<double>& com2, uint i, uint j);
-	static double Manhattan(const std::vector<double>& com1, const std::vector<double>& com2, uint i, uint j);
-	static double MorisitaHorn(const std::vector<double>& com1, const std::vector<double>& com2, uint i, uint j);
-	static double Soergel(const std::vector<double>& com1, const std::vector<double>& com2, uint i, uint j);
-	static double TamasCoefficient(const std::vector<double>& com1, const std::vector<double>& com2, uint i, uint j);
-	static double WeightedCorrelation(const std::vector<double>& com1, const std::vector<double>& com2, uint i, uint j);
-	static double YueClayton(const std::vector<double>& com1, const std::vector<double>& com2, uint i, uint j);
-
-	static double Sum(const std::vector<double>& com1, const std::vector<double>& com2, uint i, uint j);
-	static double Extents(const std::vector<double>& com1, const std::vector<double>& com2, uint i, uint j);
+	double BrayCurtis(const std::vector<double>& com1, const std::vector<double>& com2, uint i, uint j) const;
+	double Canberra(const std::vector<double>& com1, const std::vector<double>& com2, uint i, uint j) const;
+	double CoefficientOfSimilarity(const std::vector<double>& com1, const std::vector<double>& com2, uint i, uint j) const;
+	double CompleteTree(const std::vector<double>& com1, const std::vector<double>& com2, uint i, uint j) const;
+	double Euclidean(const std::vector<double>& com1, const std::vector<double>& com2, uint i, uint j) const;
+	double Gower(const std::vector<double>& com1, const std::vector<double>& com2, uint i, uint j) const;
+	double Kulczynski(const std::vector<double>& com1, const std::vector<double>& com2, uint i, uint j) const;
+	double LennonCD(const std::vector<double>& com1, const std::vector<double>& com2, uint i, uint j) const;
+	double Manhattan(const std::vector<double>& com1, const std::vector<double>& com2, uint i, uint j) const;
+	double MorisitaHorn(const std::vector<double>& com1, const std::vector<double>& com2, uint i, uint j) const;
+	double Soergel(const std::vector<double>& com1, const std::vector<double>& com2, uint i, uint j) const;
+	double TamasCoefficient(const std::vector<double>& com1, const std::vector<double>& com2, uint i, uint j) const;
+	double WeightedCorrelation(const std::vector<double>& com1, const std::vector<double>& com2, uint i, uint j) const;
+	double YueClayton(const std::vector<double>& com1, const std::vector<double>& com2, uint i, uint j) const;
+
+	double Sum(const std::vector<double>& com1, const std::vector<double>& com2, uint i, uint j) const;
+	double Extents(const std::vector<double>& com1, const std::vector<double>& com2, uint i, uint j) const;
 	
 private:
+	/** Calculator is bound to this instance so copying is not supported. */
+	DiversityCalculator(const DiversityCalculator&);
+	DiversityCalculator& operator=(const DiversityCalculator&);
+
+private:
+	/** Number of samples processed together by one worker when calculating statistics. */
+	static const uint STATS_BLOCK_SIZE = 64;
+
+	/** Number of samples whose nearest neighbors are formatted together. */
+	static const uint NEIGHBOR_BATCH_SIZE = 64*1024;
+
 	typedef std::tr1::function<double (const std::vector<double>&, const std::vector<double>&, uint, uint)> CalculatorFunc;
 
-	/** Split system to calculate beta diversity over. */
-	SplitSystem& m_splitSystem;
+	/** Split system to calculate beta diversity over. May be shared between calculators. */
+	const SplitSystem& m_splitSystem;
+
+	/** Name of calculator. */
+	std::string m_calcStr;
 
 	/** Function object indicating calculator to use. */
 	CalculatorFunc m_calculator;
@@ -98,7 +182,7 @@ private:
 	uint m_maxDataVecs;
 
 	/** Flag indicating if weighted vectors are to be generated. */
-	static bool m_bWeighted;
+	bool m_bWeighted;
 
 	/** Flag indicating if count data should be used or if it should be normalized to relative proportions. */
 	bool m_bCount;
@@ -109,35 +193,26 @@ private:
 	/** Flag indicating if program execution information should be printed. */
 	bool m_bVerbose;
 
+	/** Flag indicating if calculator depends on statistics over all samples. */
+	bool m_bSampleStatistics;
+
 	/** Weight associated with each split/column. */
-	static std::vector<double> m_splitWeights;
+	std::vector<double> m_splitWeights;
 
 	/** Total split weight in split system. */
-	static double m_totalSplitWeight;
-
-	/** Data vectors for current rows in dissimilarity matrix being processed. */ 
-	static std::vector< std::vector<double> > m_dataVecRows;
-
-	/** Data vectors for current columns in dissimilarity matrix being processed. */ 
-	static std::vector< std::vector<double> > m_dataVecCols;
+	double m_totalSplitWeight;
 
 	/** Minimum value in each column of data matrix. */
-	static std::vector<double> m_minExtent;
+	std::vector<double> m_minExtent;
 
 	/** Maximum value in each column of data matrix. */
-	static std::vector<double> m_maxExtent;
+	std::vector<double> m_maxExtent;
 
 	/** Sum of each column in the data matrix. */
-	static std::vector<double> m_colSum;
-
-	/** Sum of leaf node proportions along each row of the data matrix. */
-	static std::vector<double> m_rowLeafSum;
-
-	/** Sum of squarded leaf node proportions along each row of the data matrix. */
-	static std::vector<double> m_rowLeafSumSqrd;
+	std::vector<double> m_colSum;
 
-	/** Sum of each row weighted by branch length in the data matrix. */
-	static std::vector<double> m_weightedRowSum;
+	/** Sum of each row weighted by branch length in the data matrix, indexed by sample id. */
+	std::vector<double> m_weightedRowSum;
 };
 
 #endif
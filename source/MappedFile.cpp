@@ -0,0 +1,172 @@
+//=======================================================================
+// Author: Donovan Parks
+//
+// Copyright 2011 Donovan Parks
+//
+// This file is part of ExpressBetaDiversity.
+//
+// ExpressBetaDiversity is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// ExpressBetaDiversity is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ExpressBetaDiversity. If not, see
+// <http://www.gnu.org/licenses/>.
+//=======================================================================
+
+#include "Precompiled.hpp"
+
+#include "MappedFile.hpp"
+
+#ifdef WIN32
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <unistd.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+#endif
+
+MappedFile::MappedFile()
+	: m_data(NULL), m_size(0), m_bMapped(false)
+{
+#ifdef WIN32
+	m_fileHandle = INVALID_HANDLE_VALUE;
+	m_mapHandle = NULL;
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+bool MappedFile::Open(const std::string& filename)
+{
+	Close();
+
+#ifdef WIN32
+	m_fileHandle = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if(m_fileHandle == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER fileSize;
+	if(GetFileSizeEx(m_fileHandle, &fileSize) && fileSize.QuadPart > 0)
+	{
+		m_mapHandle = CreateFileMappingA(m_fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+		if(m_mapHandle != NULL)
+		{
+			m_data = (const char*)MapViewOfFile(m_mapHandle, FILE_MAP_READ, 0, 0, 0);
+			if(m_data != NULL)
+			{
+				m_size = fileSize.QuadPart;
+				m_bMapped = true;
+				return true;
+			}
+		}
+	}
+#else
+	int fd = open(filename.c_str(), O_RDONLY);
+	if(fd == -1)
+		return false;
+
+	struct stat fileInfo;
+	if(fstat(fd, &fileInfo) == 0 && S_ISREG(fileInfo.st_mode) && fileInfo.st_size > 0)
+	{
+		void* data = mmap(NULL, fileInfo.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if(data != MAP_FAILED)
+		{
+			// mapping remains valid after the descriptor is closed
+			close(fd);
+			m_data = (const char*)data;
+			m_size = fileInfo.st_size;
+			m_bMapped = true;
+			return true;
+		}
+	}
+	close(fd);
+#endif
+
+	return ReadIntoBuffer(filename);
+}
+
+bool MappedFile::ReadIntoBuffer(const std::string& filename)
+{
+	Close();
+
+	std::ifstream file(filename.c_str(), std::ios::binary);
+	if(!file.is_open())
+		return false;
+
+	m_buffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	m_size = m_buffer.size();
+
+	// terminate buffer so parsing can never run past the end of the data
+	m_buffer.push_back(0);
+	m_data = &m_buffer[0];
+
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if(m_bMapped)
+	{
+	#ifdef WIN32
+		UnmapViewOfFile(m_data);
+	#else
+		munmap((void*)m_data, m_size);
+	#endif
+	}
+
+#ifdef WIN32
+	if(m_mapHandle != NULL)
+		CloseHandle(m_mapHandle);
+	if(m_fileHandle != INVALID_HANDLE_VALUE)
+		CloseHandle(m_fileHandle);
+	m_mapHandle = NULL;
+	m_fileHandle = INVALID_HANDLE_VALUE;
+#endif
+
+	m_data = NULL;
+	m_size = 0;
+	m_bMapped = false;
+	m_buffer.clear();
+}
+
+void MappedFile::Advise(ACCESS_PATTERN accessPattern) const
+{
+#if !defined(WIN32) && defined(MADV_SEQUENTIAL)
+	if(!m_bMapped)
+		return;
+
+	int advice = MADV_NORMAL;
+	if(accessPattern == SEQUENTIAL_ACCESS)
+		advice = MADV_SEQUENTIAL;
+	else if(accessPattern == RANDOM_ACCESS)
+		advice = MADV_RANDOM;
+
+	madvise((void*)m_data, m_size, advice);
+#endif
+}
+
+void MappedFile::Prefetch(uint64 offset, uint64 length) const
+{
+#if !defined(WIN32) && defined(MADV_WILLNEED)
+	if(!m_bMapped || offset >= m_size)
+		return;
+
+	// advice must start on a page boundary
+	uint64 pageSize = sysconf(_SC_PAGESIZE);
+	uint64 start = offset - (offset % pageSize);
+	length = std::min<uint64>(length + (offset - start), m_size - start);
+
+	madvise((void*)(m_data + start), length, MADV_WILLNEED);
+#endif
+}
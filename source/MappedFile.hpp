@@ -0,0 +1,97 @@
+//=======================================================================
+// Author: Donovan Parks
+//
+// Copyright 2011 Donovan Parks
+//
+// This file is part of ExpressBetaDiversity.
+//
+// ExpressBetaDiversity is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// ExpressBetaDiversity is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ExpressBetaDiversity. If not, see
+// <http://www.gnu.org/licenses/>.
+//=======================================================================
+
+#ifndef _MAPPED_FILE_
+#define _MAPPED_FILE_
+
+#include "Precompiled.hpp"
+
+/**
+ * @brief Read-only view of a file mapped into memory.
+ *
+ * The mapping is never written to, so any number of threads can read it concurrently.
+ * If the file cannot be mapped, its contents are read into memory instead.
+ */
+class MappedFile
+{
+public:
+	enum ACCESS_PATTERN { NORMAL_ACCESS, SEQUENTIAL_ACCESS, RANDOM_ACCESS };
+
+public:
+	/** Constructor. */
+	MappedFile();
+
+	/** Destructor. */
+	~MappedFile();
+
+	/**
+	* @brief Map file into memory.
+	*
+	* @param filename Path to file.
+	* @return True if file could be mapped or read, else false.
+	*/
+	bool Open(const std::string& filename);
+
+	/** Unmap file. */
+	void Close();
+
+	/** Get pointer to start of file. */
+	const char* GetData() const { return m_data; }
+
+	/** Get size of file in bytes. */
+	uint64 GetSize() const { return m_size; }
+
+	/** Hint at how the whole file will be accessed. */
+	void Advise(ACCESS_PATTERN accessPattern) const;
+
+	/** Hint that the given range of the file will be needed soon. */
+	void Prefetch(uint64 offset, uint64 length) const;
+
+private:
+	/** Mapping is owned by this object so copying is not supported. */
+	MappedFile(const MappedFile&);
+	MappedFile& operator=(const MappedFile&);
+
+	/** Read contents of file into memory when it cannot be mapped. */
+	bool ReadIntoBuffer(const std::string& filename);
+
+private:
+	/** Start of file in memory. */
+	const char* m_data;
+
+	/** Size of file in bytes. */
+	uint64 m_size;
+
+	/** Flag indicating if file is mapped (as opposed to read into m_buffer). */
+	bool m_bMapped;
+
+	/** Contents of file if it could not be mapped. */
+	std::vector<char> m_buffer;
+
+#ifdef WIN32
+	/** Handles to file and file mapping object. */
+	void* m_fileHandle;
+	void* m_mapHandle;
+#endif
+};
+
+#endif
@@ -0,0 +1,226 @@
+//=======================================================================
+// Author: Donovan Parks
+//
+// Copyright 2011 Donovan Parks
+//
+// This file is part of ExpressBetaDiversity.
+//
+// ExpressBetaDiversity is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// ExpressBetaDiversity is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ExpressBetaDiversity. If not, see
+// <http://www.gnu.org/licenses/>.
+//=======================================================================
+
+#include "Precompiled.hpp"
+
+#include "MatrixStore.hpp"
+#include "Utils.hpp"
+
+const std::string STORE_HEADER = "NetworkDiversity matrix store";
+
+MatrixStore::MatrixStore(const std::string& matrixFile, uint64 splitsFingerprint, uint numSplits, const std::string& settings)
+	: m_matrixFile(matrixFile), m_splitsFingerprint(splitsFingerprint), m_numSplits(numSplits), m_settings(settings)
+{
+
+}
+
+bool MatrixStore::Open()
+{
+	m_sampleNames.clear();
+
+	std::string indexFile = GetIndexFilename(m_matrixFile);
+	std::ifstream indexIn(indexFile.c_str());
+	bool bExists = indexIn.is_open();
+	indexIn.close();
+
+	if(bExists && !ReadIndex(indexFile))
+		return false;
+
+	// discard data vectors of samples which were never committed
+	std::string vectorsFile = GetVectorsFilename(m_matrixFile);
+	uint64 vectorsSize = (uint64)m_sampleNames.size()*m_numSplits*sizeof(double);
+	uint64 fileSize = 0;
+	if(bExists && (!GetFileSize(vectorsFile, fileSize) || fileSize < vectorsSize))
+	{
+		std::cerr << "Data vectors of matrix store are incomplete: " << vectorsFile << std::endl;
+		return false;
+	}
+
+	if(bExists && fileSize > vectorsSize && !TruncateFile(vectorsFile, vectorsSize))
+	{
+		std::cerr << "Unable to truncate data vectors of matrix store: " << vectorsFile << std::endl;
+		return false;
+	}
+
+	if(vectorsSize > 0)
+	{
+		if(!m_vectors.Open(vectorsFile))
+		{
+			std::cerr << "Unable to open data vectors of matrix store: " << vectorsFile << std::endl;
+			return false;
+		}
+
+		m_vectors.Advise(MappedFile::SEQUENTIAL_ACCESS);
+	}
+
+	std::ios::openmode mode = std::ios::out | std::ios::binary | (bExists ? std::ios::app : std::ios::trunc);
+	m_vectorsOut.open(vectorsFile.c_str(), mode);
+	if(!m_vectorsOut.is_open())
+	{
+		std::cerr << "Unable to write data vectors of matrix store: " << vectorsFile << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+bool MatrixStore::ReadIndex(const std::string& indexFile)
+{
+	std::ifstream in(indexFile.c_str());
+
+	std::string header;
+	std::getline(in, header);
+	if(header != STORE_HEADER)
+	{
+		std::cerr << "Invalid matrix store index: " << indexFile << std::endl;
+		return false;
+	}
+
+	std::string fingerprintLabel, splitsLabel, settingsLabel, samplesLabel;
+	uint64 splitsFingerprint;
+	uint numSplits, numSamples;
+	std::string settings;
+	in >> fingerprintLabel >> std::hex >> splitsFingerprint >> std::dec;
+	in >> splitsLabel >> numSplits >> settingsLabel;
+	in.ignore(1);
+	std::getline(in, settings);
+	in >> samplesLabel >> numSamples;
+	if(!in.good() || fingerprintLabel != "fingerprint" || splitsLabel != "splits" || settingsLabel != "settings" || samplesLabel != "samples")
+	{
+		std::cerr << "Invalid matrix store index: " << indexFile << std::endl;
+		return false;
+	}
+
+	if(numSplits != m_numSplits)
+	{
+		std::cerr << "Matrix store " << m_matrixFile << " has data vectors of " << numSplits << " splits, but the tree has " 
+							<< m_numSplits << " splits over the taxa of the sample file." << std::endl;
+		return false;
+	}
+
+	if(splitsFingerprint != m_splitsFingerprint)
+	{
+		std::cerr << "Matrix store " << m_matrixFile << " was created from a different tree or a different set of its taxa."
+							<< " The sample file must contain the same taxa of the tree as the sample files used to create the store." << std::endl;
+		return false;
+	}
+
+	if(settings != m_settings)
+	{
+		std::cerr << "Matrix store " << m_matrixFile << " was created with settings (" << settings 
+							<< "), not (" << m_settings << ")." << std::endl;
+		return false;
+	}
+
+	// one sample name per line
+	std::string name;
+	std::getline(in, name);
+	for(uint i = 0; i < numSamples; ++i)
+	{
+		if(!std::getline(in, name))
+		{
+			std::cerr << "Invalid matrix store index: " << indexFile << std::endl;
+			return false;
+		}
+
+		m_sampleNames.push_back(name);
+	}
+
+	return true;
+}
+
+void MatrixStore::GetDataVectors(uint startIndex, uint numSamples, std::vector< std::vector<double> >& dataVec) const
+{
+	const double* vectors = (const double*)m_vectors.GetData();
+
+	dataVec.clear();
+	dataVec.resize(numSamples);
+
+	#pragma omp parallel for schedule(static)
+	for(int i = 0; i < (int)numSamples; ++i)
+	{
+		const double* vec = vectors + (uint64)(startIndex + i)*m_numSplits;
+		dataVec[i].assign(vec, vec + m_numSplits);
+	}
+}
+
+bool MatrixStore::AppendDataVectors(const std::vector< std::vector<double> >& dataVec)
+{
+	for(uint i = 0; i < dataVec.size(); ++i)
+	{
+		if(m_numSplits > 0)
+			m_vectorsOut.write((const char*)&dataVec[i][0], m_numSplits*sizeof(double));
+	}
+
+	return m_vectorsOut.good();
+}
+
+bool MatrixStore::Commit(const std::vector<std::string>& sampleNames, uint numSamples)
+{
+	// data vectors must be on disk before the index refers to them
+	std::string vectorsFile = GetVectorsFilename(m_matrixFile);
+	m_vectorsOut.flush();
+	if(!m_vectorsOut.good() || !SyncFile(vectorsFile))
+	{
+		std::cerr << "Unable to write data vectors of matrix store to disk: " << vectorsFile << std::endl;
+		return false;
+	}
+
+	std::string indexFile = GetIndexFilename(m_matrixFile);
+	std::string tempFile = indexFile + ".tmp";
+	std::ofstream out(tempFile.c_str());
+	if(!out.is_open())
+	{
+		std::cerr << "Unable to write matrix store index: " << tempFile << std::endl;
+		return false;
+	}
+
+	out << STORE_HEADER << std::endl;
+	out << "fingerprint " << std::hex << m_splitsFingerprint << std::dec << std::endl;
+	out << "splits " << m_numSplits << std::endl;
+	out << "settings " << m_settings << std::endl;
+	out << "samples " << numSamples << std::endl;
+	for(uint i = 0; i < numSamples; ++i)
+		out << sampleNames[i] << std::endl;
+
+	out.close();
+
+	// if the rename is lost the previous index remains, which refers to data already on disk
+	if(out.fail() || !SyncFile(tempFile))
+	{
+		remove(tempFile.c_str());
+		std::cerr << "Unable to write matrix store index: " << tempFile << std::endl;
+		return false;
+	}
+
+#ifdef WIN32
+	remove(indexFile.c_str());
+#endif
+
+	if(rename(tempFile.c_str(), indexFile.c_str()) != 0)
+	{
+		std::cerr << "Unable to write matrix store index: " << indexFile << std::endl;
+		return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,111 @@
+//=======================================================================
+// Author: Donovan Parks
+//
+// Copyright 2011 Donovan Parks
+//
+// This file is part of ExpressBetaDiversity.
+//
+// ExpressBetaDiversity is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// ExpressBetaDiversity is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ExpressBetaDiversity. If not, see
+// <http://www.gnu.org/licenses/>.
+//=======================================================================
+
+#ifndef _MATRIX_STORE_
+#define _MATRIX_STORE_
+
+#include "Precompiled.hpp"
+
+#include "MappedFile.hpp"
+
+/**
+ * @brief Appendable on-disk dissimilarity matrix for a growing set of samples.
+ *
+ * A store is a condensed .npy matrix together with an index of its samples (<file>.samples) 
+ * and the data vectors of these samples (<file>.vec, one row of doubles per sample). Rows 
+ * of a condensed lower triangle only involve earlier samples, so new samples are added by 
+ * appending their rows and data vectors. The index is the commit point: it is replaced 
+ * atomically once rows and data vectors are written, and anything beyond the samples it 
+ * lists is discarded when the store is next opened.
+ */
+class MatrixStore
+{
+public:
+	/**
+	* @brief Constructor.
+	*
+	* @param matrixFile Path to matrix file of store.
+	* @param splitsFingerprint Fingerprint of the splits which determine data vectors.
+	* @param numSplits Length of data vectors.
+	* @param settings Description of the calculator and settings which determine dissimilarities.
+	*/
+	MatrixStore(const std::string& matrixFile, uint64 splitsFingerprint, uint numSplits, const std::string& settings);
+
+	/** Destructor. */
+	~MatrixStore() {}
+
+	/** Get path to index of samples in a store. */
+	static std::string GetIndexFilename(const std::string& matrixFile) { return matrixFile + ".samples"; }
+
+	/** Get path to data vectors of samples in a store. */
+	static std::string GetVectorsFilename(const std::string& matrixFile) { return matrixFile + ".vec"; }
+
+	/**
+	* @brief Open an existing store, or start a new store if it has no index.
+	*
+	* @return True if store is empty or was created with the same splits and settings, else false.
+	*/
+	bool Open();
+
+	/** Get number of samples committed to the store. */
+	uint GetNumSamples() const { return m_sampleNames.size(); }
+
+	/** Get names of samples committed to the store, in the order of the rows of the matrix. */
+	const std::vector<std::string>& GetSampleNames() const { return m_sampleNames; }
+
+	/** Get cached data vectors of consecutive samples committed before the store was opened. */
+	void GetDataVectors(uint startIndex, uint numSamples, std::vector< std::vector<double> >& dataVec) const;
+
+	/** Append data vectors of the next samples to be committed. */
+	bool AppendDataVectors(const std::vector< std::vector<double> >& dataVec);
+
+	/** Commit samples whose rows have been written to disk by forcing data vectors to disk and replacing the index. */
+	bool Commit(const std::vector<std::string>& sampleNames, uint numSamples);
+
+private:
+	/** Read index of an existing store. */
+	bool ReadIndex(const std::string& indexFile);
+
+private:
+	/** Path to matrix file of store. */
+	std::string m_matrixFile;
+
+	/** Fingerprint of splits. */
+	uint64 m_splitsFingerprint;
+
+	/** Length of data vectors. */
+	uint m_numSplits;
+
+	/** Description of calculator and settings. */
+	std::string m_settings;
+
+	/** Names of samples committed to the store. */
+	std::vector<std::string> m_sampleNames;
+
+	/** Data vectors of samples committed before the store was opened. */
+	MappedFile m_vectors;
+
+	/** Stream appending data vectors of new samples. */
+	std::ofstream m_vectorsOut;
+};
+
+#endif
@@ -0,0 +1,360 @@
+//=======================================================================
+// Author: Donovan Parks
+//
+// Copyright 2011 Donovan Parks
+//
+// This file is part of ExpressBetaDiversity.
+//
+// ExpressBetaDiversity is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// ExpressBetaDiversity is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ExpressBetaDiversity. If not, see
+// <http://www.gnu.org/licenses/>.
+//=======================================================================
+
+#include "Precompiled.hpp"
+
+#include "MatrixWriter.hpp"
+#include "TextMatrixWriter.hpp"
+#include "NpyMatrixWriter.hpp"
+#include "MappedFile.hpp"
+#include "Utils.hpp"
+
+const uint MatrixWriter::BUFFER_SIZE;
+const uint64 MatrixWriter::TRANSPOSE_MEMORY;
+
+MatrixWriter::MatrixWriter(LAYOUT layout): m_layout(layout), m_bResume(false), m_bufferUsed(0), m_offset(0), m_bCompress(false), m_bWriteError(false)
+{
+
+}
+
+MatrixWriter::~MatrixWriter()
+{
+
+}
+
+MatrixWriter* MatrixWriter::Create(const MatrixFormat& matrixFormat)
+{
+	LAYOUT layout;
+	if(matrixFormat.layout == "condensed")
+		layout = CONDENSED;
+	else if(matrixFormat.layout == "square")
+		layout = SQUARE;
+	else if(matrixFormat.layout == "pairs")
+		layout = PAIRS;
+	else
+	{
+		std::cerr << "Unknown matrix layout: " << matrixFormat.layout << " (expected condensed, square, or pairs)" << std::endl;
+		return NULL;
+	}
+
+	// sparse matrices are lists of pairs
+	if(matrixFormat.bSparse)
+	{
+		if(layout == SQUARE || matrixFormat.format != "text")
+		{
+			std::cerr << "Sparse matrices are only supported for text output in the pairs layout." << std::endl;
+			return NULL;
+		}
+
+		layout = PAIRS;
+	}
+
+	// nearest neighbors replace the matrix
+	if(matrixFormat.topK > 0)
+	{
+		if(matrixFormat.bSparse || matrixFormat.format != "text")
+		{
+			std::cerr << "Nearest neighbors are only supported for text output without a dissimilarity threshold." << std::endl;
+			return NULL;
+		}
+
+		layout = NEIGHBORS;
+	}
+
+	BlockCompressor::COMPRESSION compression;
+	if(!BlockCompressor::Parse(matrixFormat.compression, compression))
+		return NULL;
+
+	MatrixWriter* writer = NULL;
+	if(matrixFormat.format == "text")
+		writer = new TextMatrixWriter(layout, matrixFormat.precision, matrixFormat.bFixedWidth);
+	else if(matrixFormat.format == "npy")
+	{
+		if(layout == PAIRS)
+		{
+			std::cerr << "The pairs layout is only supported for text output." << std::endl;
+			return NULL;
+		}
+
+		Quantizer::ROUNDING rounding;
+		if(!Quantizer::ParseRounding(matrixFormat.rounding, rounding))
+			return NULL;
+
+		if(matrixFormat.valueType == "float32")
+			writer = new NpyMatrixWriter(layout, NpyMatrixWriter::FLOAT32);
+		else if(matrixFormat.valueType == "float64")
+			writer = new NpyMatrixWriter(layout, NpyMatrixWriter::FLOAT64);
+		else if(matrixFormat.valueType == "float16")
+			writer = new NpyMatrixWriter(layout, NpyMatrixWriter::FLOAT16, rounding);
+		else if(matrixFormat.valueType == "uint16")
+			writer = new NpyMatrixWriter(layout, NpyMatrixWriter::UINT16, rounding);
+		else if(matrixFormat.valueType == "uint8")
+			writer = new NpyMatrixWriter(layout, NpyMatrixWriter::UINT8, rounding);
+		else
+		{
+			std::cerr << "Unknown matrix value type: " << matrixFormat.valueType << " (expected float32, float64, float16, uint16, or uint8)" << std::endl;
+			return NULL;
+		}
+	}
+	else
+	{
+		std::cerr << "Unknown matrix output format: " << matrixFormat.format << " (expected text or npy)" << std::endl;
+		return NULL;
+	}
+
+	writer->m_compressor = BlockCompressor(compression);
+
+	return writer;
+}
+
+std::string MatrixWriter::GetProgressFilename(const std::string& filename) const
+{
+	if(m_layout == SQUARE)
+		return filename + ".lower";
+
+	return filename;
+}
+
+bool MatrixWriter::Open(const std::string& filename, const MatrixInfo& info, bool bResume, uint64 offset)
+{
+	m_filename = filename;
+	m_info = info;
+	m_bResume = bResume;
+	Initialize();
+
+	// keep every worker thread busy when compressing the buffer
+	m_buffer.resize(BUFFER_SIZE);
+	if(m_compressor.GetCompression() != BlockCompressor::NO_COMPRESSION)
+		m_buffer.resize(std::max<uint64>(BUFFER_SIZE, 2*(uint64)omp_get_max_threads()*BlockCompressor::BLOCK_SIZE));
+	m_bufferUsed = 0;
+
+	// working file of the square layout is not compressed
+	m_bCompress = (m_compressor.GetCompression() != BlockCompressor::NO_COMPRESSION && m_layout != SQUARE);
+
+	std::string progressFile = GetProgressFilename(filename);
+	if(bResume)
+	{
+		m_file.open(progressFile.c_str(), std::ios::in | std::ios::out | std::ios::binary);
+		m_file.seekp(offset);
+		m_offset = offset;
+	}
+	else
+	{
+		m_file.open(progressFile.c_str(), std::ios::out | std::ios::trunc | std::ios::binary);
+		m_offset = 0;
+	}
+
+	if(!m_file.is_open() || !m_file.good())
+		return false;
+
+	// working file of the square layout holds only values
+	if(!bResume && m_layout != SQUARE && (!WriteHeader() || !Flush()))
+		return false;
+
+	m_bWriteError = false;
+	if(IsPositional())
+		return m_positionalFile.Open(progressFile);
+
+	return true;
+}
+
+uint64 MatrixWriter::GetRowOffset(uint row) const
+{
+	if(m_layout == SQUARE)
+		return (uint64)row*(row - (row > 0 ? 1 : 0))/2 * sizeof(double);
+
+	return GetLayoutRowOffset(row);
+}
+
+void MatrixWriter::WriteSegment(uint row, uint firstCol, uint numValues, const double* values, std::vector<char>& buffer)
+{
+	bool bWritten = true;
+	if(m_layout == SQUARE)
+	{
+		if(numValues > 0)
+			bWritten = m_positionalFile.Write(GetRowOffset(row) + (uint64)firstCol*sizeof(double), (const char*)values, (uint64)numValues*sizeof(double));
+	}
+	else
+	{
+		uint64 offset = FormatSegment(row, firstCol, numValues, values, buffer);
+		if(!buffer.empty())
+			bWritten = m_positionalFile.Write(offset, &buffer[0], buffer.size());
+	}
+
+	if(!bWritten)
+	{
+		#pragma omp critical(WriteError)
+		m_bWriteError = true;
+	}
+}
+
+void MatrixWriter::WriteRows(uint firstRow, uint numRows, const double* values, uint64 rowStride)
+{
+	if(m_layout != SQUARE)
+	{
+		AppendRows(firstRow, numRows, values, rowStride, false);
+		return;
+	}
+
+	for(uint r = 0; r < numRows; ++r)
+		Append((const char*)(values + r*rowStride), (uint64)(firstRow + r)*sizeof(double));
+}
+
+void MatrixWriter::Append(const char* data, uint64 size)
+{
+	if(m_bufferUsed + size > m_buffer.size())
+		Flush();
+
+	// data larger than the buffer is written directly
+	if(size > m_buffer.size())
+		WriteData(data, size);
+	else
+	{
+		memcpy(&m_buffer[0] + m_bufferUsed, data, size);
+		m_bufferUsed += size;
+	}
+}
+
+void MatrixWriter::WriteData(const char* data, uint64 size)
+{
+	if(!m_bCompress)
+	{
+		m_file.write(data, size);
+		m_offset += size;
+		return;
+	}
+
+	if(!m_compressor.Compress(data, size, m_compressed))
+	{
+		m_bWriteError = true;
+		return;
+	}
+
+	if(!m_compressed.empty())
+		m_file.write(&m_compressed[0], m_compressed.size());
+	m_offset += m_compressed.size();
+}
+
+bool MatrixWriter::Flush()
+{
+	if(m_bufferUsed > 0)
+	{
+		WriteData(&m_buffer[0], m_bufferUsed);
+		m_bufferUsed = 0;
+	}
+
+	m_file.flush();
+
+	return !m_file.fail() && !m_bWriteError;
+}
+
+bool MatrixWriter::Sync()
+{
+	if(!Flush())
+		return false;
+
+	if(!SyncFile(GetProgressFilename(m_filename)))
+	{
+		std::cerr << "Unable to write matrix file to disk: " << GetProgressFilename(m_filename) << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+bool MatrixWriter::Close()
+{
+	bool bFlushed = Flush();
+	m_file.close();
+
+	if(!m_positionalFile.Close() || m_file.fail() || !bFlushed)
+		return false;
+
+	if(m_layout == SQUARE && !WriteSquare())
+		return false;
+
+	Finish();
+
+	return true;
+}
+
+bool MatrixWriter::WriteSquare()
+{
+	uint64 numSamples = m_info.sampleNames.size();
+	uint64 numValues = numSamples*(numSamples - (numSamples > 0 ? 1 : 0)) / 2;
+
+	std::string lowerFile = GetProgressFilename(m_filename);
+	MappedFile lower;
+	if(numValues > 0 && (!lower.Open(lowerFile) || lower.GetSize() != numValues*sizeof(double)))
+	{
+		std::cerr << "Working file of square matrix is incomplete: " << lowerFile << std::endl;
+		return false;
+	}
+
+	if(numValues > 0)
+		lower.Advise(MappedFile::RANDOM_ACCESS);
+
+	m_file.clear();
+	m_file.open(m_filename.c_str(), std::ios::out | std::ios::trunc | std::ios::binary);
+	m_offset = 0;
+	m_bCompress = (m_compressor.GetCompression() != BlockCompressor::NO_COMPRESSION);
+	if(!m_file.is_open() || !WriteHeader())
+		return false;
+
+	// complete rows one block at a time, taking values right of the diagonal from the column of later rows
+	const double* values = (const double*)lower.GetData();
+	uint blockLen = (uint)std::max<uint64>(1, std::min<uint64>(numSamples, TRANSPOSE_MEMORY / (std::max<uint64>(numSamples, 1)*sizeof(double))));
+	std::vector<double> block((uint64)blockLen*numSamples);
+	for(uint firstRow = 0; firstRow < numSamples; firstRow += blockLen)
+	{
+		uint endRow = std::min<uint64>(firstRow + blockLen, numSamples);
+
+		#pragma omp parallel for schedule(static)
+		for(int j = 0; j < (int)numSamples; ++j)
+		{
+			const double* rowJ = values + (uint64)j*(j-1)/2;
+			for(uint i = firstRow; i < endRow; ++i)
+			{
+				double value = 0;
+				if((uint)j < i)
+					value = values[(uint64)i*(i-1)/2 + j];
+				else if((uint)j > i)
+					value = rowJ[i];
+
+				block[(uint64)(i - firstRow)*numSamples + j] = value;
+			}
+		}
+
+		AppendRows(firstRow, endRow - firstRow, &block[0], numSamples, true);
+	}
+
+	lower.Close();
+
+	bool bFlushed = Flush();
+	m_file.close();
+	if(m_file.fail() || !bFlushed)
+		return false;
+
+	remove(lowerFile.c_str());
+
+	return true;
+}
@@ -0,0 +1,334 @@
+//=======================================================================
+// Author: Donovan Parks
+//
+// Copyright 2011 Donovan Parks
+//
+// This file is part of ExpressBetaDiversity.
+//
+// ExpressBetaDiversity is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// ExpressBetaDiversity is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ExpressBetaDiversity. If not, see
+// <http://www.gnu.org/licenses/>.
+//=======================================================================
+
+#ifndef _MATRIX_WRITER_
+#define _MATRIX_WRITER_
+
+#include "Precompiled.hpp"
+
+#include "PositionalFile.hpp"
+#include "BlockCompressor.hpp"
+
+/**
+ * @brief Description of a dissimilarity matrix written by a matrix writer.
+ */
+struct MatrixInfo
+{
+	/** Name of each sample, in the order of the rows of the matrix. */
+	std::vector<std::string> sampleNames;
+
+	/** Name of calculator. */
+	std::string calculator;
+
+	/** Flag indicating if sequence abundance data was used. */
+	bool bWeighted;
+
+	/** Flag indicating if count data was used instead of relative proportions. */
+	bool bCount;
+
+	/** Fingerprint of the input data (sample file, samples and splits). */
+	uint64 inputFingerprint;
+
+	/** Fingerprint of the input data and all settings which determine the matrix. */
+	uint64 fingerprint;
+};
+
+/**
+ * @brief Column and value of a pair of samples written to a sparse matrix.
+ */
+struct MatrixEdge
+{
+	/** Constructor. */
+	MatrixEdge(uint _col = 0, double _value = 0): col(_col), value(_value) {}
+
+	/** Index of the sample of the column. */
+	uint col;
+
+	/** Dissimilarity between the samples of the row and column. */
+	double value;
+};
+
+/**
+ * @brief Settings determining how a dissimilarity matrix is written.
+ */
+struct MatrixFormat
+{
+	/** Constructor. */
+	MatrixFormat(): format("text"), layout("condensed"), valueType("float32"), rounding("nearest"), compression("none"), precision(6), bFixedWidth(false), bSparse(false), maxDissimilarity(0), topK(0) {}
+
+	/** File format ('text' or 'npy'). */
+	std::string format;
+
+	/** Layout of matrix ('condensed', 'square', or 'pairs'). */
+	std::string layout;
+
+	/** Type of values in binary formats ('float32', 'float64', 'float16', or 'uint16' and 'uint8' for values in [0, 1] quantized to fixed point). */
+	std::string valueType;
+
+	/** Rounding of values quantized to 8 or 16 bits ('nearest', 'down', or 'up'). */
+	std::string rounding;
+
+	/** Compression of output ('none', 'gzip', or 'zstd'). */
+	std::string compression;
+
+	/** Significant digits of values in text formats, or 0 for the shortest text which reads back to the exact value. */
+	uint precision;
+
+	/** Flag indicating values in text formats are written in scientific notation padded to a fixed width. */
+	bool bFixedWidth;
+
+	/** Flag indicating only pairs with a dissimilarity of at most maxDissimilarity are written, in the pairs layout. */
+	bool bSparse;
+
+	/** Largest dissimilarity written to a sparse matrix. */
+	double maxDissimilarity;
+
+	/** Number of nearest neighbors written for each sample in the neighbors layout, or 0 to write dissimilarities between all pairs. */
+	uint topK;
+};
+
+/**
+ * @brief Write a dissimilarity matrix to a file.
+ *
+ * Rows of the lower triangular matrix are provided in order, each holding the dissimilarity 
+ * of a sample to all preceding samples, and are written in one of the following layouts:
+ *   a) condensed: rows of the lower triangular matrix
+ *   b) square: full symmetric matrix with a zero diagonal
+ *   c) pairs: one line per pair of samples
+ * The square layout needs values from later rows to complete each row, so the lower triangular
+ * matrix is first written to a working file (<file>.lower) and transposed one block of rows at
+ * a time once all rows are known. Output is collected in a large buffer and only written to 
+ * the file when the buffer is full or on request.
+ *
+ * When the offset of every row is known before any values are calculated (binary values, 
+ * fixed-width text, and the working file of the square layout), the writer is positional:
+ * segments of rows can be written in any order and from any thread with WriteSegment().
+ *
+ * The neighbors layout gives the nearest neighbors of each sample rather than a matrix.
+ *
+ * Output can be compressed with gzip or zstd. The buffered output is then compressed in 
+ * independent blocks by the worker threads each time it is written to the file. Compressed
+ * files are never positional, though the working file of the square layout is always 
+ * written uncompressed.
+ */
+class MatrixWriter
+{
+public:
+	enum LAYOUT { CONDENSED, SQUARE, PAIRS, NEIGHBORS };
+
+public:
+	/** Constructor. */
+	MatrixWriter(LAYOUT layout);
+
+	/** Destructor. */
+	virtual ~MatrixWriter();
+
+	/** Create writer for the given format, or return NULL if the format is not supported. */
+	static MatrixWriter* Create(const MatrixFormat& matrixFormat);
+
+	/**
+	* @brief Open matrix file and write its header.
+	*
+	* @param filename Path to matrix file.
+	* @param info Description of matrix.
+	* @param bResume Keep the first offset bytes of an existing file, including its header, and write after them.
+	* @param offset Number of bytes to keep when resuming.
+	* @return True if file opened successfully, else false.
+	*/
+	bool Open(const std::string& filename, const MatrixInfo& info, bool bResume = false, uint64 offset = 0);
+
+	/** 
+	 * @brief Get path to the file rows are written to as they are provided. 
+	 *
+	 * This is the matrix file, except for the square layout where it is the working file.
+	 * Checkpoints record the size of this file.
+	 */
+	std::string GetProgressFilename(const std::string& filename) const;
+
+	/**
+	* @brief Write consecutive rows of the lower triangular matrix.
+	*
+	* @param firstRow Index of first row, which is also the number of values in this row.
+	* @param numRows Number of rows to write.
+	* @param values Values of the first row, followed by those of later rows.
+	* @param rowStride Distance between the first values of consecutive rows.
+	*/
+	void WriteRows(uint firstRow, uint numRows, const double* values, uint64 rowStride);
+
+	/**
+	* @brief Write the pairs of consecutive rows of a sparse matrix (pairs layout) or the nearest neighbors of consecutive samples (neighbors layout).
+	*
+	* @param firstRow Index of first row.
+	* @param rowEdges Pairs of each row with a column before the diagonal in order of their columns, or neighbors of each sample from nearest to farthest.
+	*/
+	void WriteEdges(uint firstRow, const std::vector< std::vector<MatrixEdge> >& rowEdges) { AppendEdges(firstRow, rowEdges); }
+
+	/** Check if segments of rows can be written in any order with WriteSegment(). */
+	bool IsPositional() const 
+	{ 
+		return m_layout == SQUARE || (IsPositionalLayout() && m_compressor.GetCompression() == BlockCompressor::NO_COMPRESSION); 
+	}
+
+	/**
+	* @brief Write values of a row of the lower triangular matrix at their position in the file.
+	*
+	* Safe to call concurrently from multiple threads for different segments. The segment starting 
+	* at the first column and the segment ending at the diagonal must be written even if empty.
+	*
+	* @param row Index of row.
+	* @param firstCol Column of first value.
+	* @param numValues Number of values.
+	* @param values Values to write.
+	* @param buffer Buffer for converting values, owned by the calling thread.
+	*/
+	void WriteSegment(uint row, uint firstCol, uint numValues, const double* values, std::vector<char>& buffer);
+
+	/** Get offset of a row in the file being written, which must be positional. */
+	uint64 GetRowOffset(uint row) const;
+
+	/** Indicate that all rows before endRow have been written with WriteSegment(). */
+	void CompleteRows(uint endRow) { m_offset = GetRowOffset(endRow); }
+
+	/** Write buffered output to the file. */
+	bool Flush();
+
+	/** Write buffered output to the file and force it to disk, so a checkpoint can refer to it. */
+	bool Sync();
+
+	/** Get size of the file being written, which includes all output once it has been flushed. */
+	uint64 GetOffset() const { return m_offset; }
+
+	/** Write buffered output and close the file, completing the matrix if it has the square layout. */
+	bool Close();
+
+	/** Print a summary of the values written, once the file is closed. */
+	virtual void Report() const {}
+
+protected:
+	/** Write header of matrix file. */
+	virtual bool WriteHeader() = 0;
+
+	/**
+	* @brief Write consecutive rows of the matrix in the layout of the writer.
+	*
+	* @param firstRow Index of first row.
+	* @param numRows Number of rows to write.
+	* @param values Values of the first row, followed by those of later rows.
+	* @param rowStride Distance between the first values of consecutive rows.
+	* @param bFullRows Flag indicating rows hold values for all samples, as opposed to only preceding samples.
+	*/
+	virtual void AppendRows(uint firstRow, uint numRows, const double* values, uint64 rowStride, bool bFullRows) = 0;
+
+	/** Write pairs or neighbors of consecutive rows. Writers supporting the pairs or neighbors layouts must override this. */
+	virtual void AppendEdges(uint firstRow, const std::vector< std::vector<MatrixEdge> >& rowEdges) {}
+
+	/** Prepare writer once the description of the matrix is known. */
+	virtual void Initialize() {}
+
+	/** Check if the offset of every row in the layout of the writer is known in advance. */
+	virtual bool IsPositionalLayout() const { return false; }
+
+	/** Get offset of a row in the layout of the writer, which must be positional. */
+	virtual uint64 GetLayoutRowOffset(uint row) const { return 0; }
+
+	/**
+	* @brief Convert a segment of a row to the layout of the writer, which must be positional.
+	*
+	* @param row Index of row.
+	* @param firstCol Column of first value.
+	* @param numValues Number of values.
+	* @param values Values to convert.
+	* @param buffer Set to data to write.
+	* @return Offset in file of data.
+	*/
+	virtual uint64 FormatSegment(uint row, uint firstCol, uint numValues, const double* values, std::vector<char>& buffer) const { return 0; }
+
+	/** Called once all values are written to complete the description of the matrix. */
+	virtual void Finish() {}
+
+	/** Append data to buffer, writing the buffer to the file once it is full. */
+	void Append(const char* data, uint64 size);
+
+	/** Append text to buffer. */
+	void Append(const std::string& text) { Append(text.c_str(), text.size()); }
+
+private:
+	/** Write square matrix file from the lower triangular matrix in the working file. */
+	bool WriteSquare();
+
+protected:
+	/** Path to matrix file. */
+	std::string m_filename;
+
+	/** Description of matrix. */
+	MatrixInfo m_info;
+
+	/** Layout of matrix. */
+	LAYOUT m_layout;
+
+	/** Flag indicating rows written by an earlier run were kept when the file was opened. */
+	bool m_bResume;
+
+private:
+	/** Writer owns its file so copying is not supported. */
+	MatrixWriter(const MatrixWriter&);
+	MatrixWriter& operator=(const MatrixWriter&);
+
+	/** Write data to the file, compressing it if requested. */
+	void WriteData(const char* data, uint64 size);
+
+private:
+	/** Size of output buffer. */
+	static const uint BUFFER_SIZE = 8*1024*1024;
+
+	/** Memory for the block of rows being transposed when writing a square matrix. */
+	static const uint64 TRANSPOSE_MEMORY = 256*1024*1024;
+
+	/** Stream to file being written. */
+	std::ofstream m_file;
+
+	/** Output which has not yet been written to the file. */
+	std::vector<char> m_buffer;
+
+	/** Number of bytes in output buffer. */
+	uint64 m_bufferUsed;
+
+	/** Size of file written so far. */
+	uint64 m_offset;
+
+	/** Compressor applied to output. */
+	BlockCompressor m_compressor;
+
+	/** Flag indicating output written to the current file is compressed. */
+	bool m_bCompress;
+
+	/** Compressed output. */
+	std::vector<char> m_compressed;
+
+	/** File written to by positional writers. */
+	PositionalFile m_positionalFile;
+
+	/** Flag indicating if compressing or positionally writing output failed. */
+	bool m_bWriteError;
+};
+
+#endif
@@ -26,17 +26,28 @@
 
 #include "SplitSystem.hpp"
 #include "DiversityCalculator.hpp"
+#include "ThreadPlacement.hpp"
 
 #include "UnitTests.hpp"
 
 bool ParseCommandLine(int argc, char* argv[], std::string& calculator, std::string& nexusFile, 
 												std::string& newickFile, std::string& sampleFile, std::string& outputFile, 
-												bool& bWeighted, bool& bCount, uint& maxDataVecs, bool& bVerbose)
+												bool& bWeighted, bool& bCount, uint& maxDataVecs, 
+												uint& numThreads, std::string& affinity, std::string& memPolicy, 
+												bool& bResume, uint& checkpointInterval, bool& bStore, bool& bConvert, 
+												bool& bTaxaAsRows, uint& inputMemoryMB, MatrixFormat& matrixFormat, uint& outputMemoryMB, bool& bVerbose)
 {
 	bool bShowHelp;
 	bool bUnitTests;
 	bool bShowCalc;
 	std::string maxDataVecsStr;
+	std::string numThreadsStr;
+	std::string checkpointIntervalStr;
+	std::string inputMemoryStr;
+	std::string precisionStr;
+	std::string outputMemoryStr;
+	std::string maxDissimilarityStr;
+	std::string topKStr;
 	GetOpt::GetOpt_pp opts(argc, argv);
 	opts >> GetOpt::OptionPresent('h', "help", bShowHelp);
 	opts >> GetOpt::OptionPresent('l', "list-calc", bShowCalc);
@@ -50,8 +61,35 @@ bool ParseCommandLine(int argc, char* argv[], std::string& calculator, std::stri
 	opts >> GetOpt::Option('x', "max-data-vecs", maxDataVecsStr, "1000");
 	opts >> GetOpt::OptionPresent('w', "weighted", bWeighted);
 	opts >> GetOpt::OptionPresent('y', "count", bCount);
+	opts >> GetOpt::Option('p', "threads", numThreadsStr, "0");
+	opts >> GetOpt::Option('\0', "affinity", affinity, "none");
+	opts >> GetOpt::Option('\0', "numa", memPolicy, "first-touch");
+	opts >> GetOpt::OptionPresent('r', "resume", bResume);
+	opts >> GetOpt::Option('\0', "checkpoint-interval", checkpointIntervalStr, "60");
+	opts >> GetOpt::OptionPresent('\0', "store", bStore);
+	opts >> GetOpt::OptionPresent('\0', "convert", bConvert);
+	opts >> GetOpt::OptionPresent('\0', "taxa-as-rows", bTaxaAsRows);
+	opts >> GetOpt::Option('\0', "input-memory", inputMemoryStr, "1024");
+	opts >> GetOpt::Option('\0', "output-format", matrixFormat.format, "text");
+	opts >> GetOpt::Option('\0', "layout", matrixFormat.layout, "condensed");
+	opts >> GetOpt::Option('\0', "value-type", matrixFormat.valueType, "float32");
+	opts >> GetOpt::Option('\0', "rounding", matrixFormat.rounding, "nearest");
+	opts >> GetOpt::Option('\0', "compression", matrixFormat.compression, "none");
+	opts >> GetOpt::Option('\0', "precision", precisionStr, "6");
+	opts >> GetOpt::OptionPresent('\0', "fixed-width", matrixFormat.bFixedWidth);
+	opts >> GetOpt::Option('\0', "max-dissimilarity", maxDissimilarityStr, "");
+	opts >> GetOpt::Option('\0', "top-k", topKStr, "0");
+	opts >> GetOpt::Option('\0', "output-memory", outputMemoryStr, "1024");
 
 	maxDataVecs = atoi(maxDataVecsStr.c_str());
+	numThreads = atoi(numThreadsStr.c_str());
+	checkpointInterval = atoi(checkpointIntervalStr.c_str());
+	inputMemoryMB = atoi(inputMemoryStr.c_str());
+	matrixFormat.precision = atoi(precisionStr.c_str());
+	outputMemoryMB = atoi(outputMemoryStr.c_str());
+	matrixFormat.bSparse = !maxDissimilarityStr.empty();
+	matrixFormat.maxDissimilarity = atof(maxDissimilarityStr.c_str());
+	matrixFormat.topK = atoi(topKStr.c_str());
 
 	if(bShowHelp || argc <= 1) 
 	{		
@@ -61,6 +99,7 @@ bool ParseCommandLine(int argc, char* argv[], std::string& calculator, std::stri
 		std::cout << std::endl;
 		std::cout << " Usage: " << opts.app_name() << " -n <nexus file> -s <sample file> -o <output file>" << std::endl;
 		std::cout << "        " << opts.app_name() << " -t <tree file> -s <sample file> -o <output file>" << std::endl;
+		std::cout << "        " << opts.app_name() << " --convert -s <sample file> -o <binary sample file>" << std::endl;
 		std::cout << "  -h, --help           Produce help message." << std::endl;
 		std::cout << "  -l, --list-calc      List all supported calculators." << std::endl;
 		std::cout << "  -u, --unit-tests     Execute unit tests." << std::endl;
@@ -71,10 +110,31 @@ bool ParseCommandLine(int argc, char* argv[], std::string& calculator, std::stri
 		std::cout << std::endl;
 		std::cout << "  -n, --nexus-file     Nexus input file (must contain a Taxa and Splits block, root split system with Outgroup taxa)." << std::endl;
 		std::cout << "  -t, --newick-file    Newick input file (tree treated as implicitly rooted)." << std::endl;
-		std::cout << "  -s, --sample-file    Sample file indicating number of times each sequences is found in a sample." << std::endl;
+		std::cout << "  -s, --sample-file    Sample file indicating number of times each sequences is found in a sample ('-' for stdin)." << std::endl;
 		std::cout << "  -o, --output-file    Output file." << std::endl;
+		std::cout << "      --output-format  Format of dissimilarity matrix: text or npy (default = text)." << std::endl;
+		std::cout << "      --layout         Layout of dissimilarity matrix: condensed, square, or pairs (default = condensed)." << std::endl;
+		std::cout << "      --value-type     Type of values in npy output: float32, float64, float16, or uint16 and uint8 for values in [0,1] (default = float32)." << std::endl;
+		std::cout << "      --rounding       Rounding of float16, uint16, and uint8 values: nearest, down, or up (default = nearest)." << std::endl;
+		std::cout << "      --compression    Compression of dissimilarity matrix: none, gzip, or zstd (default = none)." << std::endl;
+		std::cout << "      --precision      Significant digits of dissimilarity values, 0 for shortest exact representation (default = 6)." << std::endl;
+		std::cout << "      --max-dissimilarity  Only write pairs of samples with at most this dissimilarity, as a list of pairs." << std::endl;
+		std::cout << "      --top-k          Write the k nearest neighbors of each sample instead of a dissimilarity matrix." << std::endl;
+		std::cout << "      --store          Output file is a matrix store; only samples not already in it are calculated and appended." << std::endl;
+		std::cout << "      --fixed-width    Write text values in scientific notation padded to a fixed width, allowing rows to be written in parallel." << std::endl;
+		std::cout << "      --convert        Convert sample file to a binary sample file (written to the output file)." << std::endl;
+		std::cout << "      --taxa-as-rows   Sample file has taxa as rows and samples as columns." << std::endl;
+		std::cout << "      --input-memory   Memory (MB) for counts from BIOM, triplet, taxa-as-rows, or piped sample files before spilling to disk (default = 1024)." << std::endl;
 		std::cout << std::endl;
 		std::cout << "  -x, --max-data-vecs  Maximum number of samples to have in memory at once (default = 1000)." << std::endl;
+		std::cout << "      --output-memory  Memory (MB) for dissimilarities waiting to be written (default = 1024)." << std::endl;
+		std::cout << std::endl;
+		std::cout << "  -p, --threads        Number of worker threads (default = 0, use all available cores)." << std::endl;
+		std::cout << "      --affinity       Pin worker threads to cores: none, compact, or scatter (default = none)." << std::endl;
+		std::cout << "      --numa           NUMA memory placement: first-touch or interleave (default = first-touch)." << std::endl;
+		std::cout << std::endl;
+		std::cout << "  -r, --resume         Resume an interrupted run from its checkpoint file (<output file>.ckpt)." << std::endl;
+		std::cout << "      --checkpoint-interval  Minimum seconds between checkpoints (default = 60)." << std::endl;
 		std::cout << std::endl;
 		std::cout << "  -v, --verbose        Provide additional information on program execution." << std::endl;
 							
@@ -155,7 +215,7 @@ bool ParseCommandLine(int argc, char* argv[], std::string& calculator, std::stri
 
 int main(int argc, char* argv[])
 {
-	std::clock_t timeStart = std::clock();
+	double timeStart = omp_get_wtime();
 
 	// Parse command line arguments
 	std::string calculator;
@@ -167,12 +227,49 @@ int main(int argc, char* argv[])
 	bool bCount;
 	bool bVerbose;
 	uint maxDataVecs;
-	if(!ParseCommandLine(argc, argv, calculator, nexusFile, newickFile, sampleFile, outputFile, bWeighted, bCount, maxDataVecs, bVerbose))
+	uint numThreads;
+	std::string affinity;
+	std::string memPolicy;
+	bool bResume;
+	uint checkpointInterval;
+	bool bStore;
+	bool bConvert;
+	bool bTaxaAsRows;
+	uint inputMemoryMB;
+	MatrixFormat matrixFormat;
+	uint outputMemoryMB;
+	if(!ParseCommandLine(argc, argv, calculator, nexusFile, newickFile, sampleFile, outputFile, bWeighted, bCount, maxDataVecs, 
+												numThreads, affinity, memPolicy, bResume, checkpointInterval, bStore, bConvert, 
+												bTaxaAsRows, inputMemoryMB, matrixFormat, outputMemoryMB, bVerbose))
 		return 0;
 
+	// set worker threads and memory placement before any data is loaded
+	ThreadPlacement threadPlacement;
+	if(!threadPlacement.Apply(numThreads, affinity, memPolicy))
+		return -1;
+
+	if(bVerbose)
+		threadPlacement.Report();
+
+	// convert sample file to binary sample file
+	if(bConvert)
+	{
+		SampleIO sampleIO;
+		if(!sampleIO.Read(sampleFile, bTaxaAsRows, inputMemoryMB) || !sampleIO.WriteBinary(outputFile))
+		{
+			std::cerr << "Failed to convert sample file." << std::endl;
+			return -1;
+		}
+
+		if(bVerbose)
+			std::cout << "Converted " << sampleFile << " to binary sample file " << outputFile << std::endl;
+
+		return 0;
+	}
+
 	// create split system
 	SplitSystem splitSystem;
-	if(!splitSystem.LoadData(nexusFile, newickFile, sampleFile, bVerbose))
+	if(!splitSystem.LoadData(nexusFile, newickFile, sampleFile, bVerbose, bTaxaAsRows, inputMemoryMB))
 	{
 		std::cerr << "Failed to load data.";
 		return -1;
@@ -183,13 +280,24 @@ int main(int argc, char* argv[])
 	if(!diversityCalc.IsGood())
 		return -1;
 
-	diversityCalc.Dissimilarity(outputFile);
+	if(bStore)
+	{
+		if(!diversityCalc.UpdateStore(outputFile, matrixFormat))
+			return -1;
+	}
+	else if(matrixFormat.topK > 0)
+	{
+		if(!diversityCalc.NearestNeighbors(outputFile, matrixFormat))
+			return -1;
+	}
+	else if(!diversityCalc.Dissimilarity(outputFile, bResume, checkpointInterval, matrixFormat, outputMemoryMB))
+		return -1;
 
-	std::clock_t timeEnd = std::clock();
+	double timeEnd = omp_get_wtime();
 
 	if(bVerbose)
 	{
-		std::cout << "Total running time: " << ( timeEnd - timeStart ) / (double)CLOCKS_PER_SEC << " s" << std::endl; 
+		std::cout << "Total running time: " << ( timeEnd - timeStart ) << " s" << std::endl; 
 		std::cout << "Done." << std::endl;
 	}
 
@@ -24,6 +24,7 @@
 
 #include "NewickIO.hpp"
 #include "SplitSystem.hpp"
+#include "CompressedStream.hpp"
 
 bool NewickIO::Read(SplitSystem *const splitSystem, const std::string& filename)
 {
@@ -48,7 +49,7 @@ bool NewickIO::Read(Tree<Node>& tree, const std::string& filename)
 	std::string newickFile = filename;
 	std::replace(newickFile.begin(), newickFile.end(), '\\', '/');
 
-	std::ifstream file(newickFile.c_str());
+	CompressedStream file(newickFile);
 	if(!file.is_open())
 	{
 		std::cerr << "Unable to open Newick file: " << filename << std::endl;
@@ -23,6 +23,7 @@
 
 #include "NexusIO.hpp"
 #include "SplitSystem.hpp"
+#include "CompressedStream.hpp"
 #include "Utils.hpp"
 
 
@@ -48,7 +49,7 @@ bool NexusIO::Read(SplitSystem *const splitSystem, const std::string& filename)
 	std::string nexusFile = filename;
 	std::replace(nexusFile.begin(), nexusFile.end(), '\\', '/');
 
-	std::ifstream textStream(nexusFile.c_str());
+	CompressedStream textStream(nexusFile);
 	if(!textStream.is_open())
 		return false;
 
@@ -99,7 +100,7 @@ bool NexusIO::Read(SplitSystem *const splitSystem, const std::string& filename)
 	return true;
 }
 
-bool NexusIO::ReadTaxaBlock(SplitSystem *const splitSystem, std::ifstream& textStream)
+bool NexusIO::ReadTaxaBlock(SplitSystem *const splitSystem, std::istream& textStream)
 {
 	uint nexusId = 0;
 	std::string line = "";
@@ -143,7 +144,7 @@ bool NexusIO::ReadTaxaBlock(SplitSystem *const splitSystem, std::ifstream& textS
 	return true;
 }
 
-bool NexusIO::ReadCharactersBlock(SplitSystem *const splitSystem, std::ifstream& textStream)
+bool NexusIO::ReadCharactersBlock(SplitSystem *const splitSystem, std::istream& textStream)
 {
 	// move to sequence data
 	std::string line = "";
@@ -157,7 +158,7 @@ bool NexusIO::ReadCharactersBlock(SplitSystem *const splitSystem, std::ifstream&
 	return true;
 }
 
-bool NexusIO::ReadTreesBlock(SplitSystem *const splitSystem, std::ifstream& textStream)
+bool NexusIO::ReadTreesBlock(SplitSystem *const splitSystem, std::istream& textStream)
 {
 	// skip tree block
 	std::string line = "";
@@ -167,7 +168,7 @@ bool NexusIO::ReadTreesBlock(SplitSystem *const splitSystem, std::ifstream& text
 	return true;
 }
 
-bool NexusIO::ReadSplitsBlock(SplitSystem *const splitSystem, std::ifstream& textStream)
+bool NexusIO::ReadSplitsBlock(SplitSystem *const splitSystem, std::istream& textStream)
 {	
 	// determine number of splits
 	std::string line = "";
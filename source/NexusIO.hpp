@@ -55,7 +55,7 @@ private:
 	* @param textStream Stream for reading Nexus input file.
 	* @return True if block parsed successfully, otherwise false.
 	*/
-	bool ReadTaxaBlock(SplitSystem *const splitSystem, std::ifstream& textStream);
+	bool ReadTaxaBlock(SplitSystem *const splitSystem, std::istream& textStream);
 
 	/**
 	* @brief Read CHARACTERS block.
@@ -64,7 +64,7 @@ private:
 	* @param textStream Stream for reading Nexus input file.
 	* @return True if block parsed successfully, otherwise false.
 	*/
-	bool ReadCharactersBlock(SplitSystem *const splitSystem, std::ifstream& textStream);
+	bool ReadCharactersBlock(SplitSystem *const splitSystem, std::istream& textStream);
 
 	/**
 	* @brief Read TREES block.
@@ -73,7 +73,7 @@ private:
 	* @param textStream Stream for reading Nexus input file.
 	* @return True if block parsed successfully, otherwise false.
 	*/
-	bool ReadTreesBlock(SplitSystem *const splitSystem, std::ifstream& textStream);
+	bool ReadTreesBlock(SplitSystem *const splitSystem, std::istream& textStream);
 
 	/**
 	* @brief Read SPLITS block.
@@ -82,7 +82,7 @@ private:
 	* @param textStream Stream for reading Nexus input file.
 	* @return True if block parsed successfully, otherwise false.
 	*/
-	bool ReadSplitsBlock(SplitSystem *const splitSystem, std::ifstream& textStream);
+	bool ReadSplitsBlock(SplitSystem *const splitSystem, std::istream& textStream);
 
 private:
 	/** Map nexus id to sequence name. */
@@ -0,0 +1,332 @@
+//=======================================================================
+// Author: Donovan Parks
+//
+// Copyright 2011 Donovan Parks
+//
+// This file is part of ExpressBetaDiversity.
+//
+// ExpressBetaDiversity is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// ExpressBetaDiversity is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ExpressBetaDiversity. If not, see
+// <http://www.gnu.org/licenses/>.
+//=======================================================================
+
+#include "Precompiled.hpp"
+
+#include "NpyMatrixWriter.hpp"
+
+namespace
+{
+	/** Quote and escape a string for JSON. */
+	std::string JsonString(const std::string& str)
+	{
+		std::string quoted = "\"";
+		for(uint i = 0; i < str.size(); ++i)
+		{
+			unsigned char ch = str[i];
+			if(ch == '"' || ch == '\\')
+			{
+				quoted += '\\';
+				quoted += ch;
+			}
+			else if(ch < 0x20)
+			{
+				char escaped[8];
+				sprintf(escaped, "\\u%04x", ch);
+				quoted += escaped;
+			}
+			else
+				quoted += ch;
+		}
+		quoted += '"';
+
+		return quoted;
+	}
+
+	/** Largest number of samples a matrix may have. */
+	const uint64 MAX_SAMPLES = 0xFFFFFFFF;
+
+	/** Get NumPy description of the type of values. */
+	const char* GetDescr(NpyMatrixWriter::VALUE_TYPE valueType)
+	{
+		if(valueType == NpyMatrixWriter::FLOAT32)
+			return "<f4";
+		else if(valueType == NpyMatrixWriter::UINT16)
+			return "<u2";
+		else if(valueType == NpyMatrixWriter::UINT8)
+			return "|u1";
+		else if(valueType == NpyMatrixWriter::FLOAT16)
+			return "<f2";
+
+		return "<f8";
+	}
+
+	/** Get NumPy name of the type of values. */
+	const char* GetTypeName(NpyMatrixWriter::VALUE_TYPE valueType)
+	{
+		if(valueType == NpyMatrixWriter::FLOAT32)
+			return "float32";
+		else if(valueType == NpyMatrixWriter::UINT16)
+			return "uint16";
+		else if(valueType == NpyMatrixWriter::UINT8)
+			return "uint8";
+		else if(valueType == NpyMatrixWriter::FLOAT16)
+			return "float16";
+
+		return "float64";
+	}
+}
+
+NpyMatrixWriter::NpyMatrixWriter(LAYOUT layout, VALUE_TYPE valueType, Quantizer::ROUNDING rounding)
+	: MatrixWriter(layout), m_valueType(valueType), m_headerSize(0), m_numDescribed(0)
+{
+	if(valueType == UINT8)
+		m_quantizer = Quantizer(Quantizer::UINT8, rounding);
+	else if(valueType == FLOAT16)
+		m_quantizer = Quantizer(Quantizer::FLOAT16, rounding);
+	else
+		m_quantizer = Quantizer(Quantizer::UINT16, rounding);
+
+}
+
+std::string NpyMatrixWriter::GetDict(uint64 numSamples) const
+{
+	uint64 numValues = numSamples*(numSamples - (numSamples > 0 ? 1 : 0)) / 2;
+
+	std::stringstream dict;
+	dict << "{'descr': '" << GetDescr(m_valueType) << "', 'fortran_order': False, 'shape': (";
+	if(m_layout == SQUARE)
+		dict << numSamples << ", " << numSamples << "), }";
+	else
+		dict << numValues << ",), }";
+
+	return dict.str();
+}
+
+std::string NpyMatrixWriter::GetHeader(uint64 numSamples) const
+{
+	// version 1.0 header: magic, version, header length, then dictionary padded with spaces and ending in a newline
+	const uint preambleLen = 10;
+	std::string header = GetDict(numSamples);
+
+	// length allows for the largest possible shape, so the header can be rewritten in place as rows are appended
+	uint headerLen = GetDict(MAX_SAMPLES).size() + 1;
+	headerLen += (64 - (preambleLen + headerLen) % 64) % 64;
+	header.resize(headerLen - 1, ' ');
+	header += '\n';
+
+	char preamble[preambleLen] = { '\x93', 'N', 'U', 'M', 'P', 'Y', 1, 0, (char)(headerLen & 0xFF), (char)(headerLen >> 8) };
+
+	return std::string(preamble, preambleLen) + header;
+}
+
+void NpyMatrixWriter::Initialize()
+{
+	m_headerSize = GetHeader(0).size();
+
+	// sidecar file of a resumed matrix already describes all samples
+	m_numDescribed = m_info.sampleNames.size();
+}
+
+bool NpyMatrixWriter::WriteHeader()
+{
+	Append(GetHeader(m_info.sampleNames.size()));
+
+	return WriteMetadata(m_info.sampleNames.size());
+}
+
+bool NpyMatrixWriter::UpdateHeader(uint numSamples) const
+{
+	std::fstream out(m_filename.c_str(), std::ios::in | std::ios::out | std::ios::binary);
+	if(!out.is_open())
+	{
+		std::cerr << "Unable to update header of matrix file: " << m_filename << std::endl;
+		return false;
+	}
+
+	std::string header = GetHeader(numSamples);
+	out.write(header.c_str(), header.size());
+	out.close();
+	if(out.fail())
+	{
+		std::cerr << "Unable to update header of matrix file: " << m_filename << std::endl;
+		return false;
+	}
+
+	return WriteMetadata(numSamples);
+}
+
+uint64 NpyMatrixWriter::GetLayoutRowOffset(uint row) const
+{
+	return m_headerSize + (uint64)row*(row - (row > 0 ? 1 : 0))/2 * GetValueSize();
+}
+
+uint64 NpyMatrixWriter::FormatSegment(uint row, uint firstCol, uint numValues, const double* values, std::vector<char>& buffer) const
+{
+	buffer.resize((uint64)numValues*GetValueSize());
+	if(numValues > 0)
+		ConvertValues(values, numValues, &buffer[0]);
+
+	return GetLayoutRowOffset(row) + (uint64)firstCol*GetValueSize();
+}
+
+uint NpyMatrixWriter::GetValueSize() const
+{
+	if(m_valueType == FLOAT32)
+		return sizeof(float);
+	else if(IsQuantized())
+		return m_quantizer.GetValueSize();
+
+	return sizeof(double);
+}
+
+void NpyMatrixWriter::ConvertValues(const double* values, uint numValues, char* data) const
+{
+	if(m_valueType == FLOAT64)
+	{
+		memcpy(data, values, (uint64)numValues*sizeof(double));
+		return;
+	}
+
+	if(m_valueType == FLOAT32)
+	{
+		float* floatData = (float*)data;
+		for(uint i = 0; i < numValues; ++i)
+			floatData[i] = (float)values[i];
+
+		return;
+	}
+
+	QuantizationError error;
+	m_quantizer.Quantize(values, numValues, data, error);
+
+	#pragma omp critical(QuantizationError)
+	m_error.Add(error);
+}
+
+void NpyMatrixWriter::Finish()
+{
+	if(!IsQuantized() || (m_error.numValues == 0 && m_error.numUndefined == 0))
+		return;
+
+	if(m_error.numClamped > 0 && m_valueType == FLOAT16)
+		std::cout << "(Warning) " << m_error.numClamped << " dissimilarities above 65504 became infinite when quantized to float16." << std::endl;
+	else if(m_error.numClamped > 0)
+		std::cout << "(Warning) " << m_error.numClamped << " dissimilarities outside [0, 1] were clamped when quantized to " << GetTypeName(m_valueType) << "." << std::endl;
+
+	if(m_error.numUndefined > 0 && m_valueType == FLOAT16)
+		std::cout << "(Warning) " << m_error.numUndefined << " dissimilarities were undefined (NaN)." << std::endl;
+	else if(m_error.numUndefined > 0)
+		std::cout << "(Warning) " << m_error.numUndefined << " dissimilarities were undefined (NaN) and were written as the largest " << GetTypeName(m_valueType) << " value." << std::endl;
+
+	WriteMetadata(m_numDescribed);
+}
+
+void NpyMatrixWriter::Report() const
+{
+	if(!IsQuantized())
+		return;
+
+	std::cout << "  Quantization error of " << GetTypeName(m_valueType) << " values (rounding " << m_quantizer.GetRoundingName() << "): ";
+	std::cout << "maximum " << m_error.maxError << ", mean " << m_error.GetMeanError() << " over " << m_error.numValues << " values";
+	if(m_bResume)
+		std::cout << " written by this run";
+	std::cout << "." << std::endl;
+}
+
+bool NpyMatrixWriter::WriteMetadata(uint numSamples) const
+{
+	m_numDescribed = numSamples;
+
+	std::string metadataFile = GetMetadataFilename(m_filename);
+	std::ofstream out(metadataFile.c_str(), std::ios::binary);
+	if(!out.is_open())
+	{
+		std::cerr << "Unable to create matrix metadata file: " << metadataFile << std::endl;
+		return false;
+	}
+
+	out << "{" << std::endl;
+	if(m_layout == SQUARE)
+		out << "  \"layout\": \"square, element [i, j] for samples i and j\"," << std::endl;
+	else
+		out << "  \"layout\": \"condensed lower triangle, element i*(i-1)/2 + j for samples i > j\"," << std::endl;
+	out << "  \"dtype\": \"" << GetTypeName(m_valueType) << "\"," << std::endl;
+	if(m_valueType == UINT16 || m_valueType == UINT8)
+	{
+		// dissimilarity represented by each quantized value is element * scale
+		char scale[32];
+		sprintf(scale, "%.17g", m_quantizer.GetScale());
+		out << "  \"scale\": " << scale << "," << std::endl;
+	}
+	if(IsQuantized())
+	{
+		out << "  \"rounding\": \"" << m_quantizer.GetRoundingName() << "\"," << std::endl;
+
+		// error is only known once all values are written
+		if(m_error.numValues > 0)
+		{
+			char error[32];
+			sprintf(error, "%.6g", m_error.maxError);
+			out << "  \"max_quantization_error\": " << error << "," << std::endl;
+			sprintf(error, "%.6g", m_error.GetMeanError());
+			out << "  \"mean_quantization_error\": " << error << "," << std::endl;
+		}
+		if(m_error.numValues > 0 || m_error.numUndefined > 0)
+		{
+			out << "  \"num_undefined\": " << m_error.numUndefined << "," << std::endl;
+			out << "  \"quantization_error_partial\": " << (m_bResume ? "true" : "false") << "," << std::endl;
+		}
+	}
+	out << "  \"num_samples\": " << numSamples << "," << std::endl;
+	out << "  \"calculator\": " << JsonString(m_info.calculator) << "," << std::endl;
+	out << "  \"weighted\": " << (m_info.bWeighted ? "true" : "false") << "," << std::endl;
+	out << "  \"count\": " << (m_info.bCount ? "true" : "false") << "," << std::endl;
+	out << "  \"input_fingerprint\": \"" << std::hex << m_info.inputFingerprint << "\"," << std::endl;
+	out << "  \"fingerprint\": \"" << m_info.fingerprint << std::dec << "\"," << std::endl;
+	out << "  \"samples\": [";
+	for(uint i = 0; i < numSamples; ++i)
+	{
+		if(i != 0)
+			out << ", ";
+		out << JsonString(m_info.sampleNames[i]);
+	}
+	out << "]" << std::endl;
+	out << "}" << std::endl;
+
+	out.close();
+	if(out.fail())
+	{
+		std::cerr << "Failed to write matrix metadata file: " << metadataFile << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+void NpyMatrixWriter::AppendRows(uint firstRow, uint numRows, const double* values, uint64 rowStride, bool bFullRows)
+{
+	for(uint r = 0; r < numRows; ++r)
+	{
+		const double* rowValues = values + r*rowStride;
+		uint numValues = bFullRows ? m_info.sampleNames.size() : firstRow + r;
+		if(m_valueType == FLOAT64)
+		{
+			Append((const char*)rowValues, (uint64)numValues*sizeof(double));
+			continue;
+		}
+
+		m_rowData.resize((uint64)numValues*GetValueSize() + 1);
+		ConvertValues(rowValues, numValues, &m_rowData[0]);
+		Append(&m_rowData[0], (uint64)numValues*GetValueSize());
+	}
+}
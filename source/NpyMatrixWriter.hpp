@@ -0,0 +1,135 @@
+//=======================================================================
+// Author: Donovan Parks
+//
+// Copyright 2011 Donovan Parks
+//
+// This file is part of ExpressBetaDiversity.
+//
+// ExpressBetaDiversity is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// ExpressBetaDiversity is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ExpressBetaDiversity. If not, see
+// <http://www.gnu.org/licenses/>.
+//=======================================================================
+
+#ifndef _NPY_MATRIX_WRITER_
+#define _NPY_MATRIX_WRITER_
+
+#include "Precompiled.hpp"
+
+#include "MatrixWriter.hpp"
+#include "Quantizer.hpp"
+
+/**
+ * @brief Write a dissimilarity matrix as a NumPy .npy array.
+ *
+ * With the condensed layout, the file is a one-dimensional little-endian array 
+ * holding the rows of the lower triangle one after another, so the dissimilarity between samples 
+ * i > j is element i*(i-1)/2 + j. With the square layout, the file is a two-dimensional array 
+ * in row-major order. The .npy header is padded to a multiple of 64 bytes, so the values can be 
+ * memory-mapped directly (e.g., numpy.load(file, mmap_mode='r')). Sample names, calculator 
+ * settings, and fingerprints of the input data are written to a JSON sidecar file (<file>.json).
+ * The condensed layout is positional. Values of the uint8, uint16, and float16 types are 
+ * quantized by a Quantizer, and the largest and mean error this introduces are added to the 
+ * JSON sidecar file once the matrix is complete. When rows of an earlier run were kept, the 
+ * error only covers rows written by this run and is marked as partial.
+ */
+class NpyMatrixWriter : public MatrixWriter
+{
+public:
+	enum VALUE_TYPE { FLOAT32, FLOAT64, UINT16, UINT8, FLOAT16 };
+
+public:
+	/** Constructor. The pairs layout is not supported. Rounding only applies to the quantized types. */
+	NpyMatrixWriter(LAYOUT layout = CONDENSED, VALUE_TYPE valueType = FLOAT32, Quantizer::ROUNDING rounding = Quantizer::ROUND_NEAREST);
+
+	/** Destructor. */
+	~NpyMatrixWriter() {}
+
+	/** Get path to JSON sidecar file describing a matrix file. */
+	static std::string GetMetadataFilename(const std::string& filename) { return filename + ".json"; }
+
+	/** 
+	 * @brief Rewrite .npy header and JSON sidecar file to describe only the first rows of the matrix.
+	 *
+	 * The header always has room for the largest possible shape, so rows can be appended to a
+	 * condensed matrix and the header updated in place.
+	 *
+	 * @param numSamples Number of samples (rows) in the matrix file.
+	 * @return True if the header and sidecar file were written, else false.
+	 */
+	bool UpdateHeader(uint numSamples) const;
+
+	/** Print the error introduced by quantizing values. */
+	void Report() const;
+
+protected:
+	/** Determine size of .npy header. */
+	void Initialize();
+
+	/** Write .npy header and JSON sidecar file. */
+	bool WriteHeader();
+
+	/** Convert rows to the value type and write them. */
+	void AppendRows(uint firstRow, uint numRows, const double* values, uint64 rowStride, bool bFullRows);
+
+	/** Check if the offset of every row is known in advance. */
+	bool IsPositionalLayout() const { return m_layout == CONDENSED; }
+
+	/** Get offset of a row of the condensed layout. */
+	uint64 GetLayoutRowOffset(uint row) const;
+
+	/** Convert a segment of a row of the condensed layout to the value type. */
+	uint64 FormatSegment(uint row, uint firstCol, uint numValues, const double* values, std::vector<char>& buffer) const;
+
+	/** Report values clamped or undefined when quantizing and add the quantization error to the JSON sidecar file. */
+	void Finish();
+
+private:
+	/** Get .npy header dictionary for a matrix with the given number of samples. */
+	std::string GetDict(uint64 numSamples) const;
+
+	/** Get .npy header for a matrix with the given number of samples. */
+	std::string GetHeader(uint64 numSamples) const;
+
+	/** Write JSON sidecar file describing the given number of samples. */
+	bool WriteMetadata(uint numSamples) const;
+
+	/** Get size of a value in file. */
+	uint GetValueSize() const;
+
+	/** Check if values are quantized to 8 or 16 bits. */
+	bool IsQuantized() const { return m_valueType == UINT16 || m_valueType == UINT8 || m_valueType == FLOAT16; }
+
+	/** Convert values to the value type. Safe to call concurrently from multiple threads. */
+	void ConvertValues(const double* values, uint numValues, char* data) const;
+
+private:
+	/** Type of values in file. */
+	VALUE_TYPE m_valueType;
+
+	/** Values of a row converted to the type written to file. */
+	std::vector<char> m_rowData;
+
+	/** Size of .npy header. */
+	uint64 m_headerSize;
+
+	/** Converts values of the quantized types. */
+	Quantizer m_quantizer;
+
+	/** Error introduced by quantizing values, including the number of values clamped. */
+	mutable QuantizationError m_error;
+
+	/** Number of samples described by the JSON sidecar file. */
+	mutable uint m_numDescribed;
+};
+
+#endif
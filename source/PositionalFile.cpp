@@ -0,0 +1,148 @@
+//=======================================================================
+// Author: Donovan Parks
+//
+// Copyright 2011 Donovan Parks
+//
+// This file is part of ExpressBetaDiversity.
+//
+// ExpressBetaDiversity is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// ExpressBetaDiversity is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ExpressBetaDiversity. If not, see
+// <http://www.gnu.org/licenses/>.
+//=======================================================================
+
+#include "Precompiled.hpp"
+
+#include "PositionalFile.hpp"
+
+#ifdef WIN32
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <unistd.h>
+	#include <errno.h>
+#endif
+
+#ifdef WIN32
+
+PositionalFile::PositionalFile(): m_fileHandle(INVALID_HANDLE_VALUE)
+{
+
+}
+
+bool PositionalFile::Open(const std::string& filename)
+{
+	Close();
+
+	m_fileHandle = CreateFileA(filename.c_str(), GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, 
+															OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+
+	return m_fileHandle != INVALID_HANDLE_VALUE;
+}
+
+bool PositionalFile::Close()
+{
+	if(m_fileHandle == INVALID_HANDLE_VALUE)
+		return true;
+
+	bool bClosed = CloseHandle(m_fileHandle) != 0;
+	m_fileHandle = INVALID_HANDLE_VALUE;
+
+	return bClosed;
+}
+
+bool PositionalFile::IsOpen() const
+{
+	return m_fileHandle != INVALID_HANDLE_VALUE;
+}
+
+bool PositionalFile::Write(uint64 offset, const char* data, uint64 size) const
+{
+	while(size > 0)
+	{
+		DWORD chunk = (DWORD)std::min<uint64>(size, 1 << 30);
+
+		OVERLAPPED overlapped;
+		memset(&overlapped, 0, sizeof(overlapped));
+		overlapped.Offset = (DWORD)(offset & 0xFFFFFFFF);
+		overlapped.OffsetHigh = (DWORD)(offset >> 32);
+
+		DWORD written = 0;
+		if(!WriteFile(m_fileHandle, data, chunk, &written, &overlapped) || written == 0)
+			return false;
+
+		offset += written;
+		data += written;
+		size -= written;
+	}
+
+	return true;
+}
+
+#else
+
+PositionalFile::PositionalFile(): m_fd(-1)
+{
+
+}
+
+bool PositionalFile::Open(const std::string& filename)
+{
+	Close();
+
+	m_fd = open(filename.c_str(), O_WRONLY);
+
+	return m_fd != -1;
+}
+
+bool PositionalFile::Close()
+{
+	if(m_fd == -1)
+		return true;
+
+	bool bClosed = (close(m_fd) == 0);
+	m_fd = -1;
+
+	return bClosed;
+}
+
+bool PositionalFile::IsOpen() const
+{
+	return m_fd != -1;
+}
+
+bool PositionalFile::Write(uint64 offset, const char* data, uint64 size) const
+{
+	// pwrite may write less than requested
+	while(size > 0)
+	{
+		ssize_t written = pwrite(m_fd, data, (size_t)std::min<uint64>(size, 1 << 30), (off_t)offset);
+		if(written < 0 && errno == EINTR)
+			continue;
+
+		if(written <= 0)
+			return false;
+
+		offset += written;
+		data += written;
+		size -= written;
+	}
+
+	return true;
+}
+
+#endif
+
+PositionalFile::~PositionalFile()
+{
+	Close();
+}
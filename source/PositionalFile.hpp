@@ -0,0 +1,76 @@
+//=======================================================================
+// Author: Donovan Parks
+//
+// Copyright 2011 Donovan Parks
+//
+// This file is part of ExpressBetaDiversity.
+//
+// ExpressBetaDiversity is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// ExpressBetaDiversity is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ExpressBetaDiversity. If not, see
+// <http://www.gnu.org/licenses/>.
+//=======================================================================
+
+#ifndef _POSITIONAL_FILE_
+#define _POSITIONAL_FILE_
+
+#include "Precompiled.hpp"
+
+/**
+ * @brief Write data at given offsets of a file.
+ *
+ * Writes do not move a shared file position (pwrite() on POSIX systems and overlapped 
+ * writes on Windows), so any number of threads can write to different parts of the file 
+ * concurrently. Writing past the end of the file extends it.
+ */
+class PositionalFile
+{
+public:
+	/** Constructor. */
+	PositionalFile();
+
+	/** Destructor. */
+	~PositionalFile();
+
+	/**
+	* @brief Open an existing file for writing.
+	*
+	* @param filename Path to file.
+	* @return True if file opened successfully, else false.
+	*/
+	bool Open(const std::string& filename);
+
+	/** Close file. */
+	bool Close();
+
+	/** Check if file is open. */
+	bool IsOpen() const;
+
+	/** Write data at the given offset. Safe to call concurrently from multiple threads. */
+	bool Write(uint64 offset, const char* data, uint64 size) const;
+
+private:
+	/** File is owned by this object so copying is not supported. */
+	PositionalFile(const PositionalFile&);
+	PositionalFile& operator=(const PositionalFile&);
+
+private:
+#ifdef WIN32
+	/** Handle to file. */
+	void* m_fileHandle;
+#else
+	/** File descriptor. */
+	int m_fd;
+#endif
+};
+
+#endif
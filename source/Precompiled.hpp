@@ -24,7 +24,7 @@
 // Reference additional headers your program requires here
 
 #ifndef PRECOMPILED_HPP
-#define PRECOMIPLED_HPP
+#define PRECOMPILED_HPP
 
 // disable checked iterators as this produces a large performance hit
 // (see: http://msdn.microsoft.com/en-us/library/aa985896(VS.80).aspx and google search for SECURE_SCL)
@@ -55,8 +55,20 @@
 
 #ifdef WIN32
 	#include <functional>
+	#include <unordered_map>
 #else
 	#include <tr1/functional>
+	#include <tr1/unordered_map>
+#endif
+
+#ifdef _OPENMP
+	#include <omp.h>
+#else
+	inline int omp_get_thread_num() { return 0; }
+	inline int omp_get_max_threads() { return 1; }
+
+	// processor time of the single thread stands in for elapsed time
+	inline double omp_get_wtime() { return std::clock() / (double)CLOCKS_PER_SEC; }
 #endif
 
 #include "DataTypes.hpp"
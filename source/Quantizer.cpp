@@ -0,0 +1,232 @@
+//=======================================================================
+// Author: Donovan Parks
+//
+// Copyright 2011 Donovan Parks
+//
+// This file is part of ExpressBetaDiversity.
+//
+// ExpressBetaDiversity is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// ExpressBetaDiversity is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ExpressBetaDiversity. If not, see
+// <http://www.gnu.org/licenses/>.
+//=======================================================================
+
+#include "Precompiled.hpp"
+
+#include "Quantizer.hpp"
+
+namespace
+{
+	/** Largest finite half precision value. */
+	const double HALF_MAX = 65504.0;
+
+	/** Bits of positive infinity and of a quiet NaN in half precision. */
+	const unsigned short HALF_INFINITY = 0x7C00;
+	const unsigned short HALF_NAN = 0x7E00;
+
+	/** Smallest exponent of a normal half precision value. */
+	const int HALF_MIN_EXPONENT = -14;
+
+	/** Number of explicit mantissa bits of a half precision value. */
+	const int HALF_MANTISSA_BITS = 10;
+}
+
+void QuantizationError::Add(const QuantizationError& error)
+{
+	numValues += error.numValues;
+	numClamped += error.numClamped;
+	numUndefined += error.numUndefined;
+	maxError = std::max<double>(maxError, error.maxError);
+	sumError += error.sumError;
+}
+
+Quantizer::Quantizer(VALUE_TYPE valueType, ROUNDING rounding)
+	: m_valueType(valueType), m_rounding(rounding)
+{
+
+}
+
+bool Quantizer::ParseRounding(const std::string& name, ROUNDING& rounding)
+{
+	if(name == "nearest")
+		rounding = ROUND_NEAREST;
+	else if(name == "down")
+		rounding = ROUND_DOWN;
+	else if(name == "up")
+		rounding = ROUND_UP;
+	else
+	{
+		std::cerr << "Unknown rounding: " << name << " (expected nearest, down, or up)" << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+std::string Quantizer::GetRoundingName() const
+{
+	if(m_rounding == ROUND_DOWN)
+		return "down";
+	else if(m_rounding == ROUND_UP)
+		return "up";
+
+	return "nearest";
+}
+
+double Quantizer::GetScale() const
+{
+	if(m_valueType == UINT8)
+		return 1.0 / 0xFF;
+	else if(m_valueType == UINT16)
+		return 1.0 / 0xFFFF;
+
+	return 0;
+}
+
+double Quantizer::RoundMagnitude(double value, bool bTowardZero, bool bAwayFromZero) const
+{
+	if(bTowardZero)
+		return floor(value);
+	else if(bAwayFromZero)
+		return ceil(value);
+
+	// round half to even so ties are not biased upwards
+	double rounded = floor(value);
+	double diff = value - rounded;
+	if(diff > 0.5 || (diff == 0.5 && fmod(rounded, 2.0) != 0))
+		rounded += 1;
+
+	return rounded;
+}
+
+uint Quantizer::QuantizeFixed(double value, uint maxElement, bool& bClamped) const
+{
+	bClamped = (value < 0 || value > 1);
+	if(bClamped)
+		return (value > 1) ? maxElement : 0;
+
+	// undefined values have no fixed-point representation
+	if(value != value)
+		return maxElement;
+
+	return (uint)RoundMagnitude(value*maxElement, m_rounding == ROUND_DOWN, m_rounding == ROUND_UP);
+}
+
+unsigned short Quantizer::QuantizeHalf(double value) const
+{
+	if(value != value)
+		return HALF_NAN;
+
+	unsigned short sign = (value < 0) ? 0x8000 : 0;
+	double magnitude = fabs(value);
+	if(magnitude == std::numeric_limits<double>::infinity())
+		return sign | HALF_INFINITY;
+
+	// rounding down reduces the magnitude of positive values and increases that of negative values
+	bool bTowardZero = (m_rounding == ROUND_DOWN && !sign) || (m_rounding == ROUND_UP && sign);
+	bool bAwayFromZero = (m_rounding == ROUND_UP && !sign) || (m_rounding == ROUND_DOWN && sign);
+
+	// spacing of half precision values around the magnitude
+	int exponent;
+	frexp(magnitude, &exponent);
+	exponent = std::max<int>(exponent - 1, HALF_MIN_EXPONENT);
+	double spacing = ldexp(1.0, exponent - HALF_MANTISSA_BITS);
+
+	double rounded = RoundMagnitude(magnitude / spacing, bTowardZero, bAwayFromZero) * spacing;
+	if(rounded > HALF_MAX)
+		return sign | (bTowardZero ? 0x7BFF : HALF_INFINITY);
+
+	if(rounded == 0)
+		return sign;
+
+	// rounding may carry into the next exponent
+	frexp(rounded, &exponent);
+	exponent -= 1;
+	if(exponent < HALF_MIN_EXPONENT)
+		return sign | (unsigned short)ldexp(rounded, -HALF_MIN_EXPONENT + HALF_MANTISSA_BITS);
+
+	unsigned short mantissa = (unsigned short)(ldexp(rounded, HALF_MANTISSA_BITS - exponent) - (1 << HALF_MANTISSA_BITS));
+	return sign | (unsigned short)((exponent + 15) << HALF_MANTISSA_BITS) | mantissa;
+}
+
+double Quantizer::HalfToDouble(unsigned short bits)
+{
+	int exponent = (bits >> HALF_MANTISSA_BITS) & 0x1F;
+	int mantissa = bits & 0x3FF;
+
+	double value;
+	if(exponent == 0)
+		value = ldexp((double)mantissa, HALF_MIN_EXPONENT - HALF_MANTISSA_BITS);
+	else if(exponent == 0x1F)
+		value = (mantissa == 0) ? std::numeric_limits<double>::infinity() : std::numeric_limits<double>::quiet_NaN();
+	else
+		value = ldexp((double)(mantissa + (1 << HALF_MANTISSA_BITS)), exponent - 15 - HALF_MANTISSA_BITS);
+
+	return (bits & 0x8000) ? -value : value;
+}
+
+void Quantizer::Quantize(const double* values, uint numValues, char* data, QuantizationError& error) const
+{
+	error = QuantizationError();
+
+	for(uint i = 0; i < numValues; ++i)
+	{
+		double value = values[i];
+		bool bClamped = false;
+
+		// values are written byte by byte so they are little-endian on any platform
+		if(m_valueType == UINT8)
+			data[i] = (char)QuantizeFixed(value, 0xFF, bClamped);
+		else
+		{
+			uint element;
+			if(m_valueType == UINT16)
+				element = QuantizeFixed(value, 0xFFFF, bClamped);
+			else
+			{
+				// finite values too large for half precision become infinite
+				element = QuantizeHalf(value);
+				bClamped = ((element & 0x7FFF) == HALF_INFINITY && fabs(value) != std::numeric_limits<double>::infinity());
+			}
+
+			data[2*i] = (char)(element & 0xFF);
+			data[2*i + 1] = (char)(element >> 8);
+		}
+
+		if(value != value)
+			error.numUndefined++;
+		else if(bClamped)
+			error.numClamped++;
+
+		// undefined and infinite values have no error
+		double diff = fabs(Dequantize(data + i*GetValueSize()) - value);
+		if(diff != diff || diff == std::numeric_limits<double>::infinity())
+			continue;
+
+		error.numValues++;
+		error.maxError = std::max<double>(error.maxError, diff);
+		error.sumError += diff;
+	}
+}
+
+double Quantizer::Dequantize(const char* data) const
+{
+	const unsigned char* bytes = (const unsigned char*)data;
+	if(m_valueType == UINT8)
+		return bytes[0] * GetScale();
+
+	unsigned short element = (unsigned short)(bytes[0] | (bytes[1] << 8));
+	if(m_valueType == UINT16)
+		return element * GetScale();
+
+	return HalfToDouble(element);
+}
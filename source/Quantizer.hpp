@@ -0,0 +1,134 @@
+//=======================================================================
+// Author: Donovan Parks
+//
+// Copyright 2011 Donovan Parks
+//
+// This file is part of ExpressBetaDiversity.
+//
+// ExpressBetaDiversity is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// ExpressBetaDiversity is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ExpressBetaDiversity. If not, see
+// <http://www.gnu.org/licenses/>.
+//=======================================================================
+
+#ifndef _QUANTIZER_
+#define _QUANTIZER_
+
+#include "Precompiled.hpp"
+
+/**
+ * @brief Error introduced by quantizing a set of values.
+ */
+struct QuantizationError
+{
+	/** Constructor. */
+	QuantizationError(): numValues(0), numClamped(0), numUndefined(0), maxError(0), sumError(0) {}
+
+	/** Add error of another set of values. */
+	void Add(const QuantizationError& error);
+
+	/** Get mean absolute error. */
+	double GetMeanError() const { return numValues > 0 ? sumError / numValues : 0; }
+
+	/** Number of values quantized, excluding undefined values and values which became infinite. */
+	uint64 numValues;
+
+	/** Number of values outside the representable range, which were clamped (fixed point) or became infinite (float16). */
+	uint64 numClamped;
+
+	/** Number of undefined (NaN) values. */
+	uint64 numUndefined;
+
+	/** Largest absolute difference between a value and its quantized value. */
+	double maxError;
+
+	/** Sum of absolute differences between values and their quantized values. */
+	double sumError;
+};
+
+/**
+ * @brief Quantize dissimilarities to 8 or 16 bits.
+ *
+ * The fixed-point types (uint8, uint16) represent dissimilarities in [0, 1] as element / 255 
+ * or element / 65535, with values outside this range clamped. Undefined (NaN) values become 
+ * the largest element, so they read back as maximally dissimilar rather than identical. The 
+ * float16 type is IEEE 754 half precision, converted in software, which has a relative 
+ * precision of about 1e-3 over [6e-5, 65504] and keeps undefined values. Quantized values 
+ * are little-endian.
+ */
+class Quantizer
+{
+public:
+	enum VALUE_TYPE { UINT8, UINT16, FLOAT16 };
+
+	enum ROUNDING { ROUND_NEAREST, ROUND_DOWN, ROUND_UP };
+
+public:
+	/** Constructor. */
+	Quantizer(VALUE_TYPE valueType = UINT16, ROUNDING rounding = ROUND_NEAREST);
+
+	/** Destructor. */
+	~Quantizer() {}
+
+	/**
+	* @brief Determine rounding from its name.
+	*
+	* @param name Name of rounding ('nearest', 'down', or 'up').
+	* @param rounding Set to rounding with the given name.
+	* @return True if the rounding is known, else false.
+	*/
+	static bool ParseRounding(const std::string& name, ROUNDING& rounding);
+
+	/** Get name of rounding. */
+	std::string GetRoundingName() const;
+
+	/** Get size of a quantized value. */
+	uint GetValueSize() const { return m_valueType == UINT8 ? 1 : 2; }
+
+	/** Get dissimilarity represented by an element of value 1 of a fixed-point type, or 0 for float16. */
+	double GetScale() const;
+
+	/**
+	* @brief Quantize values. Safe to call concurrently from multiple threads.
+	*
+	* @param values Values to quantize.
+	* @param numValues Number of values.
+	* @param data Set to quantized values.
+	* @param error Set to error introduced by quantizing the values.
+	*/
+	void Quantize(const double* values, uint numValues, char* data, QuantizationError& error) const;
+
+	/** Get dissimilarity represented by a quantized value. */
+	double Dequantize(const char* data) const;
+
+	/** Convert bits of a half precision value to a double. */
+	static double HalfToDouble(unsigned short bits);
+
+private:
+	/** Quantize a value to a fixed-point element of the given maximum. */
+	uint QuantizeFixed(double value, uint maxElement, bool& bClamped) const;
+
+	/** Quantize a value to the bits of a half precision value. */
+	unsigned short QuantizeHalf(double value) const;
+
+	/** Round a non-negative number to an integer, rounding magnitude down if bTowardZero or up if bAwayFromZero. */
+	double RoundMagnitude(double value, bool bTowardZero, bool bAwayFromZero) const;
+
+private:
+	/** Type of quantized values. */
+	VALUE_TYPE m_valueType;
+
+	/** Rounding of values between two quantized values. */
+	ROUNDING m_rounding;
+};
+
+#endif
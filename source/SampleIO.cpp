@@ -23,7 +23,12 @@
 #include "Precompiled.hpp"
 
 #include "SampleIO.hpp"
-#include "Utils.hpp"
+#include "TextSampleTable.hpp"
+#include "BinarySampleTable.hpp"
+#include "BiomSampleTable.hpp"
+#include "TripletSampleTable.hpp"
+#include "TransposedSampleTable.hpp"
+#include "StreamSampleTable.hpp"
 
 std::string TrimStr(const std::string& Src, const std::string& c = " \r\n")
 {
@@ -39,166 +44,228 @@ std::string TrimStr(const std::string& Src, const std::string& c = " \r\n")
 	return Src.substr(p1, (p2-p1)+1);
 }
 
-SampleIO::SampleIO(): m_bOutgroup(false), m_outgroupIndex(std::numeric_limits<uint>::max())
+const uint SampleIO::NOT_KEPT;
+
+SampleIO::SampleIO(): m_table(NULL), m_numRemovedSeqs(0), m_bOutgroup(false), m_outgroupIndex(std::numeric_limits<uint>::max())
 {
-	m_buffer = NULL;
+
 }
 
 SampleIO::~SampleIO() 
 { 
-	if(m_buffer)
-		delete[] m_buffer;
-
-	if(m_file.is_open())
-		m_file.close(); 
+	delete m_table;
 }
 
-bool SampleIO::Read(const std::string& filename)
+bool SampleIO::Read(const std::string& filename, bool bTaxaAsRows, uint inputMemoryMB)
 {
-	m_file.open(filename.c_str());
-	if(!m_file.is_open())
+	m_filename = filename;
+
+	delete m_table;
+	m_table = NULL;
+
+	bool bStream = StreamSampleTable::IsStream(filename);
+	SparseSampleTable* sparseTable = NULL;
+	if(bStream)
 	{
-		std::cerr << "Unable to open sample file: " << filename << std::endl;
+		// must not be opened to check its format, as the data read would be lost
+		m_table = ReadStream(filename, bTaxaAsRows, inputMemoryMB);
+		if(m_table == NULL)
+			return false;
+	}
+	else if(BinarySampleTable::IsBinary(filename))
+		m_table = new BinarySampleTable();
+	else if(BiomSampleTable::IsBiom(filename))
+		sparseTable = new BiomSampleTable();
+	else if(bTaxaAsRows || TransposedSampleTable::IsTransposed(filename))
+		sparseTable = new TransposedSampleTable();
+	else if(TripletSampleTable::IsTriplet(filename))
+		sparseTable = new TripletSampleTable();
+	else
+		m_table = new TextSampleTable();
+
+	if(sparseTable != NULL)
+	{
+		sparseTable->SetMemoryLimit((uint64)inputMemoryMB * 1024 * 1024);
+		m_table = sparseTable;
+	}
+
+	if(!bStream && !m_table->Open(filename))
 		return false;
+
+	// get order of sequences
+	const std::vector<std::string>& taxa = m_table->GetTaxa();
+	for(uint seqId = 0; seqId < taxa.size(); ++seqId)
+		m_seqNameToId[TrimStr(taxa[seqId])] = seqId;
+
+	// until sequences are removed, sequence ids are the columns of the sample table
+	m_columnToSeqId.assign(taxa.size(), NOT_KEPT);
+	std::map<std::string, uint>::iterator iter;
+	for(iter = m_seqNameToId.begin(); iter != m_seqNameToId.end(); ++iter)
+		m_columnToSeqId[iter->second] = iter->second;
+
+	BuildKeptColumns();
+
+	// get name of each sample
+	for(uint i = 0; i < m_table->GetNumSamples(); ++i)
+	{
+		const std::string& sampleName = m_table->GetSampleName(i);
+		if(sampleName == "outgroup" || sampleName == "Outgroup")
+		{
+			m_bOutgroup = true;
+			m_outgroupIndex = m_sampleNames.size();
+		}
+		else
+			m_sampleNames.push_back(sampleName);
 	}
 
-	// check if file ends with a end-of-line character(s)
-	char c;
-	bool bEndOfLineTerminator = true;
-	m_file.seekg(-1, std::ios::end);
-	m_file.read(&c, 1);
-	if(c != '\n')
-		bEndOfLineTerminator = false;
-	m_file.seekg(0, std::ios::beg);
-
-	// parse header line to get order of sequences
-	std::string line, token;
-	std::getline(m_file, line);
-	std::stringstream ss(line);
-	uint seqId = 0;
-	while(std::getline(ss, token, '\t'))
+	if(!DetermineOutgroupSeqs())
+		return false;
+
+	return true;
+}
+
+SampleTable* SampleIO::ReadStream(const std::string& filename, bool bTaxaAsRows, uint inputMemoryMB) const
+{
+	std::ifstream file;
+	std::istream* in = &std::cin;
+	std::string name = "stdin";
+	if(filename != "-")
 	{
-		if(!token.empty())
+		file.open(filename.c_str(), std::ios::binary);
+		if(!file.is_open())
 		{
-			m_seqNameToId[TrimStr(token)] = seqId;
-			seqId++;
+			std::cerr << "Unable to open sample file: " << filename << std::endl;
+			return NULL;
 		}
+
+		in = &file;
+		name = filename;
 	}
 
-	// get number of samples and starting index of each sample line
-	std::streamsize longestLine = 0;
-	do
+	// a JSON object is a BIOM table; otherwise, take lines up to the first which is not blank or a comment
+	while(in->peek() == ' ' || in->peek() == '\r' || in->peek() == '\n')
+		in->get();
+
+	std::string prefix;
+	std::string line;
+	SparseSampleTable* table = NULL;
+	if(in->peek() == '{')
+		table = new BiomSampleTable();
+	else
 	{
-		if(!line.empty())
+		while(std::getline(*in, line))
 		{
-			if(!m_sampleStreamPos.empty())
-			{
-				uint pos = line.find('\t');
-				std::string sampleName = line.substr(0, pos);
-				if(sampleName == "outgroup" || sampleName == "Outgroup")
-				{
-					m_bOutgroup = true;
-					m_outgroupIndex = m_sampleNames.size();
-				}
-				else
-					m_sampleNames.push_back(sampleName);
-
-				std::streamsize lineLen = m_file.tellg() - m_sampleStreamPos[m_sampleStreamPos.size()-1] + 2; // +2 is for end-of-line character
-				if(lineLen > longestLine)
-					longestLine = lineLen;
-			}
+			prefix += line + '\n';
+			if(!line.empty() && line != "\r" && !TransposedSampleTable::IsComment(line))
+				break;
+		}
 
-			m_sampleStreamPos.push_back(m_file.tellg());
+		if(line.compare(0, 8, "NDCOUNTS") == 0)
+		{
+			std::cerr << "Binary sample files can not be read from stdin or a pipe: " << name << std::endl;
+			return NULL;
 		}
-	} while(std::getline(m_file, line));
-	m_file.clear();
 
-	// allocate temporary buffer for reading lines
-	m_buffer = new char[longestLine];
+		if(bTaxaAsRows || TransposedSampleTable::IsHeaderLine(line))
+			table = new TransposedSampleTable();
+		else if(TripletSampleTable::IsTripletLine(line))
+			table = new TripletSampleTable();
+		else
+			table = new StreamSampleTable();
+	}
 
-	if(!bEndOfLineTerminator)
+	table->SetMemoryLimit((uint64)inputMemoryMB * 1024 * 1024);
+
+	PrefixStreamBuf buffer(prefix, in->rdbuf());
+	std::istream stream(&buffer);
+	if(!table->Read(stream, name))
 	{
-		int endOfLineLen = 1;
-		#if defined(WIN32) || defined(_WIN32) || defined(__WIN32) && !defined(__CYGWIN__)
-			endOfLineLen = 2;
-		#endif
-	
-		m_file.seekg(endOfLineLen, std::ios::end);
-		m_sampleStreamPos[m_sampleStreamPos.size()-1] = m_file.tellg();
+		delete table;
+		return NULL;
 	}
 
-	DetermineOutgroupSeqs();
+	return table;
+}
 
-	return true;
+bool SampleIO::WriteBinary(const std::string& filename) const
+{
+	return BinarySampleTable::Write(*m_table, filename);
 }
 
-void SampleIO::GetData(uint index, std::vector<double>& count, double& totalNumSeq)
+uint SampleIO::GetLineIndex(uint sampleId) const
 {
-	// read the ith sample from file
-	m_file.clear();
-	m_file.seekg(m_sampleStreamPos[index]);
-	
-	std::streamsize charsInLine = m_sampleStreamPos[index+1] - m_sampleStreamPos[index] - 1;
-	m_file.read(m_buffer, charsInLine);
-	m_buffer[charsInLine] = 0;
-	
-	// read sample name
-	char* curPos = (char *)memchr(m_buffer, '\t', (size_t)charsInLine);
-	++curPos;
-	charsInLine -= (curPos - m_buffer);
-
-	// read count data
-	totalNumSeq = 0;
-	count.clear();
-	count.reserve(GetNumIngroupSeqs());
-	uint seqId = 0;
-	do
-	{
-		char* tabPos = (char *)memchr(curPos, '\t', charsInLine);
-		if(tabPos != NULL)
-			tabPos[0] = 0;
+	// sample ids exclude the outgroup so skip over its line
+	uint index = sampleId;
+	if(m_bOutgroup && sampleId >= m_outgroupIndex)
+		index++;
 
-		double numSeq = fast_atof(curPos);
-		if(m_removedSeqIds.count(seqId) == 0)
-		{
-			count.push_back(numSeq);
-			totalNumSeq += numSeq;		
-		}
+	return index;
+}
+
+bool SampleIO::GetData(uint sampleId, std::vector<double>& count, double& totalNumSeq) const
+{
+	return ReadSampleLine(GetLineIndex(sampleId), count, totalNumSeq);
+}
+
+void SampleIO::SetAccessPattern(MappedFile::ACCESS_PATTERN accessPattern) const
+{
+	m_table->SetAccessPattern(accessPattern);
+}
+
+void SampleIO::Prefetch(uint firstSampleId, uint numSamples) const
+{
+	if(numSamples == 0 || firstSampleId >= GetNumSamples())
+		return;
 
-		charsInLine -= (tabPos - curPos) + 1;
-		curPos = tabPos + 1;
-		seqId++;
-	}while(count.size() != GetNumIngroupSeqs());
+	uint lastSampleId = std::min<uint>(firstSampleId + numSamples, GetNumSamples()) - 1;
+	uint firstIndex = GetLineIndex(firstSampleId);
+	uint lastIndex = GetLineIndex(lastSampleId);
+
+	m_table->Prefetch(firstIndex, lastIndex - firstIndex + 1);
+}
+
+bool SampleIO::ReadSampleLine(uint index, std::vector<double>& count, double& totalNumSeq) const
+{
+	// counts of ingroup sequences are read directly into place; removed columns are skipped
+	count.assign(GetNumIngroupSeqs(), 0);
+	if(!m_table->GetCounts(index, m_columnToSeqId, m_keptColumns, count))
+		return false;
+
+	totalNumSeq = 0;
+	for(uint seqId = 0; seqId < count.size(); ++seqId)
+		totalNumSeq += count[seqId];
+
+	return true;
 }
 
-void SampleIO::DetermineOutgroupSeqs()
+bool SampleIO::DetermineOutgroupSeqs()
 {
 	if(m_bOutgroup)
 	{
+		// sequence ids still match columns, so names can be looked up by id
+		std::vector<const std::string*> seqIdToName(m_columnToSeqId.size(), NULL);
+		std::map<std::string, uint>::iterator iter;
+		for(iter = m_seqNameToId.begin(); iter != m_seqNameToId.end(); ++iter)
+			seqIdToName[iter->second] = &iter->first;
+
 		// determine outgroup sequences and remove from ingroup 
 		std::vector<double> count;
 		double totalNumSeq;
-		GetData(m_outgroupIndex, count, totalNumSeq);
-		std::map<std::string, uint> ingroupSeqNameToId;
+		if(!ReadSampleLine(m_outgroupIndex, count, totalNumSeq))
+			return false;
+
 		for(uint seqId = 0; seqId < count.size(); ++seqId)
 		{
 			if(count[seqId] > 0)
 			{
 				m_outgroupSeqIds.insert(seqId);
-
-				// find sequence with the specified id
-				std::map<std::string, uint>::iterator iter;
-				for (iter = m_seqNameToId.begin(); iter != m_seqNameToId.end(); ++iter)
-				{
-					if(iter->second == seqId)
-					{
-						m_outgroupSeqs.insert(iter->first);
-						break;
-					}
-				}
+				if(seqIdToName[seqId] != NULL)
+					m_outgroupSeqs.insert(*seqIdToName[seqId]);
 			}
 		}
 	}
+
+	return true;
 }
 
 void SampleIO::CheckForMissingSeqs(const std::set<std::string>& seqsInPhylogeny)
@@ -251,20 +318,44 @@ void SampleIO::RemoveSeqs(const std::set<uint>& seqIdsToRemove)
 		seqIdToSeqName[iter->second] = iter->first;
 
 	std::map<std::string, uint> ingroupSeqNameToId;
+	m_columnToSeqId.assign(m_columnToSeqId.size(), NOT_KEPT);
 	uint removedSeqCount = 0;
 	std::map<uint, std::string>::iterator iter2;
 	for(iter2 = seqIdToSeqName.begin(); iter2 != seqIdToSeqName.end(); ++iter2)
 	{
 		if(seqIdsToRemove.count(iter2->first) == 0)
+		{
 			ingroupSeqNameToId[iter2->second] = iter2->first - removedSeqCount;
+			m_columnToSeqId[iter2->first] = iter2->first - removedSeqCount;
+		}
 		else
-		{
-			m_removedSeqIds.insert(iter2->first);
 			removedSeqCount++;
-		}
 	}
 
+	m_numRemovedSeqs = removedSeqCount;
 	m_seqNameToId = ingroupSeqNameToId;
+
+	BuildKeptColumns();
+}
+
+void SampleIO::BuildKeptColumns()
+{
+	m_keptColumns.assign((m_columnToSeqId.size() + 63) / 64, 0);
+	for(uint column = 0; column < m_columnToSeqId.size(); ++column)
+	{
+		if(m_columnToSeqId[column] != NOT_KEPT)
+			m_keptColumns[column / 64] |= uint64(1) << (column % 64);
+	}
+}
+
+std::vector<std::string> SampleIO::GetIngroupSeqNames() const
+{
+	std::vector<std::string> names(m_seqNameToId.size());
+	std::map<std::string, uint>::const_iterator iter;
+	for(iter = m_seqNameToId.begin(); iter != m_seqNameToId.end(); ++iter)
+		names[iter->second] = iter->first;
+
+	return names;
 }
 
 bool SampleIO::GetSeqId(const std::string& name, uint& seqId) 
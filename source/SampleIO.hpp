@@ -25,6 +25,8 @@
 
 #include "Precompiled.hpp"
 
+#include "SampleTable.hpp"
+
 /**
  * @brief Read file indicating number of times each sequence is found in a sample.
  */
@@ -40,10 +42,24 @@ public:
 	/**
 	* @brief Open sample file.
 	*
+	* The sample file may be a tab-delimited table (with samples or taxa as rows), (sample, taxon, count) 
+	* lines, a BIOM 1.0 table, or a binary sample table (see BinarySampleTable). For tab-delimited 
+	* tables with samples as rows, an index is saved to <filename>.idx and reused by later runs 
+	* while the sample file is unchanged. Text sample files may be gzip or zstd compressed.
+	* A filename of '-' reads from stdin; stdin and pipes are read once into a sparse table.
+	*
 	* @param filename Path to sample file.
+	* @param bTaxaAsRows Flag indicating tab-delimited table has taxa as rows and samples as columns.
+	* @param inputMemoryMB Memory for counts read from sparse or transposed tables before they are spilled to disk.
 	* @return True if file opened successfully, else false.
 	*/
-	bool Read(const std::string& filename);
+	bool Read(const std::string& filename, bool bTaxaAsRows = false, uint inputMemoryMB = 1024);
+
+	/** Write all samples, including any outgroup sample, to a binary sample table. */
+	bool WriteBinary(const std::string& filename) const;
+
+	/** Get path to sample file. */
+	const std::string& GetFilename() const { return m_filename; }
 
 	/** Get number of samples. */
 	uint GetNumSamples() const { return m_sampleNames.size(); }
@@ -52,19 +68,28 @@ public:
 	std::string GetSampleName(uint index) const { return m_sampleNames.at(index); }
 
 	/** Get number of sequences (including outgroup and missing sequences). */
-	uint GetNumSeqs() const { return m_seqNameToId.size() + m_removedSeqIds.size(); }
+	uint GetNumSeqs() const { return m_seqNameToId.size() + m_numRemovedSeqs; }
 
 	/** Get number of ingroup sequences (excludes outgroup and missing sequences). */
 	uint GetNumIngroupSeqs() const { return m_seqNameToId.size(); }
 
+	/** Get name of each ingroup sequence, indexed by sequence id. */
+	std::vector<std::string> GetIngroupSeqNames() const;
+
 	/** Get sequence id. */
 	bool GetSeqId(const std::string& name, uint& seqId);
 
 	/** Check for sequence with the specified name. */
 	bool IsSeq(const std::string& name);
 
-	/** Get count data for specified sample. */
-	void GetData(uint index, std::vector<double>& count, double& totalNumSeq);
+	/** Get count data for specified sample (ids exclude the outgroup sample). Returns false if the sample could not be read. Safe to call concurrently from multiple threads. */
+	bool GetData(uint sampleId, std::vector<double>& count, double& totalNumSeq) const;
+
+	/** Hint at how samples will be accessed. */
+	void SetAccessPattern(MappedFile::ACCESS_PATTERN accessPattern) const;
+
+	/** Hint that the given range of samples will be read soon. */
+	void Prefetch(uint firstSampleId, uint numSamples) const;
 
 	/** Get name of outgroup sequences. */
 	std::set<std::string> GetOutgroupSeqs() { return m_outgroupSeqs; };
@@ -72,25 +97,41 @@ public:
 	/** Check if there is an outgroup. */
 	bool IsOutgroup() const { return m_bOutgroup; }
 
-	/** Get outgroup sample id. */
+	/** Get line of outgroup sample in sample file. */
 	uint GetOutgroupSampleId() const { return m_outgroupIndex; }
 
 	/** Check for sequences in sample file not in the phylogeny. */
 	void CheckForMissingSeqs(const std::set<std::string>& seqsInPhylogeny);
 
 private:
+	/** Sample table is owned by this object so copying is not supported. */
+	SampleIO(const SampleIO&);
+	SampleIO& operator=(const SampleIO&);
+
+	/** Read a sample file which can only be read once, determining its format from the first line. */
+	SampleTable* ReadStream(const std::string& filename, bool bTaxaAsRows, uint inputMemoryMB) const;
+
+	/** Get index of sample in sample table (which includes the outgroup sample) for a sample id. */
+	uint GetLineIndex(uint sampleId) const;
+
+	/** Read count data of ingroup sequences from the specified sample of the sample table (which includes the outgroup sample). */
+	bool ReadSampleLine(uint index, std::vector<double>& count, double& totalNumSeq) const;
+
 	/** Determine which, if any, sequences belong to the outgroup. */
-	void DetermineOutgroupSeqs();
+	bool DetermineOutgroupSeqs();
 
 	/** Remove sequences with the specified ids. */
 	void RemoveSeqs(const std::set<uint>& seqIdsToRemove);
 
+	/** Set mask of kept columns from the ingroup sequence id of each column. */
+	void BuildKeptColumns();
+
 private:
-	/** File stream. */
-	std::ifstream m_file;
+	/** Path to sample file. */
+	std::string m_filename;
 
-	/** Start of each sample in sample count file. */
-	std::vector<std::streampos> m_sampleStreamPos;
+	/** Table of sample data. Safe to read from concurrently. */
+	SampleTable* m_table;
 
 	/** Name of sequences (only for ingroup sequences). */
 	std::map<std::string, uint> m_seqNameToId;
@@ -104,11 +145,17 @@ private:
 	/** Seq ids of outgroup sequences. */
 	std::set<uint> m_outgroupSeqIds;
 
-	/** Sequences remove from consideration. */
-	std::set<uint> m_removedSeqIds;
+	/** Number of sequences removed from consideration. */
+	uint m_numRemovedSeqs;
+
+	/** Ingroup sequence id of each column in the sample table (NOT_KEPT for removed columns). */
+	std::vector<uint> m_columnToSeqId;
+
+	/** Bitmask of columns in the sample table which are kept, 64 columns per word. */
+	std::vector<uint64> m_keptColumns;
 
-	/** Temporary buffer for reading sample data. */
-	char* m_buffer;
+	/** Marks a column which is not kept. */
+	static const uint NOT_KEPT = 0xFFFFFFFF;
 
 	/** Flag indicating if there is an outgroup sample. Must be labelled 'outgroup' or 'Outgroup'. */
 	bool m_bOutgroup;
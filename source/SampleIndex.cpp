@@ -0,0 +1,285 @@
+//=======================================================================
+// Author: Donovan Parks
+//
+// Copyright 2011 Donovan Parks
+//
+// This file is part of ExpressBetaDiversity.
+//
+// ExpressBetaDiversity is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// ExpressBetaDiversity is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ExpressBetaDiversity. If not, see
+// <http://www.gnu.org/licenses/>.
+//=======================================================================
+
+#include "Precompiled.hpp"
+
+#include "SampleIndex.hpp"
+#include "Utils.hpp"
+
+// identifies index files and the layout of this version
+const char INDEX_MAGIC[8] = { 'N', 'D', 'S', 'I', 'D', 'X', '0', '2' };
+
+// written in native byte order so an index from a machine with different endianness is rejected
+const uint INDEX_BYTE_ORDER = 0x01020304;
+
+// number of bytes at the start and end of a sample file included in its fingerprint
+const uint64 FINGERPRINT_BYTES = 65536;
+
+namespace
+{
+	template<typename T> void WriteValue(std::ofstream& out, const T& value)
+	{
+		out.write((const char*)&value, sizeof(T));
+	}
+
+	void WriteString(std::ofstream& out, const std::string& str)
+	{
+		WriteValue(out, (uint)str.size());
+		out.write(str.c_str(), str.size());
+	}
+
+	template<typename T> bool ReadValue(std::ifstream& in, T& value)
+	{
+		return (bool)in.read((char*)&value, sizeof(T));
+	}
+
+	bool ReadString(std::ifstream& in, std::string& str)
+	{
+		uint len;
+		if(!ReadValue(in, len))
+			return false;
+
+		str.resize(len);
+		return len == 0 || (bool)in.read(&str[0], len);
+	}
+}
+
+SampleIndex::SampleIndex(): m_maxLineLen(0)
+{
+
+}
+
+uint64 SampleIndex::Fingerprint(const std::string& sampleFile, const MappedFile& file)
+{
+	uint64 hash = HASH_SEED;
+	HashFileInfo(sampleFile, hash);
+
+	uint64 headLen = std::min<uint64>(FINGERPRINT_BYTES, file.GetSize());
+	hash = HashBytes(file.GetData(), (size_t)headLen, hash);
+
+	uint64 tailStart = file.GetSize() - std::min<uint64>(FINGERPRINT_BYTES, file.GetSize());
+	hash = HashBytes(file.GetData() + tailStart, (size_t)(file.GetSize() - tailStart), hash);
+
+	return hash;
+}
+
+void SampleIndex::Clear()
+{
+	m_taxa.clear();
+	m_names.clear();
+	m_lineStart.clear();
+	m_lineEnd.clear();
+	m_maxLineLen = 0;
+}
+
+void SampleIndex::AddLine(const char* line, uint64 start, uint64 end, bool& bHeader)
+{
+	uint64 contentLen = end - start;
+	if(contentLen > 0 && line[contentLen-1] == '\r')
+		contentLen--;
+
+	if(contentLen == 0)
+		return;
+
+	if(bHeader)
+	{
+		// parse header line to get order of sequences
+		std::stringstream ss(std::string(line, line + contentLen));
+		std::string token;
+		while(std::getline(ss, token, '\t'))
+		{
+			if(!token.empty())
+				m_taxa.push_back(token);
+		}
+
+		bHeader = false;
+	}
+	else
+	{
+		const char* tabPos = (const char*)memchr(line, '\t', (size_t)contentLen);
+		m_names.push_back(std::string(line, (tabPos != NULL) ? tabPos : line + contentLen));
+		m_lineStart.push_back(start);
+		m_lineEnd.push_back(end);
+		m_maxLineLen = std::max<uint64>(m_maxLineLen, end - start);
+	}
+}
+
+bool SampleIndex::Build(const MappedFile& file)
+{
+	Clear();
+
+	const char* data = file.GetData();
+	uint64 fileSize = file.GetSize();
+
+	// find start and end of each non-empty line; the first is the header
+	bool bHeader = true;
+	uint64 pos = 0;
+	while(pos < fileSize)
+	{
+		const char* eol = (const char*)memchr(data + pos, '\n', (size_t)(fileSize - pos));
+		uint64 end = (eol != NULL) ? (eol - data) : fileSize;
+
+		AddLine(data + pos, pos, end, bHeader);
+
+		pos = end + 1;
+	}
+
+	return !bHeader;
+}
+
+bool SampleIndex::Build(const CompressedFile& file)
+{
+	Clear();
+
+	// decompress a batch of blocks in parallel, then find lines in them in order
+	uint batchSize = omp_get_max_threads();
+	std::vector< std::vector<char> > blocks(batchSize);
+
+	// data from the start of the current line onwards
+	std::vector<char> pending;
+	uint64 pendingStart = 0;
+
+	bool bHeader = true;
+	for(uint firstBlock = 0; firstBlock < file.GetNumBlocks(); firstBlock += batchSize)
+	{
+		uint numBlocks = std::min<uint>(batchSize, file.GetNumBlocks() - firstBlock);
+		std::vector<int> bDecompressed(numBlocks);
+
+		#pragma omp parallel for schedule(dynamic)
+		for(int i = 0; i < (int)numBlocks; ++i)
+			bDecompressed[i] = file.ReadBlock(firstBlock + i, blocks[i]);
+
+		for(uint i = 0; i < numBlocks; ++i)
+		{
+			if(!bDecompressed[i])
+			{
+				std::cerr << "Error decompressing sample file." << std::endl;
+				return false;
+			}
+
+			pending.insert(pending.end(), blocks[i].begin(), blocks[i].end());
+
+			uint64 pos = 0;
+			const char* eol;
+			while(pos < pending.size() && (eol = (const char*)memchr(&pending[pos], '\n', pending.size() - pos)) != NULL)
+			{
+				uint64 end = eol - &pending[0];
+				AddLine(&pending[pos], pendingStart + pos, pendingStart + end, bHeader);
+				pos = end + 1;
+			}
+
+			pending.erase(pending.begin(), pending.begin() + pos);
+			pendingStart += pos;
+		}
+	}
+
+	// final line without an end-of-line character
+	if(!pending.empty())
+		AddLine(&pending[0], pendingStart, pendingStart + pending.size(), bHeader);
+
+	return !bHeader;
+}
+
+bool SampleIndex::Load(const std::string& indexFile, uint64 fingerprint)
+{
+	std::ifstream in(indexFile.c_str(), std::ios::binary);
+	if(!in.is_open())
+		return false;
+
+	char magic[sizeof(INDEX_MAGIC)];
+	uint byteOrder;
+	uint64 indexFingerprint;
+	if(!in.read(magic, sizeof(magic)) || memcmp(magic, INDEX_MAGIC, sizeof(magic)) != 0)
+		return false;
+
+	if(!ReadValue(in, byteOrder) || byteOrder != INDEX_BYTE_ORDER)
+		return false;
+
+	if(!ReadValue(in, indexFingerprint) || indexFingerprint != fingerprint)
+		return false;
+
+	uint numTaxa;
+	if(!ReadValue(in, numTaxa))
+		return false;
+
+	m_taxa.resize(numTaxa);
+	for(uint i = 0; i < numTaxa; ++i)
+	{
+		if(!ReadString(in, m_taxa[i]))
+			return false;
+	}
+
+	uint numLines;
+	if(!ReadValue(in, numLines) || !ReadValue(in, m_maxLineLen))
+		return false;
+
+	m_names.resize(numLines);
+	m_lineStart.resize(numLines);
+	m_lineEnd.resize(numLines);
+	for(uint i = 0; i < numLines; ++i)
+	{
+		if(!ReadString(in, m_names[i]) || !ReadValue(in, m_lineStart[i]) || !ReadValue(in, m_lineEnd[i]))
+			return false;
+	}
+
+	return true;
+}
+
+bool SampleIndex::Save(const std::string& indexFile, uint64 fingerprint) const
+{
+	// write to a temporary file of this process which replaces the index once complete, 
+	// so concurrent runs never see a partially written index
+	std::string tempFile = TempSiblingFilename(indexFile);
+	std::ofstream out(tempFile.c_str(), std::ios::binary);
+	if(!out.is_open())
+		return false;
+
+	out.write(INDEX_MAGIC, sizeof(INDEX_MAGIC));
+	WriteValue(out, INDEX_BYTE_ORDER);
+	WriteValue(out, fingerprint);
+
+	WriteValue(out, (uint)m_taxa.size());
+	for(uint i = 0; i < m_taxa.size(); ++i)
+		WriteString(out, m_taxa[i]);
+
+	WriteValue(out, (uint)m_names.size());
+	WriteValue(out, m_maxLineLen);
+	for(uint i = 0; i < m_names.size(); ++i)
+	{
+		WriteString(out, m_names[i]);
+		WriteValue(out, m_lineStart[i]);
+		WriteValue(out, m_lineEnd[i]);
+	}
+
+	out.close();
+	if(out.fail())
+	{
+		remove(tempFile.c_str());
+		return false;
+	}
+
+#ifdef WIN32
+	remove(indexFile.c_str());
+#endif
+
+	return rename(tempFile.c_str(), indexFile.c_str()) == 0;
+}
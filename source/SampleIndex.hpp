@@ -0,0 +1,110 @@
+//=======================================================================
+// Author: Donovan Parks
+//
+// Copyright 2011 Donovan Parks
+//
+// This file is part of ExpressBetaDiversity.
+//
+// ExpressBetaDiversity is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// ExpressBetaDiversity is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ExpressBetaDiversity. If not, see
+// <http://www.gnu.org/licenses/>.
+//=======================================================================
+
+#ifndef _SAMPLE_INDEX_
+#define _SAMPLE_INDEX_
+
+#include "Precompiled.hpp"
+
+#include "MappedFile.hpp"
+#include "CompressedFile.hpp"
+
+/**
+ * @brief Index of a sample file giving the taxa in its header and the name and location of each sample.
+ *
+ * The index is saved to a sidecar file (<sample file>.idx) so later runs over the same 
+ * sample file do not need to scan it. A saved index is only used if the size, modification
+ * time, and first and last 64 KB of the sample file match those recorded in the index.
+ */
+class SampleIndex
+{
+public:
+	/** Constructor. */
+	SampleIndex();
+
+	/** Destructor. */
+	~SampleIndex() {}
+
+	/** Get fingerprint of a sample file from its size, modification time, and first and last 64 KB. */
+	static uint64 Fingerprint(const std::string& sampleFile, const MappedFile& file);
+
+	/** Build index by scanning a sample file. */
+	bool Build(const MappedFile& file);
+
+	/** Build index by scanning a compressed sample file. Line offsets are into the decompressed data. */
+	bool Build(const CompressedFile& file);
+
+	/**
+	* @brief Load a saved index.
+	*
+	* @param indexFile Path to index file.
+	* @param fingerprint Fingerprint of the sample file the index must have been built from.
+	* @return True if a matching index was loaded, else false.
+	*/
+	bool Load(const std::string& indexFile, uint64 fingerprint);
+
+	/** Save index. */
+	bool Save(const std::string& indexFile, uint64 fingerprint) const;
+
+	/** Get name of taxa in header line, in order. */
+	const std::vector<std::string>& GetTaxa() const { return m_taxa; }
+
+	/** Get number of sample lines (including any outgroup sample). */
+	uint GetNumLines() const { return m_names.size(); }
+
+	/** Get sample name on a line. */
+	const std::string& GetName(uint line) const { return m_names[line]; }
+
+	/** Get offset to start of a sample line. */
+	uint64 GetLineStart(uint line) const { return m_lineStart[line]; }
+
+	/** Get offset to end-of-line character, or end of file, of a sample line. */
+	uint64 GetLineEnd(uint line) const { return m_lineEnd[line]; }
+
+	/** Get length of longest sample line. */
+	uint64 GetMaxLineLength() const { return m_maxLineLen; }
+
+private:
+	/** Remove all entries from index. */
+	void Clear();
+
+	/** Add a line starting at the given offset and ending at an end-of-line character or end of file. */
+	void AddLine(const char* line, uint64 start, uint64 end, bool& bHeader);
+
+private:
+	/** Name of taxa in header line. */
+	std::vector<std::string> m_taxa;
+
+	/** Name of sample on each line. */
+	std::vector<std::string> m_names;
+
+	/** Offset to start of each sample line. */
+	std::vector<uint64> m_lineStart;
+
+	/** Offset to end of each sample line. */
+	std::vector<uint64> m_lineEnd;
+
+	/** Length of longest sample line. */
+	uint64 m_maxLineLen;
+};
+
+#endif
@@ -0,0 +1,80 @@
+//=======================================================================
+// Author: Donovan Parks
+//
+// Copyright 2011 Donovan Parks
+//
+// This file is part of ExpressBetaDiversity.
+//
+// ExpressBetaDiversity is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// ExpressBetaDiversity is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ExpressBetaDiversity. If not, see
+// <http://www.gnu.org/licenses/>.
+//=======================================================================
+
+#ifndef _SAMPLE_TABLE_
+#define _SAMPLE_TABLE_
+
+#include "Precompiled.hpp"
+
+#include "MappedFile.hpp"
+
+/**
+ * @brief Interface to a table giving the number of times each sequence (taxon) is found in each sample.
+ *
+ * Samples are indexed in the order they appear in the table, including any outgroup sample. 
+ * All methods other than Open() must be safe to call concurrently from multiple threads.
+ */
+class SampleTable
+{
+public:
+	/** Destructor. */
+	virtual ~SampleTable() {}
+
+	/**
+	* @brief Open sample table.
+	*
+	* @param filename Path to sample table.
+	* @return True if table opened successfully, else false.
+	*/
+	virtual bool Open(const std::string& filename) = 0;
+
+	/** Get name of taxa, in the order their counts are given. */
+	virtual const std::vector<std::string>& GetTaxa() const = 0;
+
+	/** Get number of samples (including any outgroup sample). */
+	virtual uint GetNumSamples() const = 0;
+
+	/** Get name of sample. */
+	virtual const std::string& GetSampleName(uint index) const = 0;
+
+	/** Get count of each taxon in a sample. Returns false if the sample could not be read. */
+	virtual bool GetCounts(uint index, std::vector<double>& count) const = 0;
+
+	/**
+	* @brief Get count of each kept taxon in a sample. Counts of other taxa are not read.
+	*
+	* @param index Index of sample.
+	* @param columnToIndex Position in count of each kept taxon.
+	* @param keptColumns Bit mask of kept taxa, 64 taxa per word.
+	* @param count Set to count of each kept taxon. Must be sized and zeroed by the caller.
+	* @return True if sample was read successfully, else false.
+	*/
+	virtual bool GetCounts(uint index, const std::vector<uint>& columnToIndex, const std::vector<uint64>& keptColumns, std::vector<double>& count) const = 0;
+
+	/** Hint at how samples will be accessed. */
+	virtual void SetAccessPattern(MappedFile::ACCESS_PATTERN accessPattern) const {}
+
+	/** Hint that the given range of samples will be read soon. */
+	virtual void Prefetch(uint firstIndex, uint numSamples) const {}
+};
+
+#endif
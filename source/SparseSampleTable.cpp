@@ -0,0 +1,480 @@
+//=======================================================================
+// Author: Donovan Parks
+//
+// Copyright 2011 Donovan Parks
+//
+// This file is part of ExpressBetaDiversity.
+//
+// ExpressBetaDiversity is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// ExpressBetaDiversity is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ExpressBetaDiversity. If not, see
+// <http://www.gnu.org/licenses/>.
+//=======================================================================
+
+#include "Precompiled.hpp"
+
+#include "SparseSampleTable.hpp"
+#include "Utils.hpp"
+
+namespace
+{
+	/** Largest number of runs merged at once, which bounds the number of open files. */
+	const uint MAX_MERGE_RUNS = 64;
+
+	/** Count as written to a spill file. */
+	struct SpillRecord
+	{
+		uint sampleIndex;
+		uint taxonId;
+		double count;
+	};
+
+	/** Read records of a single run from a spill file through a small buffer. */
+	class SpillRunReader
+	{
+	public:
+		SpillRunReader(const std::string& filename, uint64 offset, uint64 numRecords)
+			: m_in(filename.c_str(), std::ios::binary), m_remaining(numRecords), m_pos(0)
+		{
+			m_in.seekg(offset);
+		}
+
+		/** Check that the run could be opened and all records read so far were read successfully. */
+		bool IsGood() const { return m_in.is_open() && !m_in.fail(); }
+
+		bool Next(SpillRecord& record)
+		{
+			if(m_pos == m_buffer.size())
+			{
+				if(m_remaining == 0)
+					return false;
+
+				uint64 numToRead = std::min<uint64>(m_remaining, BUFFER_RECORDS);
+				m_buffer.resize((size_t)numToRead);
+				m_in.read((char*)&m_buffer[0], numToRead*sizeof(SpillRecord));
+				if(!m_in)
+					return false;
+
+				m_remaining -= numToRead;
+				m_pos = 0;
+			}
+
+			record = m_buffer[m_pos++];
+			return true;
+		}
+
+	private:
+		static const uint BUFFER_RECORDS = 4096;
+
+		std::ifstream m_in;
+		uint64 m_remaining;
+		std::vector<SpillRecord> m_buffer;
+		size_t m_pos;
+	};
+
+	/** Merge consecutive runs of a spill file, each sorted by sample and then taxon, into a single sorted sequence. */
+	class SpillRunMerger
+	{
+	public:
+		SpillRunMerger(const std::string& filename, const std::vector< std::pair<uint64, uint64> >& runs, uint firstRun, uint numRuns)
+			: m_heads(numRuns)
+		{
+			for(uint r = 0; r < numRuns; ++r)
+			{
+				m_readers.push_back(new SpillRunReader(filename, runs[firstRun + r].first, runs[firstRun + r].second));
+				if(m_readers[r]->Next(m_heads[r]))
+					m_heap.push(std::make_pair(std::make_pair(m_heads[r].sampleIndex, m_heads[r].taxonId), r));
+			}
+		}
+
+		~SpillRunMerger()
+		{
+			for(uint r = 0; r < m_readers.size(); ++r)
+				delete m_readers[r];
+		}
+
+		/** Check that every run could be opened and read. Once Next() returns false, this distinguishes the end of the runs from an error. */
+		bool IsGood() const
+		{
+			for(uint r = 0; r < m_readers.size(); ++r)
+			{
+				if(!m_readers[r]->IsGood())
+					return false;
+			}
+
+			return true;
+		}
+
+		bool Next(SpillRecord& record)
+		{
+			if(m_heap.empty())
+				return false;
+
+			uint r = m_heap.top().second;
+			m_heap.pop();
+
+			record = m_heads[r];
+			if(m_readers[r]->Next(m_heads[r]))
+				m_heap.push(std::make_pair(std::make_pair(m_heads[r].sampleIndex, m_heads[r].taxonId), r));
+
+			return true;
+		}
+
+	private:
+		/** Readers own their files so copying is not supported. */
+		SpillRunMerger(const SpillRunMerger&);
+		SpillRunMerger& operator=(const SpillRunMerger&);
+
+		typedef std::pair< std::pair<uint, uint>, uint > HeapItem;
+
+		std::vector<SpillRunReader*> m_readers;
+		std::vector<SpillRecord> m_heads;
+		std::priority_queue< HeapItem, std::vector<HeapItem>, std::greater<HeapItem> > m_heap;
+	};
+}
+
+SparseSampleTable::SparseSampleTable()
+	: m_pendingBytes(0), m_memoryLimit(std::numeric_limits<uint64>::max()), m_bSpillFailed(false), m_spilledTable(NULL)
+{
+
+}
+
+SparseSampleTable::~SparseSampleTable()
+{
+	delete m_spilledTable;
+
+	if(m_spillOut.is_open())
+		m_spillOut.close();
+
+	if(!m_spillFile.empty())
+		remove(m_spillFile.c_str());
+
+	if(!m_spilledTableFile.empty())
+		remove(m_spilledTableFile.c_str());
+}
+
+bool SparseSampleTable::GetCounts(uint index, std::vector<double>& count) const
+{
+	if(m_spilledTable != NULL)
+		return m_spilledTable->GetCounts(index, count);
+
+	count.assign(m_taxa.size(), 0);
+	for(uint64 i = m_runStart[index]; i < m_runStart[index+1]; ++i)
+		count[m_taxonIds[i]] = m_counts[i];
+
+	return true;
+}
+
+bool SparseSampleTable::GetCounts(uint index, const std::vector<uint>& columnToIndex, const std::vector<uint64>& keptColumns, std::vector<double>& count) const
+{
+	if(m_spilledTable != NULL)
+		return m_spilledTable->GetCounts(index, columnToIndex, keptColumns, count);
+
+	for(uint64 i = m_runStart[index]; i < m_runStart[index+1]; ++i)
+	{
+		uint taxonId = m_taxonIds[i];
+		if(taxonId < columnToIndex.size() && ((keptColumns[taxonId / 64] >> (taxonId % 64)) & 1))
+			count[columnToIndex[taxonId]] = m_counts[i];
+	}
+
+	return true;
+}
+
+void SparseSampleTable::SetAccessPattern(MappedFile::ACCESS_PATTERN accessPattern) const
+{
+	if(m_spilledTable != NULL)
+		m_spilledTable->SetAccessPattern(accessPattern);
+}
+
+void SparseSampleTable::Prefetch(uint firstIndex, uint numSamples) const
+{
+	if(m_spilledTable != NULL)
+		m_spilledTable->Prefetch(firstIndex, numSamples);
+}
+
+void SparseSampleTable::AddCount(uint sampleIndex, uint taxonId, double count)
+{
+	if(count == 0)
+		return;
+
+	if(sampleIndex >= m_pendingCounts.size())
+		m_pendingCounts.resize(sampleIndex+1);
+
+	m_pendingCounts[sampleIndex].push_back(std::make_pair(taxonId, count));
+
+	m_pendingBytes += sizeof(std::pair<uint, double>);
+	if(m_pendingBytes > m_memoryLimit && !m_bSpillFailed)
+		m_bSpillFailed = !Spill();
+}
+
+bool SparseSampleTable::Spill()
+{
+	if(!m_spillOut.is_open())
+	{
+		m_spillFile = TempFilename(".spill");
+		m_spillOut.open(m_spillFile.c_str(), std::ios::binary);
+		if(!m_spillOut.is_open())
+		{
+			std::cerr << "Unable to create spill file: " << m_spillFile << std::endl;
+			return false;
+		}
+	}
+
+	uint64 runOffset = m_spillOut.tellp();
+	uint64 numRecords = 0;
+	std::vector<SpillRecord> records;
+	for(uint i = 0; i < m_pendingCounts.size(); ++i)
+	{
+		std::vector< std::pair<uint, double> >& pending = m_pendingCounts[i];
+		std::sort(pending.begin(), pending.end());
+
+		records.resize(pending.size());
+		for(uint j = 0; j < pending.size(); ++j)
+		{
+			records[j].sampleIndex = i;
+			records[j].taxonId = pending[j].first;
+			records[j].count = pending[j].second;
+		}
+
+		if(!records.empty())
+			m_spillOut.write((const char*)&records[0], records.size()*sizeof(SpillRecord));
+		numRecords += records.size();
+
+		std::vector< std::pair<uint, double> >().swap(pending);
+	}
+
+	m_spillRuns.push_back(std::make_pair(runOffset, numRecords));
+	m_pendingBytes = 0;
+
+	if(!m_spillOut.good())
+	{
+		std::cerr << "Failed to write spill file: " << m_spillFile << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+bool SparseSampleTable::CheckIds(uint sampleIndex, uint taxonId) const
+{
+	if(sampleIndex >= m_sampleNames.size())
+	{
+		std::cerr << "Sample table contains counts for sample " << sampleIndex << ", but only " 
+							<< m_sampleNames.size() << " sample names." << std::endl;
+		return false;
+	}
+
+	if(taxonId >= m_taxa.size())
+	{
+		std::cerr << "Sample table contains counts for taxon " << taxonId << ", but only " 
+							<< m_taxa.size() << " taxon names." << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+bool SparseSampleTable::Finalize()
+{
+	if(m_bSpillFailed)
+		return false;
+
+	if(!m_spillRuns.empty())
+		return Spill() && MergeSpilledRuns();
+
+	if(m_pendingCounts.size() > m_sampleNames.size())
+		return CheckIds(m_pendingCounts.size()-1, 0);
+
+	m_runStart.assign(1, 0);
+	m_taxonIds.clear();
+	m_counts.clear();
+	for(uint i = 0; i < m_sampleNames.size(); ++i)
+	{
+		if(i < m_pendingCounts.size())
+		{
+			// sort counts by taxon and sum counts given more than once
+			std::vector< std::pair<uint, double> >& pending = m_pendingCounts[i];
+			std::sort(pending.begin(), pending.end());
+			for(uint j = 0; j < pending.size(); ++j)
+			{
+				if(!CheckIds(i, pending[j].first))
+					return false;
+
+				if(j > 0 && pending[j].first == pending[j-1].first)
+					m_counts.back() += pending[j].second;
+				else
+				{
+					m_taxonIds.push_back(pending[j].first);
+					m_counts.push_back(pending[j].second);
+				}
+			}
+
+			// release memory as soon as possible since pending counts are larger than packed counts
+			std::vector< std::pair<uint, double> >().swap(pending);
+		}
+
+		m_runStart.push_back(m_counts.size());
+	}
+
+	std::vector< std::vector< std::pair<uint, double> > >().swap(m_pendingCounts);
+	m_pendingBytes = 0;
+
+	return true;
+}
+
+bool SparseSampleTable::MergeSpillPass()
+{
+	std::string passFile = TempFilename(".spill");
+	std::ofstream out(passFile.c_str(), std::ios::binary);
+	if(!out.is_open())
+	{
+		std::cerr << "Unable to create spill file: " << passFile << std::endl;
+		return false;
+	}
+
+	std::vector< std::pair<uint64, uint64> > passRuns;
+	bool bReadError = false;
+	for(uint firstRun = 0; firstRun < m_spillRuns.size() && !bReadError && out.good(); firstRun += MAX_MERGE_RUNS)
+	{
+		uint numRuns = std::min<uint>(MAX_MERGE_RUNS, m_spillRuns.size() - firstRun);
+		SpillRunMerger merger(m_spillFile, m_spillRuns, firstRun, numRuns);
+
+		uint64 runOffset = out.tellp();
+		uint64 numRecords = 0;
+		SpillRecord record;
+		while(merger.Next(record))
+		{
+			out.write((const char*)&record, sizeof(record));
+			numRecords++;
+		}
+
+		bReadError = !merger.IsGood();
+		passRuns.push_back(std::make_pair(runOffset, numRecords));
+	}
+
+	out.close();
+	bool bWriteError = out.fail();
+
+	// merged runs replace the runs of the previous pass
+	remove(m_spillFile.c_str());
+	std::string prevFile = m_spillFile;
+	m_spillFile = passFile;
+	m_spillRuns = passRuns;
+
+	if(bReadError)
+	{
+		std::cerr << "Unable to read spill file: " << prevFile << std::endl;
+		return false;
+	}
+
+	if(bWriteError)
+	{
+		std::cerr << "Failed to write spill file: " << passFile << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+bool SparseSampleTable::MergeSpilledRuns()
+{
+	m_spillOut.close();
+
+	// runs are merged in passes so no more than MAX_MERGE_RUNS files are open at once
+	while(m_spillRuns.size() > MAX_MERGE_RUNS)
+	{
+		if(!MergeSpillPass())
+			return false;
+	}
+
+	m_spilledTableFile = TempFilename(".ndb");
+	BinarySampleWriter writer;
+	if(!writer.Open(m_spilledTableFile, m_taxa, m_sampleNames))
+		return false;
+
+	SpillRunMerger merger(m_spillFile, m_spillRuns, 0, m_spillRuns.size());
+	bool bGood = merger.IsGood();
+	if(!bGood)
+		std::cerr << "Unable to read spill file: " << m_spillFile << std::endl;
+
+	uint curSample = 0;
+	double total = 0;
+	std::vector<uint> runIds;
+	std::vector<double> runCounts;
+	SpillRecord record;
+	while(bGood && merger.Next(record))
+	{
+		if(!CheckIds(record.sampleIndex, record.taxonId))
+		{
+			bGood = false;
+			break;
+		}
+
+		// write out samples preceding the sample of this record
+		while(curSample < record.sampleIndex)
+		{
+			writer.AddSample(runIds, runCounts, total);
+			runIds.clear();
+			runCounts.clear();
+			total = 0;
+			curSample++;
+		}
+
+		// sum counts given more than once
+		if(!runIds.empty() && runIds.back() == record.taxonId)
+			runCounts.back() += record.count;
+		else
+		{
+			runIds.push_back(record.taxonId);
+			runCounts.push_back(record.count);
+		}
+		total += record.count;
+	}
+
+	if(bGood && !merger.IsGood())
+	{
+		std::cerr << "Failed to read spill file: " << m_spillFile << std::endl;
+		bGood = false;
+	}
+
+	remove(m_spillFile.c_str());
+	m_spillFile.clear();
+
+	// incomplete table is left without a header and removed with the spill files
+	if(!bGood)
+		return false;
+
+	// write out remaining samples
+	while(curSample < m_sampleNames.size())
+	{
+		writer.AddSample(runIds, runCounts, total);
+		runIds.clear();
+		runCounts.clear();
+		total = 0;
+		curSample++;
+	}
+
+	if(!writer.Close())
+		return false;
+
+	m_spilledTable = new BinarySampleTable();
+	if(!m_spilledTable->Open(m_spilledTableFile))
+		return false;
+
+#ifndef WIN32
+	// mapping remains valid once the file is unlinked, and the file is removed even if the process is killed
+	remove(m_spilledTableFile.c_str());
+	m_spilledTableFile.clear();
+#endif
+
+	return true;
+}
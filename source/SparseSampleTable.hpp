@@ -0,0 +1,147 @@
+//=======================================================================
+// Author: Donovan Parks
+//
+// Copyright 2011 Donovan Parks
+//
+// This file is part of ExpressBetaDiversity.
+//
+// ExpressBetaDiversity is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// ExpressBetaDiversity is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ExpressBetaDiversity. If not, see
+// <http://www.gnu.org/licenses/>.
+//=======================================================================
+
+#ifndef _SPARSE_SAMPLE_TABLE_
+#define _SPARSE_SAMPLE_TABLE_
+
+#include "Precompiled.hpp"
+
+#include "SampleTable.hpp"
+#include "BinarySampleTable.hpp"
+
+/**
+ * @brief Sample table held as the non-zero counts of each sample.
+ *
+ * Base class for sample tables which must be read in full (e.g., BIOM tables). 
+ * Derived classes parse their input in Read(), adding counts with AddCount() in 
+ * any order, and then call Finalize(). Memory scales with the number of non-zero
+ * counts rather than the number of samples times the number of taxa.
+ *
+ * Once added counts exceed the memory limit, they are sorted and written to a
+ * temporary spill file. Finalize() then merges the sorted runs in the spill file
+ * into a temporary binary sample table which is memory mapped, so the counts need
+ * not fit in memory. Runs are merged a bounded number at a time, in several passes
+ * if needed, so the number of open files does not grow with the number of runs.
+ */
+class SparseSampleTable : public SampleTable
+{
+public:
+	/** Constructor. */
+	SparseSampleTable();
+
+	/** Destructor. */
+	virtual ~SparseSampleTable();
+
+	/** Read table from a stream in a single pass, as is done for sample files which can only be read once (e.g., stdin). */
+	virtual bool Read(std::istream& in, const std::string& name) = 0;
+
+	/** Set approximate memory (in bytes) for added counts before they are spilled to disk. */
+	void SetMemoryLimit(uint64 memoryLimit) { m_memoryLimit = memoryLimit; }
+
+	const std::vector<std::string>& GetTaxa() const { return m_taxa; }
+
+	uint GetNumSamples() const { return m_sampleNames.size(); }
+
+	const std::string& GetSampleName(uint index) const { return m_sampleNames[index]; }
+
+	bool GetCounts(uint index, std::vector<double>& count) const;
+
+	bool GetCounts(uint index, const std::vector<uint>& columnToIndex, const std::vector<uint64>& keptColumns, std::vector<double>& count) const;
+
+	void SetAccessPattern(MappedFile::ACCESS_PATTERN accessPattern) const;
+
+	void Prefetch(uint firstIndex, uint numSamples) const;
+
+protected:
+	/** Add to count of a taxon in a sample. Counts for the same sample and taxon are summed. */
+	void AddCount(uint sampleIndex, uint taxonId, double count);
+
+	/** 
+	 * @brief Pack counts added so far for fast access. 
+	 *
+	 * @return False if a count refers to a sample or taxon without a name, or spilling to disk failed.
+	 */
+	bool Finalize();
+
+protected:
+	/** Name of taxa. */
+	std::vector<std::string> m_taxa;
+
+	/** Name of samples. */
+	std::vector<std::string> m_sampleNames;
+
+private:
+	/** Sample table is owned by this object so copying is not supported. */
+	SparseSampleTable(const SparseSampleTable&);
+	SparseSampleTable& operator=(const SparseSampleTable&);
+
+	/** Write pending counts to spill file as a run sorted by sample and taxon. */
+	bool Spill();
+
+	/** Merge sorted runs in spill file into a binary sample table. */
+	bool MergeSpilledRuns();
+
+	/** Merge groups of sorted runs in spill file into fewer, longer runs in a new spill file. */
+	bool MergeSpillPass();
+
+	/** Check that all sample and taxon ids have a name. */
+	bool CheckIds(uint sampleIndex, uint taxonId) const;
+
+private:
+	/** Counts added to each sample, but not yet packed or spilled. */
+	std::vector< std::vector< std::pair<uint, double> > > m_pendingCounts;
+
+	/** Approximate memory used by pending counts. */
+	uint64 m_pendingBytes;
+
+	/** Maximum memory for pending counts. */
+	uint64 m_memoryLimit;
+
+	/** Temporary file holding spilled runs of counts. */
+	std::string m_spillFile;
+
+	/** Stream to spill file. */
+	std::ofstream m_spillOut;
+
+	/** Offset and number of counts of each run in spill file. */
+	std::vector< std::pair<uint64, uint64> > m_spillRuns;
+
+	/** Flag indicating if writing to the spill file failed. */
+	bool m_bSpillFailed;
+
+	/** Temporary binary sample table holding counts if they were spilled to disk. */
+	std::string m_spilledTableFile;
+
+	/** Binary sample table holding counts if they were spilled to disk. */
+	BinarySampleTable* m_spilledTable;
+
+	/** Index of first non-zero count of each sample, plus one past the last count. */
+	std::vector<uint64> m_runStart;
+
+	/** Taxon id of each non-zero count. */
+	std::vector<uint> m_taxonIds;
+
+	/** Non-zero counts. */
+	std::vector<double> m_counts;
+};
+
+#endif
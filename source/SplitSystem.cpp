@@ -26,11 +26,13 @@
 #include "NexusIO.hpp"
 #include "NewickIO.hpp"
 #include "SampleIO.hpp"
+#include "Utils.hpp"
 
-bool SplitSystem::LoadData(const std::string& nexusFile, const std::string& newickFile, const std::string& sampleFile, bool bVerbose)
+bool SplitSystem::LoadData(const std::string& nexusFile, const std::string& newickFile, const std::string& sampleFile, bool bVerbose, 
+														bool bTaxaAsRows, uint inputMemoryMB)
 {
 	// read sample file
-	if(!m_sampleIO.Read(sampleFile))
+	if(!m_sampleIO.Read(sampleFile, bTaxaAsRows, inputMemoryMB))
 	{
 		std::cerr << "Failed to read sample file: " << sampleFile;
 		return false;
@@ -68,14 +70,13 @@ bool SplitSystem::LoadData(const std::string& nexusFile, const std::string& newi
 	return true;
 }
 
-std::vector<double> SplitSystem::GetSampleData(uint sampleId, DATA_TYPE dataType)
+bool SplitSystem::GetSampleData(uint sampleId, DATA_TYPE dataType, std::vector<double>& data, std::vector<double>& seqCount) const
 {
-	std::vector<double> data;
-	data.resize(m_splits.size());
+	data.assign(m_splits.size(), 0);
 
-	std::vector<double> seqCount;
 	double totalNumSeq;
-	m_sampleIO.GetData(sampleId, seqCount, totalNumSeq);
+	if(!m_sampleIO.GetData(sampleId, seqCount, totalNumSeq))
+		return false;
 
 	for(uint splitId = 0; splitId < m_splits.size(); ++splitId)
 	{
@@ -97,7 +98,59 @@ std::vector<double> SplitSystem::GetSampleData(uint sampleId, DATA_TYPE dataType
 		}
 	}
 
-	return data;
+	return true;
+}
+
+uint64 SplitSystem::GetFingerprint() const
+{
+	uint64 hash = HASH_SEED;
+	HashFileInfo(m_sampleIO.GetFilename(), hash);
+
+	uint numSamples = GetNumSamples();
+	hash = HashBytes(&numSamples, sizeof(numSamples), hash);
+	for(uint i = 0; i < numSamples; ++i)
+		hash = HashString(GetSampleName(i), hash);
+
+	return GetSplitsFingerprint(hash);
+}
+
+uint64 SplitSystem::GetSplitsFingerprint(uint64 hash) const
+{
+	// sequence ids follow the columns of the sample file, so sequences are
+	// identified by the rank of their name among all ingroup sequences
+	std::vector<std::string> seqNames = m_sampleIO.GetIngroupSeqNames();
+	std::vector<std::string> sortedNames = seqNames;
+	std::sort(sortedNames.begin(), sortedNames.end());
+
+	uint numSeqs = sortedNames.size();
+	hash = HashBytes(&numSeqs, sizeof(numSeqs), hash);
+	for(uint i = 0; i < numSeqs; ++i)
+		hash = HashString(sortedNames[i], hash);
+
+	std::vector<uint> seqRank(numSeqs);
+	for(uint seqId = 0; seqId < numSeqs; ++seqId)
+		seqRank[seqId] = std::lower_bound(sortedNames.begin(), sortedNames.end(), seqNames[seqId]) - sortedNames.begin();
+
+	uint numSplits = GetNumSplits();
+	hash = HashBytes(&numSplits, sizeof(numSplits), hash);
+	for(uint i = 0; i < numSplits; ++i)
+	{
+		double weight = m_splits[i].GetWeight();
+		hash = HashBytes(&weight, sizeof(weight), hash);
+
+		std::vector<uint> leftSeqIds = m_splits[i].GetLeftSequenceIds();
+		std::vector<uint> leftRanks(leftSeqIds.size());
+		for(uint j = 0; j < leftSeqIds.size(); ++j)
+			leftRanks[j] = seqRank[leftSeqIds[j]];
+		std::sort(leftRanks.begin(), leftRanks.end());
+
+		uint numLeft = leftRanks.size();
+		hash = HashBytes(&numLeft, sizeof(numLeft), hash);
+		if(numLeft > 0)
+			hash = HashBytes(&leftRanks[0], numLeft*sizeof(uint), hash);
+	}
+
+	return hash;
 }
 
 void SplitSystem::CreateFromTree(Tree<Node>& tree)
@@ -46,8 +46,9 @@ public:
 	/** Destructor. */
 	~SplitSystem() {}
 
-	/** Load input data. */
-	bool LoadData(const std::string& nexusFile, const std::string& newickFile, const std::string& sampleFile, bool bVerbose = false);
+	/** Load input data. See SampleIO::Read() for the sample file options. */
+	bool LoadData(const std::string& nexusFile, const std::string& newickFile, const std::string& sampleFile, bool bVerbose = false, 
+									bool bTaxaAsRows = false, uint inputMemoryMB = 1024);
 
 	/** Create split system from a tree. */
 	void CreateFromTree(Tree<Node>& tree);
@@ -83,8 +84,17 @@ public:
 	/** Get sequence id.*/
 	bool GetSeqId(const std::string& name, uint& seqId) { return m_sampleIO.GetSeqId(name, seqId); }
 
-	/** Get data from specified sample. */
-	std::vector<double> GetSampleData(uint sampleId, DATA_TYPE dataType);
+	/** 
+	 * Get data from specified sample. Returns false if the sample could not be read. Safe to call concurrently 
+	 * from multiple threads. Sequence counts are read into seqCount, which each thread should reuse between calls.
+	 */
+	bool GetSampleData(uint sampleId, DATA_TYPE dataType, std::vector<double>& data, std::vector<double>& seqCount) const;
+
+	/** Hint at how samples will be accessed. */
+	void SetSampleAccessPattern(MappedFile::ACCESS_PATTERN accessPattern) const { m_sampleIO.SetAccessPattern(accessPattern); }
+
+	/** Hint that the given range of samples will be read soon. */
+	void PrefetchSamples(uint firstSampleId, uint numSamples) const { m_sampleIO.Prefetch(firstSampleId, numSamples); }
 
 	/** Check if there is an outgroup. */
 	bool IsOutgroup() const { return m_sampleIO.IsOutgroup(); }
@@ -95,6 +105,20 @@ public:
 	/** Get name of outgroup sequences. */
 	std::set<std::string> GetOutgroupSeqs() { return m_sampleIO.GetOutgroupSeqs(); };
 
+	/** 
+	 * @brief Get fingerprint of input data.
+	 *
+	 * Covers the size and modification time of the sample file, the sample names, 
+	 * and the weight and sequences of each split. 
+	 */
+	uint64 GetFingerprint() const;
+
+	/** 
+	 * Combine hash with a fingerprint of the weight and sequences of each split, which determine the data vector of a sample. 
+	 * Sequences are identified by name, so the fingerprint does not depend on the order of taxa in the sample file.
+	 */
+	uint64 GetSplitsFingerprint(uint64 hash) const;
+
 private:
 	/** Read sample data. */
 	SampleIO m_sampleIO;
@@ -0,0 +1,137 @@
+//=======================================================================
+// Author: Donovan Parks
+//
+// Copyright 2011 Donovan Parks
+//
+// This file is part of ExpressBetaDiversity.
+//
+// ExpressBetaDiversity is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// ExpressBetaDiversity is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ExpressBetaDiversity. If not, see
+// <http://www.gnu.org/licenses/>.
+//=======================================================================
+
+#include "Precompiled.hpp"
+
+#include "StreamSampleTable.hpp"
+#include "Utils.hpp"
+
+#ifndef WIN32
+	#include <sys/stat.h>
+#endif
+
+// size of reads from the rest of a stream following its prefix
+const uint PREFIX_STREAM_BUFFER_SIZE = 65536;
+
+bool StreamSampleTable::IsStream(const std::string& filename)
+{
+	if(filename == "-")
+		return true;
+
+#ifndef WIN32
+	struct stat fileInfo;
+	if(stat(filename.c_str(), &fileInfo) == 0)
+		return !S_ISREG(fileInfo.st_mode) && !S_ISDIR(fileInfo.st_mode);
+#endif
+
+	return false;
+}
+
+bool StreamSampleTable::Open(const std::string& filename)
+{
+	if(filename == "-")
+		return Read(std::cin, "stdin");
+
+	std::ifstream in(filename.c_str(), std::ios::binary);
+	if(!in.is_open())
+	{
+		std::cerr << "Unable to open sample file: " << filename << std::endl;
+		return false;
+	}
+
+	return Read(in, filename);
+}
+
+bool StreamSampleTable::Read(std::istream& in, const std::string& name)
+{
+	// header line gives name of each taxon
+	std::string line;
+	while(std::getline(in, line) && (line.empty() || line == "\r"));
+	if(!line.empty() && line[line.size()-1] == '\r')
+		line.resize(line.size()-1);
+
+	std::stringstream ss(line);
+	std::string token;
+	while(std::getline(ss, token, '\t'))
+	{
+		if(!token.empty())
+			m_taxa.push_back(token);
+	}
+
+	if(m_taxa.empty())
+	{
+		std::cerr << "Sample file is empty: " << name << std::endl;
+		return false;
+	}
+
+	// each following line gives a sample name and its count of each taxon
+	uint numTaxa = m_taxa.size();
+	std::vector<double> count(numTaxa);
+	while(std::getline(in, line))
+	{
+		if(!line.empty() && line[line.size()-1] == '\r')
+			line.resize(line.size()-1);
+
+		if(line.empty())
+			continue;
+
+		uint sampleIndex = m_sampleNames.size();
+		const char* curPos = line.c_str();
+		const char* lineEnd = curPos + line.size();
+
+		const char* nameEnd = FindDelimiter(curPos, lineEnd);
+		m_sampleNames.push_back(std::string(curPos, nameEnd));
+		curPos = (nameEnd < lineEnd) ? nameEnd + 1 : lineEnd;
+
+		ParseCounts(curPos, lineEnd, &count[0], numTaxa);
+		for(uint seqId = 0; seqId < numTaxa; ++seqId)
+			AddCount(sampleIndex, seqId, count[seqId]);
+	}
+
+	if(in.bad())
+	{
+		std::cerr << "Error reading sample file: " << name << std::endl;
+		return false;
+	}
+
+	return Finalize();
+}
+
+PrefixStreamBuf::PrefixStreamBuf(const std::string& prefix, std::streambuf* rest)
+	: m_prefix(prefix), m_rest(rest), m_buffer(PREFIX_STREAM_BUFFER_SIZE)
+{
+	char* start = m_prefix.empty() ? NULL : &m_prefix[0];
+	setg(start, start, start + m_prefix.size());
+}
+
+PrefixStreamBuf::int_type PrefixStreamBuf::underflow()
+{
+	if(gptr() < egptr())
+		return traits_type::to_int_type(*gptr());
+
+	std::streamsize bytes = m_rest->sgetn(&m_buffer[0], m_buffer.size());
+	if(bytes <= 0)
+		return traits_type::eof();
+
+	setg(&m_buffer[0], &m_buffer[0], &m_buffer[0] + bytes);
+	return traits_type::to_int_type(*gptr());
+}
@@ -0,0 +1,83 @@
+//=======================================================================
+// Author: Donovan Parks
+//
+// Copyright 2011 Donovan Parks
+//
+// This file is part of ExpressBetaDiversity.
+//
+// ExpressBetaDiversity is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// ExpressBetaDiversity is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ExpressBetaDiversity. If not, see
+// <http://www.gnu.org/licenses/>.
+//=======================================================================
+
+#ifndef _STREAM_SAMPLE_TABLE_
+#define _STREAM_SAMPLE_TABLE_
+
+#include "Precompiled.hpp"
+
+#include "SparseSampleTable.hpp"
+
+/**
+ * @brief Tab-delimited sample table with samples as rows, read in a single pass into the sparse count store.
+ *
+ * Used for sample files which can only be read once, such as stdin ('-') or a named pipe, 
+ * so they can be neither memory mapped nor indexed. Only non-zero counts are kept, and they
+ * are spilled to disk once they exceed the memory limit.
+ */
+class StreamSampleTable : public SparseSampleTable
+{
+public:
+	/** Constructor. */
+	StreamSampleTable() {}
+
+	/** Destructor. */
+	~StreamSampleTable() {}
+
+	/** Check if a sample file can only be read once: '-' for stdin, or a pipe or other file which is not a regular file. */
+	static bool IsStream(const std::string& filename);
+
+	bool Open(const std::string& filename);
+
+	/** Read table from a stream. */
+	bool Read(std::istream& in, const std::string& name);
+};
+
+/**
+ * @brief Stream buffer returning data already taken from a stream followed by the rest of the stream.
+ *
+ * Allows the start of a stream which cannot be rewound to be inspected before it is parsed.
+ */
+class PrefixStreamBuf : public std::streambuf
+{
+public:
+	/** Constructor. */
+	PrefixStreamBuf(const std::string& prefix, std::streambuf* rest);
+
+	/** Destructor. */
+	~PrefixStreamBuf() {}
+
+protected:
+	int_type underflow();
+
+private:
+	/** Data already taken from the stream. */
+	std::string m_prefix;
+
+	/** Rest of the stream. */
+	std::streambuf* m_rest;
+
+	/** Data read from the rest of the stream. */
+	std::vector<char> m_buffer;
+};
+
+#endif
@@ -0,0 +1,496 @@
+//=======================================================================
+// Author: Donovan Parks
+//
+// Copyright 2011 Donovan Parks
+//
+// This file is part of ExpressBetaDiversity.
+//
+// ExpressBetaDiversity is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// ExpressBetaDiversity is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ExpressBetaDiversity. If not, see
+// <http://www.gnu.org/licenses/>.
+//=======================================================================
+
+#include "Precompiled.hpp"
+
+#include "TextMatrixWriter.hpp"
+#include "TextParser.hpp"
+
+namespace
+{
+	/** Powers of ten which are exactly representable as doubles. */
+	const double POW10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 
+														1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+	/** Largest precision for which digits are produced without printf(). */
+	const uint MAX_FAST_PRECISION = 15;
+
+	/** 
+	 * Round finite, positive value to the given number of significant digits. Fails if the power 
+	 * of ten scaling the value is inexact or the value is too close to halfway between two 
+	 * results for rounding of the scaled value to be certain.
+	 */
+	bool RoundDigits(double value, uint precision, uint64& digits, int& exponent)
+	{
+		exponent = (int)floor(log10(value));
+		for(uint attempt = 0; attempt < 2; ++attempt)
+		{
+			int shift = (int)precision - 1 - exponent;
+			if(shift > 22 || shift < -22)
+				return false;
+
+			double scaled = (shift >= 0) ? value * POW10[shift] : value / POW10[-shift];
+
+			// log10 may be off by one near powers of ten
+			if(scaled >= POW10[precision])
+			{
+				exponent++;
+				continue;
+			}
+			else if(scaled < POW10[precision-1])
+			{
+				exponent--;
+				continue;
+			}
+
+			// scaled value is within half an ulp of the exact product
+			double whole = floor(scaled);
+			double fraction = scaled - whole;
+			if(fabs(fraction - 0.5) <= scaled * DBL_EPSILON)
+				return false;
+
+			digits = (uint64)whole + (fraction > 0.5 ? 1 : 0);
+			if(digits == (uint64)POW10[precision])
+			{
+				digits /= 10;
+				exponent++;
+			}
+
+			return true;
+		}
+
+		return false;
+	}
+
+	uint WriteExponent(int exponent, char* out)
+	{
+		char* start = out;
+		*out++ = 'e';
+		*out++ = exponent < 0 ? '-' : '+';
+		if(exponent < 0)
+			exponent = -exponent;
+
+		if(exponent >= 100)
+			*out++ = '0' + exponent / 100;
+		*out++ = '0' + (exponent / 10) % 10;
+		*out++ = '0' + exponent % 10;
+
+		return out - start;
+	}
+}
+
+const uint TextMatrixWriter::MAX_VALUE_LEN;
+const uint TextMatrixWriter::FORMAT_BATCH_SIZE;
+
+TextMatrixWriter::TextMatrixWriter(LAYOUT layout, uint precision, bool bFixedWidth)
+	: MatrixWriter(layout), m_precision(precision), m_bFixedWidth(bFixedWidth), m_headerSize(0)
+{
+
+}
+
+void TextMatrixWriter::Initialize()
+{
+	std::stringstream ss;
+	ss << m_info.sampleNames.size() << '\n';
+	m_headerSize = ss.str().size();
+
+	m_nameOffsets.resize(m_info.sampleNames.size() + 1);
+	m_nameOffsets[0] = 0;
+	for(uint i = 0; i < m_info.sampleNames.size(); ++i)
+		m_nameOffsets[i+1] = m_nameOffsets[i] + m_info.sampleNames[i].size();
+}
+
+bool TextMatrixWriter::WriteHeader()
+{
+	// pairs and neighbors are written without a header
+	if(m_layout == PAIRS || m_layout == NEIGHBORS)
+		return true;
+
+	std::stringstream ss;
+	ss << m_info.sampleNames.size() << '\n';
+	Append(ss.str());
+
+	return true;
+}
+
+uint64 TextMatrixWriter::GetLayoutRowOffset(uint row) const
+{
+	// each row has a name, a tab and value for each column before the diagonal, and a newline
+	uint64 valueLen = GetFixedWidth(m_precision) + 1;
+	return m_headerSize + m_nameOffsets[row] + row + valueLen*row*(row - (row > 0 ? 1 : 0))/2;
+}
+
+uint64 TextMatrixWriter::FormatSegment(uint row, uint firstCol, uint numValues, const double* values, std::vector<char>& buffer) const
+{
+	const std::string& name = m_info.sampleNames[row];
+	uint64 valueLen = GetFixedWidth(m_precision) + 1;
+	bool bFirst = (firstCol == 0);
+	bool bLast = (firstCol + numValues == row);
+
+	buffer.resize((bFirst ? name.size() : 0) + numValues*valueLen + (bLast ? 1 : 0));
+	if(buffer.empty())
+		return 0;
+
+	char* out = &buffer[0];
+	if(bFirst)
+	{
+		memcpy(out, name.c_str(), name.size());
+		out += name.size();
+	}
+
+	for(uint i = 0; i < numValues; ++i)
+	{
+		*out++ = '\t';
+		out += FormatFixed(values[i], m_precision, out);
+	}
+
+	if(bLast)
+		*out++ = '\n';
+
+	uint64 offset = GetLayoutRowOffset(row);
+	if(!bFirst)
+		offset += name.size() + firstCol*valueLen;
+
+	return offset;
+}
+
+void TextMatrixWriter::FormatEdges(uint row, const std::vector<MatrixEdge>& edges, std::string& text) const
+{
+	const std::string& name = m_info.sampleNames[row];
+
+	uint64 len = (uint64)edges.size()*(name.size() + MAX_VALUE_LEN + 3);
+	for(uint e = 0; e < edges.size(); ++e)
+		len += m_info.sampleNames[edges[e].col].size();
+	text.resize(len);
+	if(edges.empty())
+		return;
+
+	char* out = &text[0];
+	for(uint e = 0; e < edges.size(); ++e)
+	{
+		const std::string& otherName = m_info.sampleNames[edges[e].col];
+
+		memcpy(out, name.c_str(), name.size());
+		out += name.size();
+		*out++ = '\t';
+		memcpy(out, otherName.c_str(), otherName.size());
+		out += otherName.size();
+		*out++ = '\t';
+		out += FormatValue(edges[e].value, out);
+		*out++ = '\n';
+	}
+
+	text.resize(out - &text[0]);
+}
+
+void TextMatrixWriter::FormatNeighbors(uint row, const std::vector<MatrixEdge>& neighbors, std::string& text) const
+{
+	const std::string& name = m_info.sampleNames[row];
+
+	uint64 len = name.size() + (uint64)neighbors.size()*(MAX_VALUE_LEN + 2) + 1;
+	for(uint n = 0; n < neighbors.size(); ++n)
+		len += m_info.sampleNames[neighbors[n].col].size();
+	text.resize(len);
+
+	char* out = &text[0];
+	memcpy(out, name.c_str(), name.size());
+	out += name.size();
+
+	for(uint n = 0; n < neighbors.size(); ++n)
+	{
+		const std::string& otherName = m_info.sampleNames[neighbors[n].col];
+
+		*out++ = '\t';
+		memcpy(out, otherName.c_str(), otherName.size());
+		out += otherName.size();
+		*out++ = '\t';
+		out += FormatValue(neighbors[n].value, out);
+	}
+	*out++ = '\n';
+
+	text.resize(out - &text[0]);
+}
+
+uint TextMatrixWriter::FormatValue(double value, char* buffer) const
+{
+	if(m_bFixedWidth)
+		return FormatFixed(value, m_precision, buffer);
+
+	return FormatDouble(value, m_precision, buffer);
+}
+
+void TextMatrixWriter::AppendRows(uint firstRow, uint numRows, const double* values, uint64 rowStride, bool bFullRows)
+{
+	std::vector<std::string> rowText;
+
+	uint row = 0;
+	while(row < numRows)
+	{
+		// batch rows so that formatted text of a batch is of bounded size
+		uint64 numValues = 0;
+		uint endRow = row;
+		while(endRow < numRows)
+		{
+			uint rowValues = bFullRows ? m_info.sampleNames.size() : firstRow + endRow;
+			if(endRow != row && numValues + rowValues > FORMAT_BATCH_SIZE)
+				break;
+
+			numValues += rowValues;
+			endRow++;
+		}
+
+		rowText.resize(endRow - row);
+
+		#pragma omp parallel for schedule(dynamic)
+		for(int r = (int)row; r < (int)endRow; ++r)
+		{
+			uint rowValues = bFullRows ? m_info.sampleNames.size() : firstRow + r;
+			if(m_layout == PAIRS)
+				FormatPairs(firstRow + r, values + r*rowStride, rowValues, rowText[r - row]);
+			else
+				FormatRow(firstRow + r, values + r*rowStride, rowValues, rowText[r - row]);
+		}
+
+		for(uint r = row; r < endRow; ++r)
+			Append(rowText[r - row]);
+
+		row = endRow;
+	}
+}
+
+void TextMatrixWriter::AppendEdges(uint firstRow, const std::vector< std::vector<MatrixEdge> >& rowEdges)
+{
+	std::vector<std::string> rowText(rowEdges.size());
+
+	#pragma omp parallel for schedule(dynamic)
+	for(int r = 0; r < (int)rowEdges.size(); ++r)
+	{
+		if(m_layout == NEIGHBORS)
+			FormatNeighbors(firstRow + r, rowEdges[r], rowText[r]);
+		else
+			FormatEdges(firstRow + r, rowEdges[r], rowText[r]);
+	}
+
+	for(uint r = 0; r < rowText.size(); ++r)
+		Append(rowText[r]);
+}
+
+void TextMatrixWriter::FormatRow(uint row, const double* values, uint numValues, std::string& text) const
+{
+	const std::string& name = m_info.sampleNames[row];
+	text.resize(name.size() + (uint64)numValues*(MAX_VALUE_LEN + 1) + 1);
+
+	char* out = &text[0];
+	memcpy(out, name.c_str(), name.size());
+	out += name.size();
+
+	for(uint i = 0; i < numValues; ++i)
+	{
+		*out++ = '\t';
+		out += FormatValue(values[i], out);
+	}
+	*out++ = '\n';
+
+	text.resize(out - &text[0]);
+}
+
+void TextMatrixWriter::FormatPairs(uint row, const double* values, uint numValues, std::string& text) const
+{
+	const std::string& name = m_info.sampleNames[row];
+
+	uint64 len = (uint64)numValues*(name.size() + MAX_VALUE_LEN + 3);
+	for(uint j = 0; j < numValues; ++j)
+		len += m_info.sampleNames[j].size();
+	text.resize(len);
+
+	char* out = &text[0];
+	for(uint j = 0; j < numValues; ++j)
+	{
+		const std::string& otherName = m_info.sampleNames[j];
+
+		memcpy(out, name.c_str(), name.size());
+		out += name.size();
+		*out++ = '\t';
+		memcpy(out, otherName.c_str(), otherName.size());
+		out += otherName.size();
+		*out++ = '\t';
+		out += FormatValue(values[j], out);
+		*out++ = '\n';
+	}
+
+	text.resize(out - &text[0]);
+}
+
+uint TextMatrixWriter::FormatDouble(double value, uint precision, char* buffer)
+{
+	if(precision == 0)
+	{
+		// shortest of 15, 16, or 17 significant digits which reads back exactly
+		for(uint p = 15; p < 17; ++p)
+		{
+			uint len = FormatDouble(value, p, buffer);
+			if(ParseDouble(buffer, buffer + len) == value)
+				return len;
+		}
+
+		return FormatDouble(value, 17, buffer);
+	}
+
+	precision = std::min<uint>(precision, 17);
+
+	char* out = buffer;
+	if(value < 0 || (value == 0 && 1.0/value < 0))
+	{
+		*out++ = '-';
+		value = -value;
+	}
+
+	if(value == 0)
+	{
+		*out++ = '0';
+		return out - buffer;
+	}
+
+	uint64 digits;
+	int exponent;
+	if(precision > MAX_FAST_PRECISION || value != value || value > DBL_MAX || !RoundDigits(value, precision, digits, exponent))
+	{
+		// undefined and infinite values, ties, and high precisions are left to printf()
+		char format[8];
+		sprintf(format, "%%.%ug", precision);
+		return (out - buffer) + sprintf(out, format, value);
+	}
+
+	// digits without trailing zeros, as %g removes them
+	char digitText[20];
+	uint numDigits = precision;
+	while(numDigits > 1 && digits % 10 == 0)
+	{
+		digits /= 10;
+		numDigits--;
+	}
+
+	for(int i = numDigits-1; i >= 0; --i)
+	{
+		digitText[i] = '0' + digits % 10;
+		digits /= 10;
+	}
+
+	if(exponent < -4 || exponent >= (int)precision)
+	{
+		// scientific notation
+		*out++ = digitText[0];
+		if(numDigits > 1)
+		{
+			*out++ = '.';
+			memcpy(out, digitText + 1, numDigits - 1);
+			out += numDigits - 1;
+		}
+
+		out += WriteExponent(exponent, out);
+	}
+	else if(exponent >= 0)
+	{
+		uint numWhole = exponent + 1;
+		for(uint i = 0; i < numWhole; ++i)
+			*out++ = (i < numDigits) ? digitText[i] : '0';
+
+		if(numDigits > numWhole)
+		{
+			*out++ = '.';
+			memcpy(out, digitText + numWhole, numDigits - numWhole);
+			out += numDigits - numWhole;
+		}
+	}
+	else
+	{
+		*out++ = '0';
+		*out++ = '.';
+		for(int i = 0; i < -exponent - 1; ++i)
+			*out++ = '0';
+
+		memcpy(out, digitText, numDigits);
+		out += numDigits;
+	}
+
+	return out - buffer;
+}
+
+uint TextMatrixWriter::GetFixedWidth(uint precision)
+{
+	if(precision == 0)
+		precision = 17;
+
+	// sign, digits, decimal point, and an exponent of up to three digits
+	return std::min<uint>(precision, 17) + 7;
+}
+
+uint TextMatrixWriter::FormatFixed(double value, uint precision, char* buffer)
+{
+	if(precision == 0)
+		precision = 17;
+	precision = std::min<uint>(precision, 17);
+
+	char text[MAX_VALUE_LEN];
+	char* out = text;
+	if(value < 0 || (value == 0 && 1.0/value < 0))
+	{
+		*out++ = '-';
+		value = -value;
+	}
+
+	uint64 digits = 0;
+	int exponent = 0;
+	if(value == 0 || (precision <= MAX_FAST_PRECISION && value <= DBL_MAX && RoundDigits(value, precision, digits, exponent)))
+	{
+		// digits are kept, including trailing zeros, as %e does
+		char digitText[20];
+		for(int i = precision-1; i >= 0; --i)
+		{
+			digitText[i] = '0' + digits % 10;
+			digits /= 10;
+		}
+
+		*out++ = digitText[0];
+		if(precision > 1)
+		{
+			*out++ = '.';
+			memcpy(out, digitText + 1, precision - 1);
+			out += precision - 1;
+		}
+
+		out += WriteExponent(exponent, out);
+	}
+	else
+	{
+		// infinite values, ties, and high precisions are left to printf()
+		out += sprintf(out, "%.*e", precision - 1, value);
+	}
+
+	// right-align within the fixed width
+	uint len = out - text;
+	uint width = GetFixedWidth(precision);
+	memset(buffer, ' ', width - len);
+	memcpy(buffer + width - len, text, len);
+
+	return width;
+}
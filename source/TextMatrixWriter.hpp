@@ -0,0 +1,141 @@
+//=======================================================================
+// Author: Donovan Parks
+//
+// Copyright 2011 Donovan Parks
+//
+// This file is part of ExpressBetaDiversity.
+//
+// ExpressBetaDiversity is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// ExpressBetaDiversity is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ExpressBetaDiversity. If not, see
+// <http://www.gnu.org/licenses/>.
+//=======================================================================
+
+#ifndef _TEXT_MATRIX_WRITER_
+#define _TEXT_MATRIX_WRITER_
+
+#include "Precompiled.hpp"
+
+#include "MatrixWriter.hpp"
+
+/**
+ * @brief Write a dissimilarity matrix as tab-delimited text.
+ *
+ * The condensed and square layouts give the number of samples on the first line followed by 
+ * one line per sample starting with its name, as in the Phylip format. The pairs layout has 
+ * a line for each pair of samples giving the name of both samples and their dissimilarity. The 
+ * neighbors layout has a line for each sample giving its name followed by the name and 
+ * dissimilarity of each of its nearest neighbors. Values are formatted without iostreams so 
+ * the output is independent of the locale. Rows are formatted in parallel by the worker 
+ * threads.
+ *
+ * Values can instead be written in scientific notation right-aligned to a fixed width. The 
+ * offset of every row of the condensed layout is then known in advance, so this layout 
+ * becomes positional.
+ */
+class TextMatrixWriter : public MatrixWriter
+{
+public:
+	/** 
+	 * @brief Constructor.
+	 *
+	 * @param layout Layout of matrix.
+	 * @param precision Number of significant digits of values, or 0 for the shortest text which reads back to the exact value.
+	 * @param bFixedWidth Flag indicating values should be written in scientific notation padded to a fixed width.
+	 */
+	TextMatrixWriter(LAYOUT layout = CONDENSED, uint precision = 6, bool bFixedWidth = false);
+
+	/** Destructor. */
+	~TextMatrixWriter() {}
+
+	/**
+	* @brief Format a value as printf() does with %.<precision>g.
+	*
+	* @param value Value to format.
+	* @param precision Number of significant digits, or 0 for the shortest text which reads back to the exact value.
+	* @param buffer Buffer of at least MAX_VALUE_LEN characters. The text is not null-terminated.
+	* @return Length of text.
+	*/
+	static uint FormatDouble(double value, uint precision, char* buffer);
+
+	/**
+	* @brief Format a value as printf() does with %<width>.<precision-1>e.
+	*
+	* @param value Value to format.
+	* @param precision Number of significant digits, or 0 for 17 digits which read back to the exact value.
+	* @param buffer Buffer of at least MAX_VALUE_LEN characters. The text is not null-terminated.
+	* @return Length of text, which is always GetFixedWidth(precision).
+	*/
+	static uint FormatFixed(double value, uint precision, char* buffer);
+
+	/** Get width of values formatted with FormatFixed(). */
+	static uint GetFixedWidth(uint precision);
+
+	/** Maximum length of a formatted value. */
+	static const uint MAX_VALUE_LEN = 32;
+
+protected:
+	/** Write number of samples. */
+	bool WriteHeader();
+
+	/** Format rows in parallel and write them in order. */
+	void AppendRows(uint firstRow, uint numRows, const double* values, uint64 rowStride, bool bFullRows);
+
+	/** Format pairs of rows of a sparse matrix or neighbors of samples in parallel and write them in order. */
+	void AppendEdges(uint firstRow, const std::vector< std::vector<MatrixEdge> >& rowEdges);
+
+	/** Determine offsets of sample names for fixed-width values. */
+	void Initialize();
+
+	/** Check if the offset of every row is known in advance. */
+	bool IsPositionalLayout() const { return m_layout == CONDENSED && m_bFixedWidth; }
+
+	/** Get offset of a row of the condensed layout with fixed-width values. */
+	uint64 GetLayoutRowOffset(uint row) const;
+
+	/** Format a segment of a row of the condensed layout with fixed-width values. */
+	uint64 FormatSegment(uint row, uint firstCol, uint numValues, const double* values, std::vector<char>& buffer) const;
+
+private:
+	/** Format a value with the precision and width of the writer. */
+	uint FormatValue(double value, char* buffer) const;
+
+	/** Format a row of the matrix into text. */
+	void FormatRow(uint row, const double* values, uint numValues, std::string& text) const;
+
+	/** Format the pairs of a row of the matrix into text, one line per pair. */
+	void FormatPairs(uint row, const double* values, uint numValues, std::string& text) const;
+
+	/** Format the pairs of a row of a sparse matrix into text, one line per pair. */
+	void FormatEdges(uint row, const std::vector<MatrixEdge>& edges, std::string& text) const;
+
+	/** Format the nearest neighbors of a sample into a line of text. */
+	void FormatNeighbors(uint row, const std::vector<MatrixEdge>& neighbors, std::string& text) const;
+
+private:
+	/** Maximum number of values formatted together by the worker threads. */
+	static const uint FORMAT_BATCH_SIZE = 4*1024*1024;
+
+	/** Number of significant digits of values. */
+	uint m_precision;
+
+	/** Flag indicating values are written in scientific notation padded to a fixed width. */
+	bool m_bFixedWidth;
+
+	/** Length of header. */
+	uint64 m_headerSize;
+
+	/** Total length of the names of all samples before each sample. */
+	std::vector<uint64> m_nameOffsets;
+};
+
+#endif
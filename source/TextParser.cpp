@@ -0,0 +1,341 @@
+//=======================================================================
+// Author: Donovan Parks
+//
+// Copyright 2011 Donovan Parks
+//
+// This file is part of ExpressBetaDiversity.
+//
+// ExpressBetaDiversity is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// ExpressBetaDiversity is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ExpressBetaDiversity. If not, see
+// <http://www.gnu.org/licenses/>.
+//=======================================================================
+
+#include "Precompiled.hpp"
+
+#include "TextParser.hpp"
+
+#if defined(__AVX2__)
+	#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#include <emmintrin.h>
+	#define USE_SSE2
+#endif
+
+#ifdef _MSC_VER
+	#include <intrin.h>
+#endif
+
+// powers of ten which are exactly representable as doubles
+const double EXACT_POWERS_OF_TEN[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 
+																				1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+const int MAX_EXACT_POWER_OF_TEN = 22;
+
+// integers up to 2^53 are exactly representable as doubles
+const uint64 MAX_EXACT_MANTISSA = 1ULL << 53;
+
+// significant digits which always fit in a 64-bit mantissa
+const int MAX_MANTISSA_DIGITS = 19;
+
+// number of bytes tested for delimiters at once
+const uint DELIMITER_BLOCK_SIZE = 64;
+
+namespace
+{
+	inline bool IsDigit(char c)
+	{
+		return c >= '0' && c <= '9';
+	}
+
+	inline bool IsDelimiter(char c)
+	{
+		return c == '\t' || c == '\n';
+	}
+
+	/** Get bit mask of the tabs and end-of-line characters in a 64 byte block. */
+	inline uint64 DelimiterMask(const char* block)
+	{
+	#if defined(__AVX2__)
+		const __m256i tab = _mm256_set1_epi8('\t');
+		const __m256i eol = _mm256_set1_epi8('\n');
+
+		__m256i lo = _mm256_loadu_si256((const __m256i*)block);
+		__m256i hi = _mm256_loadu_si256((const __m256i*)(block + 32));
+		uint64 loMask = (uint)_mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(lo, tab), _mm256_cmpeq_epi8(lo, eol)));
+		uint64 hiMask = (uint)_mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(hi, tab), _mm256_cmpeq_epi8(hi, eol)));
+
+		return loMask | (hiMask << 32);
+	#elif defined(USE_SSE2)
+		const __m128i tab = _mm_set1_epi8('\t');
+		const __m128i eol = _mm_set1_epi8('\n');
+
+		uint64 mask = 0;
+		for(uint i = 0; i < DELIMITER_BLOCK_SIZE; i += 16)
+		{
+			__m128i v = _mm_loadu_si128((const __m128i*)(block + i));
+			mask |= (uint64)(uint)_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, tab), _mm_cmpeq_epi8(v, eol))) << i;
+		}
+
+		return mask;
+	#else
+		uint64 mask = 0;
+		for(uint i = 0; i < DELIMITER_BLOCK_SIZE; ++i)
+		{
+			if(IsDelimiter(block[i]))
+				mask |= 1ULL << i;
+		}
+
+		return mask;
+	#endif
+	}
+
+	/** Get index of lowest set bit of a non-zero mask. */
+	inline uint LowestSetBit(uint64 mask)
+	{
+	#if defined(__GNUC__)
+		return __builtin_ctzll(mask);
+	#elif defined(_MSC_VER) && defined(_M_X64)
+		unsigned long index;
+		_BitScanForward64(&index, mask);
+		return index;
+	#else
+		uint index = 0;
+		while(!(mask & 1))
+		{
+			mask >>= 1;
+			index++;
+		}
+		return index;
+	#endif
+	}
+
+	/** Parse a field of a count table. */
+	inline double ParseField(const char* start, const char* end)
+	{
+		// most counts in a sample table are zero
+		if(end - start == 1 && *start == '0')
+			return 0.0;
+
+		return ParseDouble(start, end);
+	}
+
+	/** Set every field as a count. */
+	struct AllFields
+	{
+		AllFields(double* counts): m_counts(counts) {}
+
+		void Set(uint field, const char* start, const char* end) { m_counts[field] = ParseField(start, end); }
+		void Clear(uint field) { m_counts[field] = 0.0; }
+
+		double* m_counts;
+	};
+
+	/** Set kept fields as a count at their mapped position, skipping other fields without parsing them. */
+	struct KeptFields
+	{
+		KeptFields(const uint* columnToIndex, const uint64* keptColumns, double* counts)
+			: m_columnToIndex(columnToIndex), m_keptColumns(keptColumns), m_counts(counts) {}
+
+		bool IsKept(uint field) const { return (m_keptColumns[field / 64] >> (field % 64)) & 1; }
+
+		void Set(uint field, const char* start, const char* end)
+		{
+			if(IsKept(field))
+				m_counts[m_columnToIndex[field]] = ParseField(start, end);
+		}
+
+		void Clear(uint field)
+		{
+			if(IsKept(field))
+				m_counts[m_columnToIndex[field]] = 0.0;
+		}
+
+		const uint* m_columnToIndex;
+		const uint64* m_keptColumns;
+		double* m_counts;
+	};
+
+	/** Pass each of the first numFields tab-delimited fields to fields.Set(), and fields.Clear() for each missing field. */
+	template<class Fields> uint ParseFields(const char* start, const char* lineEnd, uint numFields, Fields& fields)
+	{
+		uint field = 0;
+		const char* fieldStart = start;
+
+		// delimiters of each 64 byte block are found at once
+		const char* p = start;
+		for(; field < numFields && p + DELIMITER_BLOCK_SIZE <= lineEnd; p += DELIMITER_BLOCK_SIZE)
+		{
+			uint64 mask = DelimiterMask(p);
+			while(mask != 0 && field < numFields)
+			{
+				const char* delimiter = p + LowestSetBit(mask);
+				fields.Set(field++, fieldStart, delimiter);
+				fieldStart = delimiter + 1;
+
+				// clear lowest set bit
+				mask &= mask - 1;
+			}
+		}
+
+		// remainder of line
+		p = std::max(p, fieldStart);
+		while(field < numFields && fieldStart <= lineEnd)
+		{
+			while(p < lineEnd && !IsDelimiter(*p))
+				++p;
+
+			fields.Set(field++, fieldStart, p);
+			fieldStart = ++p;
+		}
+
+		uint numFound = field;
+		for(; field < numFields; ++field)
+			fields.Clear(field);
+
+		// indicate line has more fields than requested
+		if(numFound == numFields && fieldStart <= lineEnd)
+			numFound++;
+
+		return numFound;
+	}
+}
+
+double ParseDouble(const char* p, const char* end)
+{
+	while(p < end && (*p == ' ' || *p == '\t'))
+		++p;
+
+	const char* numberStart = p;
+	bool bNegative = false;
+	if(p < end && (*p == '-' || *p == '+'))
+	{
+		bNegative = (*p == '-');
+		++p;
+	}
+
+	// significant digits and power of ten they are scaled by
+	uint64 mantissa = 0;
+	int numDigits = 0;
+	int exponent = 0;
+	bool bTruncated = false;
+	bool bDigits = false;
+
+	for(; p < end && IsDigit(*p); ++p)
+	{
+		bDigits = true;
+		uint digit = *p - '0';
+		if(numDigits < MAX_MANTISSA_DIGITS)
+		{
+			mantissa = mantissa * 10 + digit;
+			if(mantissa != 0)
+				numDigits++;
+		}
+		else
+		{
+			exponent++;
+			bTruncated |= (digit != 0);
+		}
+	}
+
+	if(p < end && *p == '.')
+	{
+		for(++p; p < end && IsDigit(*p); ++p)
+		{
+			bDigits = true;
+			uint digit = *p - '0';
+			if(numDigits < MAX_MANTISSA_DIGITS)
+			{
+				mantissa = mantissa * 10 + digit;
+				if(mantissa != 0)
+					numDigits++;
+				exponent--;
+			}
+			else
+				bTruncated |= (digit != 0);
+		}
+	}
+
+	if(!bDigits)
+		return 0.0;
+
+	if(p < end && (*p == 'e' || *p == 'E'))
+	{
+		const char* exponentStart = p;
+		++p;
+
+		bool bNegativeExponent = false;
+		if(p < end && (*p == '-' || *p == '+'))
+		{
+			bNegativeExponent = (*p == '-');
+			++p;
+		}
+
+		if(p < end && IsDigit(*p))
+		{
+			int value = 0;
+			for(; p < end && IsDigit(*p); ++p)
+			{
+				if(value < 100000)
+					value = value * 10 + (*p - '0');
+			}
+
+			exponent += bNegativeExponent ? -value : value;
+		}
+		else
+			p = exponentStart;
+	}
+
+	if(mantissa == 0)
+		return bNegative ? -0.0 : 0.0;
+
+	// exact when mantissa and power of ten are exact doubles and arithmetic is in double precision (Clinger's fast path)
+#if !defined(FLT_EVAL_METHOD) || FLT_EVAL_METHOD == 0
+	if(!bTruncated && mantissa <= MAX_EXACT_MANTISSA && exponent >= -MAX_EXACT_POWER_OF_TEN && exponent <= MAX_EXACT_POWER_OF_TEN)
+	{
+		double value = (double)mantissa;
+		value = (exponent < 0) ? value / EXACT_POWERS_OF_TEN[-exponent] : value * EXACT_POWERS_OF_TEN[exponent];
+		return bNegative ? -value : value;
+	}
+#endif
+
+	// strtod requires a terminated string
+	std::string number(numberStart, p);
+	return strtod(number.c_str(), NULL);
+}
+
+const char* FindDelimiter(const char* start, const char* end)
+{
+	const char* p = start;
+	for(; p + DELIMITER_BLOCK_SIZE <= end; p += DELIMITER_BLOCK_SIZE)
+	{
+		uint64 mask = DelimiterMask(p);
+		if(mask != 0)
+			return p + LowestSetBit(mask);
+	}
+
+	while(p < end && !IsDelimiter(*p))
+		++p;
+
+	return p;
+}
+
+uint ParseCounts(const char* fields, const char* lineEnd, double* counts, uint numCounts)
+{
+	AllFields allFields(counts);
+	return ParseFields(fields, lineEnd, numCounts, allFields);
+}
+
+uint ParseCounts(const char* fields, const char* lineEnd, const uint* columnToIndex, const uint64* keptColumns, double* counts, uint numColumns)
+{
+	KeptFields keptFields(columnToIndex, keptColumns, counts);
+	return ParseFields(fields, lineEnd, numColumns, keptFields);
+}
@@ -0,0 +1,78 @@
+//=======================================================================
+// Author: Donovan Parks
+//
+// Copyright 2011 Donovan Parks
+//
+// This file is part of ExpressBetaDiversity.
+//
+// ExpressBetaDiversity is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// ExpressBetaDiversity is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ExpressBetaDiversity. If not, see
+// <http://www.gnu.org/licenses/>.
+//=======================================================================
+
+#ifndef _TEXT_PARSER_
+#define _TEXT_PARSER_
+
+#include "Precompiled.hpp"
+
+/**
+ * @brief Parse a decimal number, correctly rounded to the nearest double.
+ *
+ * Leading spaces or tabs and a sign are accepted, followed by digits with an optional 
+ * decimal point and exponent. Parsing stops at the first other character or at end.
+ * Numbers with at most 19 significant digits and a small exponent are converted exactly
+ * with a single floating-point operation; other numbers are converted with strtod().
+ *
+ * @param p Start of number.
+ * @param end End of text which may be parsed.
+ * @return Value of number, or 0 if there is no number.
+ */
+double ParseDouble(const char* p, const char* end);
+
+/**
+ * @brief Find the next tab or end-of-line character.
+ *
+ * @return Position of delimiter, or end if there is none.
+ */
+const char* FindDelimiter(const char* start, const char* end);
+
+/**
+ * @brief Parse tab-delimited counts.
+ *
+ * Delimiters are found 64 bytes at a time with SIMD instructions where available, and 
+ * fields holding a single '0' are recognized without being parsed as numbers.
+ *
+ * @param fields Start of first field.
+ * @param lineEnd End of line.
+ * @param counts Set to the value of each field. Counts for missing fields are set to 0.
+ * @param numCounts Number of counts to parse.
+ * @return Number of fields in line, up to numCounts+1 to indicate the line has additional fields.
+ */
+uint ParseCounts(const char* fields, const char* lineEnd, double* counts, uint numCounts);
+
+/**
+ * @brief Parse the kept fields of tab-delimited counts.
+ *
+ * Fields which are not kept are skipped without being parsed.
+ *
+ * @param fields Start of first field.
+ * @param lineEnd End of line.
+ * @param columnToIndex Position in counts of each kept field.
+ * @param keptColumns Bit mask of kept fields, 64 fields per word.
+ * @param counts Set to the value of each kept field. Counts for missing fields are set to 0.
+ * @param numColumns Number of fields to consider.
+ * @return Number of fields in line, up to numColumns+1 to indicate the line has additional fields.
+ */
+uint ParseCounts(const char* fields, const char* lineEnd, const uint* columnToIndex, const uint64* keptColumns, double* counts, uint numColumns);
+
+#endif
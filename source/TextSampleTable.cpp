@@ -0,0 +1,152 @@
+//=======================================================================
+// Author: Donovan Parks
+//
+// Copyright 2011 Donovan Parks
+//
+// This file is part of ExpressBetaDiversity.
+//
+// ExpressBetaDiversity is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// ExpressBetaDiversity is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ExpressBetaDiversity. If not, see
+// <http://www.gnu.org/licenses/>.
+//=======================================================================
+
+#include "Precompiled.hpp"
+
+#include "TextSampleTable.hpp"
+#include "Utils.hpp"
+
+bool TextSampleTable::Open(const std::string& filename)
+{
+	m_bCompressed = (DecompressBuf::GetCompression(filename) != DecompressBuf::NO_COMPRESSION);
+	if(m_bCompressed ? !m_compressed.Open(filename) : !m_file.Open(filename))
+	{
+		std::cerr << "Unable to open sample file: " << filename << std::endl;
+		return false;
+	}
+
+	const MappedFile& file = m_bCompressed ? m_compressed.GetCompressedFile() : m_file;
+	if(file.GetSize() == 0)
+	{
+		std::cerr << "Sample file is empty: " << filename << std::endl;
+		return false;
+	}
+
+	// use saved indices if sample file is unchanged, otherwise scan sample file
+	std::string indexFile = filename + ".idx";
+	uint64 fingerprint = SampleIndex::Fingerprint(filename, file);
+	if(m_bCompressed && !m_compressed.LoadIndex(filename + ".zidx", fingerprint))
+	{
+		if(!m_compressed.BuildIndex())
+		{
+			std::cerr << "Unable to decompress sample file: " << filename << std::endl;
+			return false;
+		}
+
+		m_compressed.SaveIndex(filename + ".zidx", fingerprint);
+	}
+
+	if(!m_index.Load(indexFile, fingerprint))
+	{
+		m_file.Advise(MappedFile::SEQUENTIAL_ACCESS);
+
+		if(m_bCompressed ? !m_index.Build(m_compressed) : !m_index.Build(m_file))
+		{
+			std::cerr << "Sample file is empty: " << filename << std::endl;
+			return false;
+		}
+
+		// index is only an optimization, so failing to save it is not an error
+		m_index.Save(indexFile, fingerprint);
+
+		m_file.Advise(MappedFile::NORMAL_ACCESS);
+	}
+
+	return true;
+}
+
+void TextSampleTable::Prefetch(uint firstIndex, uint numSamples) const
+{
+	if(m_bCompressed || numSamples == 0 || firstIndex >= GetNumSamples())
+		return;
+
+	uint lastIndex = std::min<uint>(firstIndex + numSamples, GetNumSamples()) - 1;
+	m_file.Prefetch(m_index.GetLineStart(firstIndex), m_index.GetLineEnd(lastIndex) - m_index.GetLineStart(firstIndex));
+}
+
+bool TextSampleTable::GetFields(uint index, std::vector<char>& line, const char*& fields, const char*& lineEnd) const
+{
+	uint64 lineStart = m_index.GetLineStart(index);
+	uint64 lineLen = m_index.GetLineEnd(index) - lineStart;
+
+	// parse directly from the mapped file; no stream or buffer is shared between readers
+	const char* curPos = m_bCompressed ? NULL : m_file.GetData() + lineStart;
+	lineEnd = m_bCompressed ? NULL : curPos + lineLen;
+
+	// decompressed lines, and a final line without an end-of-line character, are copied so parsing stops at their end
+	if(m_bCompressed || m_index.GetLineEnd(index) == m_file.GetSize())
+	{
+		if(!m_bCompressed)
+			line.assign(curPos, lineEnd);
+		else if(!m_compressed.Read(lineStart, lineLen, line))
+		{
+			std::cerr << "Error decompressing sample: " << m_index.GetName(index) << std::endl;
+			return false;
+		}
+
+		line.push_back(0);
+		curPos = &line[0];
+		lineEnd = curPos + lineLen;
+	}
+
+	// skip sample name
+	curPos = FindDelimiter(curPos, lineEnd);
+	if(curPos < lineEnd)
+		curPos++;
+
+	fields = curPos;
+
+	return true;
+}
+
+bool TextSampleTable::GetCounts(uint index, std::vector<double>& count) const
+{
+	uint numTaxa = m_index.GetTaxa().size();
+	count.resize(numTaxa);
+
+	std::vector<char> line;
+	const char* fields;
+	const char* lineEnd;
+	if(!GetFields(index, line, fields, lineEnd))
+		return false;
+
+	if(numTaxa > 0)
+		ParseCounts(fields, lineEnd, &count[0], numTaxa);
+
+	return true;
+}
+
+bool TextSampleTable::GetCounts(uint index, const std::vector<uint>& columnToIndex, const std::vector<uint64>& keptColumns, std::vector<double>& count) const
+{
+	std::vector<char> line;
+	const char* fields;
+	const char* lineEnd;
+	if(!GetFields(index, line, fields, lineEnd))
+		return false;
+
+	// counts of removed taxa are skipped without being parsed
+	uint numColumns = std::min<uint>(m_index.GetTaxa().size(), columnToIndex.size());
+	if(numColumns > 0 && !count.empty())
+		ParseCounts(fields, lineEnd, &columnToIndex[0], &keptColumns[0], &count[0], numColumns);
+
+	return true;
+}
@@ -0,0 +1,83 @@
+//=======================================================================
+// Author: Donovan Parks
+//
+// Copyright 2011 Donovan Parks
+//
+// This file is part of ExpressBetaDiversity.
+//
+// ExpressBetaDiversity is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// ExpressBetaDiversity is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ExpressBetaDiversity. If not, see
+// <http://www.gnu.org/licenses/>.
+//=======================================================================
+
+#ifndef _TEXT_SAMPLE_TABLE_
+#define _TEXT_SAMPLE_TABLE_
+
+#include "Precompiled.hpp"
+
+#include "SampleTable.hpp"
+#include "MappedFile.hpp"
+#include "CompressedFile.hpp"
+#include "SampleIndex.hpp"
+
+/**
+ * @brief Tab-delimited sample table with a header line of taxa names and one line per sample.
+ *
+ * The file is memory mapped and counts are parsed directly from the mapping. An index of 
+ * the file is saved to <filename>.idx and reused while the file is unchanged. Sample lines of 
+ * gzip or zstd files are decompressed on demand using a block index saved to <filename>.zidx.
+ */
+class TextSampleTable : public SampleTable
+{
+public:
+	/** Constructor. */
+	TextSampleTable(): m_bCompressed(false) {}
+
+	/** Destructor. */
+	~TextSampleTable() {}
+
+	bool Open(const std::string& filename);
+
+	const std::vector<std::string>& GetTaxa() const { return m_index.GetTaxa(); }
+
+	uint GetNumSamples() const { return m_index.GetNumLines(); }
+
+	const std::string& GetSampleName(uint index) const { return m_index.GetName(index); }
+
+	bool GetCounts(uint index, std::vector<double>& count) const;
+
+	bool GetCounts(uint index, const std::vector<uint>& columnToIndex, const std::vector<uint64>& keptColumns, std::vector<double>& count) const;
+
+	void SetAccessPattern(MappedFile::ACCESS_PATTERN accessPattern) const { m_file.Advise(accessPattern); }
+
+	void Prefetch(uint firstIndex, uint numSamples) const;
+
+private:
+	/** Find counts of a sample line. Lines which must be copied or decompressed are placed in line. */
+	bool GetFields(uint index, std::vector<char>& line, const char*& fields, const char*& lineEnd) const;
+
+private:
+	/** Sample file mapped into memory. Read-only, so it can be shared by concurrent readers. */
+	MappedFile m_file;
+
+	/** Compressed sample file. */
+	CompressedFile m_compressed;
+
+	/** Flag indicating if sample file is compressed. */
+	bool m_bCompressed;
+
+	/** Location of each sample line in sample file. */
+	SampleIndex m_index;
+};
+
+#endif
@@ -0,0 +1,306 @@
+//=======================================================================
+// Author: Donovan Parks
+//
+// Copyright 2011 Donovan Parks
+//
+// This file is part of ExpressBetaDiversity.
+//
+// ExpressBetaDiversity is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// ExpressBetaDiversity is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ExpressBetaDiversity. If not, see
+// <http://www.gnu.org/licenses/>.
+//=======================================================================
+
+#include "Precompiled.hpp"
+
+#include "ThreadPlacement.hpp"
+
+#include <cerrno>
+
+#ifdef __linux__
+	#include <sched.h>
+	#include <dirent.h>
+	#include <unistd.h>
+	#include <sys/syscall.h>
+#endif
+
+// memory policy mode from <linux/mempolicy.h>
+const int MPOL_INTERLEAVE_MODE = 3;
+
+ThreadPlacement::ThreadPlacement()
+	: m_numThreads(1), m_affinity(NO_AFFINITY), m_memPolicy(FIRST_TOUCH), m_bMemPolicyApplied(false), m_numNodes(1)
+{
+
+}
+
+bool ThreadPlacement::Apply(uint numThreads, const std::string& affinity, const std::string& memPolicy)
+{
+	if(affinity == "none")
+		m_affinity = NO_AFFINITY;
+	else if(affinity == "compact")
+		m_affinity = COMPACT_AFFINITY;
+	else if(affinity == "scatter")
+		m_affinity = SCATTER_AFFINITY;
+	else
+	{
+		std::cerr << "Unknown thread affinity: " << affinity << " (expected none, compact, or scatter)" << std::endl;
+		return false;
+	}
+
+	if(memPolicy == "first-touch")
+		m_memPolicy = FIRST_TOUCH;
+	else if(memPolicy == "interleave")
+		m_memPolicy = INTERLEAVE;
+	else
+	{
+		std::cerr << "Unknown memory placement policy: " << memPolicy << " (expected first-touch or interleave)" << std::endl;
+		return false;
+	}
+
+	ReadTopology();
+
+	// memory policy is inherited by threads so must be set before the worker threads are created
+	if(m_memPolicy == INTERLEAVE)
+		m_bMemPolicyApplied = SetInterleavePolicy();
+	else
+		m_bMemPolicyApplied = true;
+
+#ifdef _OPENMP
+	if(numThreads == 0)
+		numThreads = m_cpus.empty() ? omp_get_num_procs() : m_cpus.size();
+
+	omp_set_num_threads(numThreads);
+	m_numThreads = numThreads;
+#else
+	m_numThreads = 1;
+#endif
+
+	PinThreads();
+
+	return true;
+}
+
+void ThreadPlacement::ReadTopology()
+{
+	m_cpus.clear();
+	m_cpuToNode.clear();
+	m_numNodes = 1;
+
+#ifdef __linux__
+	// CPUs this process is allowed to run on
+	cpu_set_t cpuSet;
+	CPU_ZERO(&cpuSet);
+	if(sched_getaffinity(0, sizeof(cpuSet), &cpuSet) == 0)
+	{
+		for(int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+		{
+			if(CPU_ISSET(cpu, &cpuSet))
+				m_cpus.push_back(cpu);
+		}
+	}
+
+	// NUMA node of each CPU as reported by sysfs
+	DIR* nodeDir = opendir("/sys/devices/system/node");
+	if(nodeDir != NULL)
+	{
+		uint numNodes = 0;
+		struct dirent* entry;
+		while((entry = readdir(nodeDir)) != NULL)
+		{
+			std::string name = entry->d_name;
+			if(name.size() <= 4 || name.substr(0, 4) != "node" || name.find_first_not_of("0123456789", 4) != std::string::npos)
+				continue;
+
+			int node = atoi(name.substr(4).c_str());
+			numNodes++;
+
+			std::ifstream cpuListFile(("/sys/devices/system/node/" + name + "/cpulist").c_str());
+			std::string cpuList;
+			std::getline(cpuListFile, cpuList);
+
+			// CPU list has the form '0-3,8-11'
+			std::stringstream ss(cpuList);
+			std::string range;
+			while(std::getline(ss, range, ','))
+			{
+				if(range.empty())
+					continue;
+
+				int first = atoi(range.c_str());
+				int last = first;
+				std::string::size_type dash = range.find('-');
+				if(dash != std::string::npos)
+					last = atoi(range.substr(dash+1).c_str());
+
+				for(int cpu = first; cpu <= last; ++cpu)
+					m_cpuToNode[cpu] = node;
+			}
+		}
+		closedir(nodeDir);
+
+		if(numNodes > 0)
+			m_numNodes = numNodes;
+	}
+#endif
+}
+
+int ThreadPlacement::GetNode(int cpu) const
+{
+	std::map<int, int>::const_iterator it = m_cpuToNode.find(cpu);
+	if(it == m_cpuToNode.end())
+		return 0;
+
+	return it->second;
+}
+
+void ThreadPlacement::PinThreads()
+{
+	m_threadCpu.clear();
+	m_threadCpu.resize(m_numThreads, -1);
+	m_threadCurCpu.clear();
+	m_threadCurCpu.resize(m_numThreads, -1);
+
+	if(m_affinity != NO_AFFINITY && !m_cpus.empty())
+	{
+		// order CPUs by NUMA node so consecutive threads share a node
+		std::vector< std::vector<int> > nodeCpus;
+		for(uint i = 0; i < m_cpus.size(); ++i)
+		{
+			uint node = GetNode(m_cpus[i]);
+			if(node >= nodeCpus.size())
+				nodeCpus.resize(node+1);
+
+			nodeCpus[node].push_back(m_cpus[i]);
+		}
+
+		std::vector<int> cpuOrder;
+		if(m_affinity == COMPACT_AFFINITY)
+		{
+			for(uint node = 0; node < nodeCpus.size(); ++node)
+				cpuOrder.insert(cpuOrder.end(), nodeCpus[node].begin(), nodeCpus[node].end());
+		}
+		else
+		{
+			// scatter: round-robin over NUMA nodes
+			for(uint i = 0; cpuOrder.size() < m_cpus.size(); ++i)
+			{
+				for(uint node = 0; node < nodeCpus.size(); ++node)
+				{
+					if(i < nodeCpus[node].size())
+						cpuOrder.push_back(nodeCpus[node][i]);
+				}
+			}
+		}
+
+		for(uint t = 0; t < m_numThreads; ++t)
+			m_threadCpu[t] = cpuOrder[t % cpuOrder.size()];
+	}
+
+	// threads can only be pinned on Linux, so elsewhere they are recorded as failing to be pinned
+	m_threadPinError.clear();
+	m_threadPinError.resize(m_numThreads, 0);
+	for(uint t = 0; t < m_numThreads; ++t)
+	{
+		if(m_threadCpu[t] != -1)
+			m_threadPinError[t] = ENOSYS;
+	}
+
+#ifdef _OPENMP
+	#pragma omp parallel
+	{
+		int thread = omp_get_thread_num();
+
+	#ifdef __linux__
+		if(m_threadCpu[thread] != -1)
+		{
+			cpu_set_t cpuSet;
+			CPU_ZERO(&cpuSet);
+			CPU_SET(m_threadCpu[thread], &cpuSet);
+			m_threadPinError[thread] = (sched_setaffinity(0, sizeof(cpuSet), &cpuSet) == 0) ? 0 : errno;
+		}
+
+		m_threadCurCpu[thread] = sched_getcpu();
+	#endif
+	}
+#endif
+
+	uint numUnpinned = 0;
+	for(uint t = 0; t < m_numThreads; ++t)
+	{
+		if(m_threadPinError[t] != 0)
+			numUnpinned++;
+	}
+
+	if(numUnpinned > 0)
+		std::cout << "(Warning) Unable to pin " << numUnpinned << " of " << m_numThreads << " worker threads to their CPU." << std::endl;
+}
+
+bool ThreadPlacement::SetInterleavePolicy()
+{
+#if defined(__linux__) && defined(SYS_set_mempolicy)
+	if(m_cpuToNode.empty())
+		return false;
+
+	int maxNode = 0;
+	std::map<int, int>::const_iterator it;
+	for(it = m_cpuToNode.begin(); it != m_cpuToNode.end(); ++it)
+		maxNode = std::max<int>(maxNode, it->second);
+
+	const uint bitsPerWord = 8*sizeof(unsigned long);
+	std::vector<unsigned long> nodeMask(maxNode/bitsPerWord + 1, 0);
+	for(it = m_cpuToNode.begin(); it != m_cpuToNode.end(); ++it)
+		nodeMask[it->second / bitsPerWord] |= 1UL << (it->second % bitsPerWord);
+
+	return syscall(SYS_set_mempolicy, MPOL_INTERLEAVE_MODE, &nodeMask[0], nodeMask.size()*bitsPerWord + 1) == 0;
+#else
+	return false;
+#endif
+}
+
+void ThreadPlacement::Report() const
+{
+	std::string affinity = "none";
+	if(m_affinity == COMPACT_AFFINITY)
+		affinity = "compact";
+	else if(m_affinity == SCATTER_AFFINITY)
+		affinity = "scatter";
+
+	std::string memPolicy = (m_memPolicy == INTERLEAVE) ? "interleave" : "first-touch";
+
+	std::cout << "  Number of worker threads: " << m_numThreads << std::endl;
+	std::cout << "  Number of NUMA nodes: " << m_numNodes << std::endl;
+	std::cout << "  Thread affinity: " << affinity << std::endl;
+	std::cout << "  Memory placement: " << memPolicy;
+	if(!m_bMemPolicyApplied)
+		std::cout << " (not supported on this system, using first-touch)";
+	std::cout << std::endl;
+
+	for(uint t = 0; t < m_numThreads; ++t)
+	{
+		std::cout << "    Thread " << t << ": ";
+		if(m_threadCpu[t] != -1 && m_threadPinError[t] == 0)
+			std::cout << "pinned to CPU " << m_threadCpu[t] << " (node " << GetNode(m_threadCpu[t]) << ")";
+		else if(m_threadCpu[t] != -1)
+		{
+			std::cout << "not pinned, unable to pin to CPU " << m_threadCpu[t] << " (" << strerror(m_threadPinError[t]) << ")";
+			if(m_threadCurCpu[t] != -1)
+				std::cout << ", running on CPU " << m_threadCurCpu[t] << " (node " << GetNode(m_threadCurCpu[t]) << ")";
+		}
+		else if(m_threadCurCpu[t] != -1)
+			std::cout << "not pinned, running on CPU " << m_threadCurCpu[t] << " (node " << GetNode(m_threadCurCpu[t]) << ")";
+		else
+			std::cout << "not pinned";
+		std::cout << std::endl;
+	}
+
+	std::cout << std::endl;
+}
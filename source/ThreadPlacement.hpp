@@ -0,0 +1,108 @@
+//=======================================================================
+// Author: Donovan Parks
+//
+// Copyright 2011 Donovan Parks
+//
+// This file is part of ExpressBetaDiversity.
+//
+// ExpressBetaDiversity is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// ExpressBetaDiversity is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ExpressBetaDiversity. If not, see
+// <http://www.gnu.org/licenses/>.
+//=======================================================================
+
+#ifndef _THREAD_PLACEMENT_
+#define _THREAD_PLACEMENT_
+
+#include "Precompiled.hpp"
+
+/**
+ * @brief Set number of worker threads, pin workers to cores, and select NUMA memory placement.
+ *
+ * Must be applied before the first parallel region is entered since
+ * worker threads inherit the memory policy of the thread that creates them.
+ */
+class ThreadPlacement
+{
+public:
+	enum AFFINITY { NO_AFFINITY, COMPACT_AFFINITY, SCATTER_AFFINITY };
+	enum MEMORY_POLICY { FIRST_TOUCH, INTERLEAVE };
+
+public:
+	/** Constructor. */
+	ThreadPlacement();
+
+	/** Destructor. */
+	~ThreadPlacement() {}
+
+	/**
+	* @brief Apply thread count, affinity, and memory placement settings.
+	*
+	* @param numThreads Number of worker threads (0 to use all available cores).
+	* @param affinity Thread affinity ('none', 'compact', or 'scatter').
+	* @param memPolicy Memory placement policy ('first-touch' or 'interleave').
+	* @return True if settings were valid, else false.
+	*/
+	bool Apply(uint numThreads, const std::string& affinity, const std::string& memPolicy);
+
+	/** Get number of worker threads. */
+	uint GetNumThreads() const { return m_numThreads; }
+
+	/** Print the placement that was used. */
+	void Report() const;
+
+private:
+	/** Determine CPUs available to this process and the NUMA node of each. */
+	void ReadTopology();
+
+	/** Determine CPU for each worker thread and pin threads to them. */
+	void PinThreads();
+
+	/** Interleave pages of subsequent allocations across all NUMA nodes. */
+	bool SetInterleavePolicy();
+
+	/** Get NUMA node of a CPU. */
+	int GetNode(int cpu) const;
+
+private:
+	/** Number of worker threads. */
+	uint m_numThreads;
+
+	/** Requested thread affinity. */
+	AFFINITY m_affinity;
+
+	/** Requested memory placement policy. */
+	MEMORY_POLICY m_memPolicy;
+
+	/** Flag indicating if requested memory placement policy could be applied. */
+	bool m_bMemPolicyApplied;
+
+	/** CPUs available to this process. */
+	std::vector<int> m_cpus;
+
+	/** NUMA node of each available CPU. */
+	std::map<int, int> m_cpuToNode;
+
+	/** Number of NUMA nodes. */
+	uint m_numNodes;
+
+	/** CPU each worker thread is to be pinned to (-1 if not pinned). */
+	std::vector<int> m_threadCpu;
+
+	/** Error number from pinning each worker thread to its CPU (0 if pinned or not to be pinned). */
+	std::vector<int> m_threadPinError;
+
+	/** CPU each worker thread was running on after placement. */
+	std::vector<int> m_threadCurCpu;
+};
+
+#endif
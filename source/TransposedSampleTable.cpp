@@ -0,0 +1,136 @@
+//=======================================================================
+// Author: Donovan Parks
+//
+// Copyright 2011 Donovan Parks
+//
+// This file is part of ExpressBetaDiversity.
+//
+// ExpressBetaDiversity is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// ExpressBetaDiversity is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ExpressBetaDiversity. If not, see
+// <http://www.gnu.org/licenses/>.
+//=======================================================================
+
+#include "Precompiled.hpp"
+
+#include "TransposedSampleTable.hpp"
+#include "CompressedStream.hpp"
+#include "Utils.hpp"
+
+namespace
+{
+	/** Remove trailing carriage return. */
+	void TrimEndOfLine(std::string& line)
+	{
+		if(!line.empty() && line[line.size()-1] == '\r')
+			line.resize(line.size()-1);
+	}
+}
+
+bool TransposedSampleTable::IsTransposed(const std::string& filename)
+{
+	CompressedStream in(filename);
+	std::string line;
+	while(std::getline(in, line))
+	{
+		if(line.empty() || line == "\r" || IsComment(line))
+			continue;
+
+		return IsHeaderLine(line);
+	}
+
+	return false;
+}
+
+bool TransposedSampleTable::IsHeaderLine(const std::string& line)
+{
+	std::string label = line.substr(0, line.find('\t'));
+	return label == "#OTU ID" || label == "OTU ID" || label == "#OTU_ID" || label == "OTU_ID";
+}
+
+bool TransposedSampleTable::IsComment(const std::string& line)
+{
+	return !line.empty() && line[0] == '#' && line.find('\t') == std::string::npos;
+}
+
+bool TransposedSampleTable::Open(const std::string& filename)
+{
+	CompressedStream in(filename);
+	if(!in.is_open())
+	{
+		std::cerr << "Unable to open sample file: " << filename << std::endl;
+		return false;
+	}
+
+	return Read(in, filename);
+}
+
+bool TransposedSampleTable::Read(std::istream& in, const std::string& name)
+{
+	// header line gives sample names after a label for the taxon column
+	std::string line;
+	while(std::getline(in, line) && (line.empty() || line == "\r" || IsComment(line)));
+	TrimEndOfLine(line);
+
+	if(line.empty())
+	{
+		std::cerr << "Sample file is empty: " << name << std::endl;
+		return false;
+	}
+
+	std::stringstream ss(line);
+	std::string token;
+	std::getline(ss, token, '\t');
+	while(std::getline(ss, token, '\t'))
+		m_sampleNames.push_back(token);
+
+	// QIIME tables may end with a column of taxonomic lineages
+	bool bLineageColumn = !m_sampleNames.empty() && (m_sampleNames.back() == "taxonomy" || m_sampleNames.back() == "Consensus Lineage");
+	if(bLineageColumn)
+		m_sampleNames.pop_back();
+
+	// add non-zero counts of each taxon
+	uint numSamples = m_sampleNames.size();
+	std::vector<double> count(numSamples);
+	uint lineNum = 1;
+	while(std::getline(in, line))
+	{
+		++lineNum;
+		TrimEndOfLine(line);
+		if(line.empty())
+			continue;
+
+		const char* curPos = line.c_str();
+		const char* lineEnd = curPos + line.size();
+		const char* nameEnd = FindDelimiter(curPos, lineEnd);
+		if(nameEnd == lineEnd)
+		{
+			std::cerr << "Expected counts for taxon on line " << lineNum << " of sample file: " << name << std::endl;
+			return false;
+		}
+
+		uint taxonId = m_taxa.size();
+		m_taxa.push_back(std::string(curPos, nameEnd));
+
+		uint numFields = ParseCounts(nameEnd + 1, lineEnd, count.empty() ? NULL : &count[0], numSamples);
+		for(uint sampleIndex = 0; sampleIndex < numSamples; ++sampleIndex)
+			AddCount(sampleIndex, taxonId, count[sampleIndex]);
+
+		if(numFields < numSamples || (numFields > numSamples && !bLineageColumn))
+		{
+			std::cerr << "Expected " << numSamples << " counts on line " << lineNum << " of sample file: " << name << std::endl;
+			return false;
+		}
+	}
+
+	return Finalize();
+}
@@ -0,0 +1,64 @@
+//=======================================================================
+// Author: Donovan Parks
+//
+// Copyright 2011 Donovan Parks
+//
+// This file is part of ExpressBetaDiversity.
+//
+// ExpressBetaDiversity is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// ExpressBetaDiversity is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ExpressBetaDiversity. If not, see
+// <http://www.gnu.org/licenses/>.
+//=======================================================================
+
+#ifndef _TRANSPOSED_SAMPLE_TABLE_
+#define _TRANSPOSED_SAMPLE_TABLE_
+
+#include "Precompiled.hpp"
+
+#include "SparseSampleTable.hpp"
+
+/**
+ * @brief Tab-delimited sample table with taxa as rows and samples as columns.
+ *
+ * The first line gives the name of each sample (column) and each following line gives
+ * a taxon name followed by its count in each sample. The table is read in a single 
+ * streaming pass, with the non-zero counts of each row added to the sparse count store
+ * so the table is never transposed as a whole. Lines starting with '#' which do not 
+ * contain a tab (e.g., '# Constructed from biom file') are ignored, as is a final 
+ * 'taxonomy' or 'Consensus Lineage' column.
+ */
+class TransposedSampleTable : public SparseSampleTable
+{
+public:
+	/** Constructor. */
+	TransposedSampleTable() {}
+
+	/** Destructor. */
+	~TransposedSampleTable() {}
+
+	/** Check if the header line of a file starts with 'OTU ID' or '#OTU ID', as written by QIIME and biom convert. */
+	static bool IsTransposed(const std::string& filename);
+
+	/** Check if a line is the header line of a table with taxa as rows. */
+	static bool IsHeaderLine(const std::string& line);
+
+	/** Check if a line is a comment (starts with '#' and does not contain a tab). */
+	static bool IsComment(const std::string& line);
+
+	bool Open(const std::string& filename);
+
+	/** Read table from a stream. */
+	bool Read(std::istream& in, const std::string& name);
+};
+
+#endif
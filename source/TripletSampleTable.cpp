@@ -0,0 +1,148 @@
+//=======================================================================
+// Author: Donovan Parks
+//
+// Copyright 2011 Donovan Parks
+//
+// This file is part of ExpressBetaDiversity.
+//
+// ExpressBetaDiversity is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// ExpressBetaDiversity is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ExpressBetaDiversity. If not, see
+// <http://www.gnu.org/licenses/>.
+//=======================================================================
+
+#include "Precompiled.hpp"
+
+#include "TripletSampleTable.hpp"
+#include "CompressedStream.hpp"
+
+namespace
+{
+	/** Split line into fields at tabs, ignoring a trailing carriage return. */
+	void SplitFields(const std::string& line, std::vector<std::string>& fields)
+	{
+		fields.clear();
+
+		std::string::size_type end = line.size();
+		if(end > 0 && line[end-1] == '\r')
+			--end;
+
+		std::string::size_type start = 0;
+		while(true)
+		{
+			std::string::size_type tab = line.find('\t', start);
+			if(tab == std::string::npos || tab >= end)
+			{
+				fields.push_back(line.substr(start, end - start));
+				break;
+			}
+
+			fields.push_back(line.substr(start, tab - start));
+			start = tab + 1;
+		}
+	}
+
+	/** Parse entire field as a number. */
+	bool ParseCount(const std::string& field, double& count)
+	{
+		if(field.empty())
+			return false;
+
+		char* end;
+		count = strtod(field.c_str(), &end);
+		return *end == 0;
+	}
+}
+
+bool TripletSampleTable::IsTriplet(const std::string& filename)
+{
+	CompressedStream in(filename);
+	std::string line;
+	while(std::getline(in, line))
+	{
+		if(line.empty() || line == "\r" || line[0] == '#')
+			continue;
+
+		return IsTripletLine(line);
+	}
+
+	return false;
+}
+
+bool TripletSampleTable::IsTripletLine(const std::string& line)
+{
+	// header line of a tab-delimited sample table must start with a tab
+	std::vector<std::string> fields;
+	SplitFields(line, fields);
+	return !line.empty() && line[0] != '\t' && fields.size() == 3;
+}
+
+bool TripletSampleTable::Open(const std::string& filename)
+{
+	CompressedStream in(filename);
+	if(!in.is_open())
+	{
+		std::cerr << "Unable to open sample file: " << filename << std::endl;
+		return false;
+	}
+
+	return Read(in, filename);
+}
+
+bool TripletSampleTable::Read(std::istream& in, const std::string& name)
+{
+	NameMap sampleIds;
+	NameMap taxonIds;
+
+	std::string line;
+	std::vector<std::string> fields;
+	uint lineNum = 0;
+	bool bFirstLine = true;
+	while(std::getline(in, line))
+	{
+		++lineNum;
+		if(line.empty() || line == "\r" || line[0] == '#')
+			continue;
+
+		SplitFields(line, fields);
+
+		double count;
+		if(fields.size() != 3 || !ParseCount(fields[2], count))
+		{
+			// first line may be a header
+			if(bFirstLine && fields.size() == 3)
+			{
+				bFirstLine = false;
+				continue;
+			}
+
+			std::cerr << "Expected <sample><tab><taxon><tab><count> on line " << lineNum << " of sample file: " << name << std::endl;
+			return false;
+		}
+		bFirstLine = false;
+
+		uint sampleId = GetId(sampleIds, m_sampleNames, fields[0]);
+		uint taxonId = GetId(taxonIds, m_taxa, fields[1]);
+		AddCount(sampleId, taxonId, count);
+	}
+
+	return Finalize();
+}
+
+uint TripletSampleTable::GetId(NameMap& nameMap, std::vector<std::string>& names, const std::string& name)
+{
+	std::pair<NameMap::iterator, bool> result = nameMap.insert(std::make_pair(name, (uint)names.size()));
+	if(result.second)
+		names.push_back(name);
+
+	return result.first->second;
+}
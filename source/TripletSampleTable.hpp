@@ -0,0 +1,64 @@
+//=======================================================================
+// Author: Donovan Parks
+//
+// Copyright 2011 Donovan Parks
+//
+// This file is part of ExpressBetaDiversity.
+//
+// ExpressBetaDiversity is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// ExpressBetaDiversity is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ExpressBetaDiversity. If not, see
+// <http://www.gnu.org/licenses/>.
+//=======================================================================
+
+#ifndef _TRIPLET_SAMPLE_TABLE_
+#define _TRIPLET_SAMPLE_TABLE_
+
+#include "Precompiled.hpp"
+
+#include "SparseSampleTable.hpp"
+
+/**
+ * @brief Sample table given as tab-delimited (sample, taxon, count) lines in any order.
+ *
+ * The file is read in a single streaming pass. Sample and taxon names are resolved with 
+ * hash tables and numbered in the order they are first seen. An optional header line is 
+ * recognized by a non-numeric count, and lines starting with '#' are ignored.
+ */
+class TripletSampleTable : public SparseSampleTable
+{
+public:
+	/** Constructor. */
+	TripletSampleTable() {}
+
+	/** Destructor. */
+	~TripletSampleTable() {}
+
+	/** Check if a file appears to contain (sample, taxon, count) lines. */
+	static bool IsTriplet(const std::string& filename);
+
+	/** Check if the first line of a file, other than blank lines and comments, is a (sample, taxon, count) line. */
+	static bool IsTripletLine(const std::string& line);
+
+	bool Open(const std::string& filename);
+
+	/** Read (sample, taxon, count) lines from a stream. */
+	bool Read(std::istream& in, const std::string& name);
+
+private:
+	typedef std::tr1::unordered_map<std::string, uint> NameMap;
+
+	/** Get id of name, adding it if it has not been seen before. */
+	uint GetId(NameMap& nameMap, std::vector<std::string>& names, const std::string& name);
+};
+
+#endif
@@ -26,8 +26,33 @@
 
 #include "SplitSystem.hpp"
 #include "DiversityCalculator.hpp"
+#include "StreamSampleTable.hpp"
+#include "BinarySampleTable.hpp"
+#include "TextParser.hpp"
+#include "TextMatrixWriter.hpp"
+#include "NpyMatrixWriter.hpp"
+#include "CompressedStream.hpp"
+#include "MatrixStore.hpp"
+#include "Quantizer.hpp"
+#include "Checkpoint.hpp"
+#include "TextSampleTable.hpp"
+#include "Utils.hpp"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef WIN32
+	#include <sys/utime.h>
+#else
+	#include <utime.h>
+#endif
 
 std::string gTempDissFile = "../unit-tests/unit-test.tmp.diss";
+std::string gTempSampleFile = "../unit-tests/unit-test.tmp.ndb";
+std::string gTempNpyFile = "../unit-tests/unit-test.tmp.npy";
+std::string gTempStoreFile = "../unit-tests/unit-test.tmp.store.npy";
+std::string gTempTableFile = "../unit-tests/unit-test.tmp.otu";
+std::string gTempEnvFile = "../unit-tests/unit-test.tmp.env";
 
 bool UnitTests::Execute()
 {
@@ -143,6 +168,214 @@ bool UnitTests::Execute()
 	}
 	std::cout << "passed." << std::endl;
 
+	std::cout << "  Testing calculators sharing a split system... ";
+	if(!SharedSplitSystem())
+	{
+		std::cout << "failed." << std::endl;
+		return false;
+	}
+	std::cout << "passed." << std::endl;
+
+	std::cout << "  Testing small blocks of samples... ";
+	if(!SmallBlocks())
+	{
+		std::cout << "failed." << std::endl;
+		return false;
+	}
+	std::cout << "passed." << std::endl;
+
+	std::cout << "  Simple tree (explicitly rooted tree, BIOM sample file, qualitative measures)... ";
+	if(!SimpleTreeQual("", "../unit-tests/SimpleTree_ExplicitlyRooted.tre", "../unit-tests/SimpleTree_ExplicitlyRooted.biom"))
+	{
+		std::cout << "failed." << std::endl;
+		return false;
+	}
+	std::cout << "passed." << std::endl;
+
+	std::cout << "  Simple tree (explicitly rooted tree, BIOM sample file, quantitative measures)... ";
+	if(!SimpleTreeQuan("", "../unit-tests/SimpleTree_ExplicitlyRooted.tre", "../unit-tests/SimpleTree_ExplicitlyRooted.biom"))
+	{
+		std::cout << "failed." << std::endl;
+		return false;
+	}
+	std::cout << "passed." << std::endl;
+
+	std::cout << "  Simple tree (explicitly rooted tree, triplet sample file, qualitative measures)... ";
+	if(!SimpleTreeQual("", "../unit-tests/SimpleTree_ExplicitlyRooted.tre", "../unit-tests/SimpleTree_ExplicitlyRooted.tsv"))
+	{
+		std::cout << "failed." << std::endl;
+		return false;
+	}
+	std::cout << "passed." << std::endl;
+
+	std::cout << "  Simple tree (explicitly rooted tree, triplet sample file, quantitative measures)... ";
+	if(!SimpleTreeQuan("", "../unit-tests/SimpleTree_ExplicitlyRooted.tre", "../unit-tests/SimpleTree_ExplicitlyRooted.tsv"))
+	{
+		std::cout << "failed." << std::endl;
+		return false;
+	}
+	std::cout << "passed." << std::endl;
+
+	std::cout << "  Simple tree (explicitly rooted tree, taxa-as-rows sample file, qualitative measures)... ";
+	if(!SimpleTreeQual("", "../unit-tests/SimpleTree_ExplicitlyRooted.tre", "../unit-tests/SimpleTree_ExplicitlyRooted.otu"))
+	{
+		std::cout << "failed." << std::endl;
+		return false;
+	}
+	std::cout << "passed." << std::endl;
+
+	std::cout << "  Simple tree (explicitly rooted tree, taxa-as-rows sample file, quantitative measures)... ";
+	if(!SimpleTreeQuan("", "../unit-tests/SimpleTree_ExplicitlyRooted.tre", "../unit-tests/SimpleTree_ExplicitlyRooted.otu"))
+	{
+		std::cout << "failed." << std::endl;
+		return false;
+	}
+	std::cout << "passed." << std::endl;
+
+	std::cout << "  Simple tree (rooted split system, gzip compressed files, qualitative measures)... ";
+	if(!SimpleTreeQual("../unit-tests/SimpleTree_Rooted.nex.gz", "", "../unit-tests/SimpleTree_Rooted.env.gz"))
+	{
+		std::cout << "failed." << std::endl;
+		return false;
+	}
+	std::cout << "passed." << std::endl;
+
+	std::cout << "  Simple tree (explicitly rooted tree, gzip compressed files, quantitative measures)... ";
+	if(!SimpleTreeQuan("", "../unit-tests/SimpleTree_ExplicitlyRooted.tre.gz", "../unit-tests/SimpleTree_ExplicitlyRooted.env.gz"))
+	{
+		std::cout << "failed." << std::endl;
+		return false;
+	}
+	std::cout << "passed." << std::endl;
+
+	std::cout << "  Testing parsing of counts... ";
+	if(!ParseCountsTest())
+	{
+		std::cout << "failed." << std::endl;
+		return false;
+	}
+	std::cout << "passed." << std::endl;
+
+	std::cout << "  Testing formatting of dissimilarity values... ";
+	if(!FormatValuesTest())
+	{
+		std::cout << "failed." << std::endl;
+		return false;
+	}
+	std::cout << "passed." << std::endl;
+
+	std::cout << "  Testing npy dissimilarity matrix file... ";
+	if(!NpyMatrixFile())
+	{
+		std::cout << "failed." << std::endl;
+		return false;
+	}
+	std::cout << "passed." << std::endl;
+
+	std::cout << "  Testing square and pairs dissimilarity matrix layouts... ";
+	if(!MatrixLayouts())
+	{
+		std::cout << "failed." << std::endl;
+		return false;
+	}
+	std::cout << "passed." << std::endl;
+
+	std::cout << "  Testing rows written in strips to fit output memory... ";
+	if(!OutputStrips())
+	{
+		std::cout << "failed." << std::endl;
+		return false;
+	}
+	std::cout << "passed." << std::endl;
+
+	std::cout << "  Testing rows written in parallel at precomputed offsets... ";
+	if(!PositionalOutput())
+	{
+		std::cout << "failed." << std::endl;
+		return false;
+	}
+	std::cout << "passed." << std::endl;
+
+	std::cout << "  Testing compressed and quantized dissimilarity matrices... ";
+	if(!CompressedOutput())
+	{
+		std::cout << "failed." << std::endl;
+		return false;
+	}
+	std::cout << "passed." << std::endl;
+
+	std::cout << "  Testing sparse matrix of pairs within a threshold... ";
+	if(!SparseOutput())
+	{
+		std::cout << "failed." << std::endl;
+		return false;
+	}
+	std::cout << "passed." << std::endl;
+
+	std::cout << "  Testing nearest neighbors of each sample... ";
+	if(!NearestNeighbors())
+	{
+		std::cout << "failed." << std::endl;
+		return false;
+	}
+	std::cout << "passed." << std::endl;
+
+	std::cout << "  Testing resuming dissimilarity matrices from a checkpoint... ";
+	if(!ResumedMatrix())
+	{
+		std::cout << "failed." << std::endl;
+		return false;
+	}
+	std::cout << "passed." << std::endl;
+
+	std::cout << "  Testing appending samples to a matrix store... ";
+	if(!MatrixStoreAppend())
+	{
+		std::cout << "failed." << std::endl;
+		return false;
+	}
+	std::cout << "passed." << std::endl;
+
+	std::cout << "  Testing quantized values... ";
+	if(!QuantizedValues())
+	{
+		std::cout << "failed." << std::endl;
+		return false;
+	}
+	std::cout << "passed." << std::endl;
+
+	std::cout << "  Testing binary sample file... ";
+	if(!BinarySampleFile())
+	{
+		std::cout << "failed." << std::endl;
+		return false;
+	}
+	std::cout << "passed." << std::endl;
+
+	std::cout << "  Testing sample file read in a single pass from a stream... ";
+	if(!StreamedSampleFile())
+	{
+		std::cout << "failed." << std::endl;
+		return false;
+	}
+	std::cout << "passed." << std::endl;
+
+	std::cout << "  Testing sample file spilled to disk while reading... ";
+	if(!SpilledSampleFile())
+	{
+		std::cout << "failed." << std::endl;
+		return false;
+	}
+	std::cout << "passed." << std::endl;
+
+	std::cout << "  Testing saved index of a sample file... ";
+	if(!SampleIndexReuse())
+	{
+		std::cout << "failed." << std::endl;
+		return false;
+	}
+	std::cout << "passed." << std::endl;
+
 	return true;
 }
 
@@ -780,38 +1013,1069 @@ bool UnitTests::SharedSeqs()
 	return true;
 }
 
-bool UnitTests::ReadDissMatrix(const std::string& dissMatrixFile, std::vector< std::vector<double> >& dissMatrix)
+bool UnitTests::SharedSplitSystem()
 {
-	dissMatrix.clear();
+	std::vector< std::vector<double> > dissMatrix;
 
-	// open dissimilarity file
-	std::ifstream dissIn(dissMatrixFile.c_str());
-	if(!dissIn.is_open())
+	SplitSystem splitSystem;
+	if(!splitSystem.LoadData("", "../unit-tests/Multifurcating.tre", "../unit-tests/Multifurcating.env"))
+		return false;
+
+	// create both calculators before either is used so any shared state would be clobbered
+	DiversityCalculator uSoergel(splitSystem, "Soergel", false);
+	DiversityCalculator BC(splitSystem, "Bray-Curtis", true);
+	if(!uSoergel.IsGood() || !BC.IsGood())
+		return false;
+
+	// unweighted Soergel
+	uSoergel.Dissimilarity(gTempDissFile);
+	ReadDissMatrix(gTempDissFile, dissMatrix);
+
+	if(!Compare(dissMatrix[1][0], 0.855070))
+		return false;
+
+	// weighted Bray-Curtis
+	BC.Dissimilarity(gTempDissFile);
+	ReadDissMatrix(gTempDissFile, dissMatrix);
+
+	if(!Compare(dissMatrix[1][0], 0.75457500))
+		return false;
+
+	return true;
+}
+
+bool UnitTests::SmallBlocks()
+{
+	std::vector< std::vector<double> > dissMatrix;
+
+	SplitSystem splitSystem;
+	if(!splitSystem.LoadData("", "../unit-tests/SimpleTree_ExplicitlyRooted.tre", "../unit-tests/SimpleTree_ExplicitlyRooted.env"))
+		return false;
+
+	// weighted Kulczynski (requires per-sample statistics)
+	DiversityCalculator Kulczynski(splitSystem, "Kulczynski", true, false, 2);
+	if(!Kulczynski.IsGood())
+		return false;
+
+	Kulczynski.Dissimilarity(gTempDissFile);
+	ReadDissMatrix(gTempDissFile, dissMatrix);
+
+	if(!Compare(dissMatrix[1][0], 1))
+		return false;
+	if(!Compare(dissMatrix[2][0], 1))
+		return false;
+	if(!Compare(dissMatrix[2][1], 0.5))
+		return false;
+
+	// weighted Gower (requires per-column statistics)
+	DiversityCalculator Gower(splitSystem, "Gower", true, false, 2);
+	if(!Gower.IsGood())
+		return false;
+
+	Gower.Dissimilarity(gTempDissFile);
+	ReadDissMatrix(gTempDissFile, dissMatrix);
+
+	if(!Compare(dissMatrix[1][0], 3))
+		return false;
+	if(!Compare(dissMatrix[2][0], 3))
+		return false;
+	if(!Compare(dissMatrix[2][1], 2))
+		return false;
+
+	return true;
+}
+
+bool UnitTests::ParseCountsTest()
+{
+	// numbers must be correctly rounded, as given by strtod
+	const char* numbers[] = { "0", "-0", "42", "0.1", "3.14159265358979323846", "1e-5", "2.5E+3", "9007199254740993", 
+														"123456789012345678901234567890", "0.000000000000000000000000001234", "1.7976931348623157e308", 
+														"2.2250738585072014e-308", "4.9e-324", "  7.25" };
+	for(uint i = 0; i < sizeof(numbers)/sizeof(numbers[0]); ++i)
 	{
-		std::cerr << "Unable to open dissimilarity matrix file: " << dissMatrixFile << std::endl;
+		const char* number = numbers[i];
+		if(ParseDouble(number, number + strlen(number)) != strtod(number, NULL))
+			return false;
+	}
+
+	// fields span several 64 byte blocks, with missing and additional fields
+	std::string line;
+	std::vector<double> expected;
+	for(uint i = 0; i < 100; ++i)
+	{
+		line += (i % 3 == 0) ? "12.5" : "0";
+		line += '\t';
+		expected.push_back((i % 3 == 0) ? 12.5 : 0);
+	}
+	line += "\r";
+
+	std::vector<double> counts(expected.size() + 2, -1);
+	uint numFields = ParseCounts(line.c_str(), line.c_str() + line.size(), &counts[0], counts.size());
+	if(numFields != expected.size() + 1 || counts[expected.size()] != 0 || counts[expected.size()+1] != 0)
+		return false;
+
+	if(!std::equal(expected.begin(), expected.end(), counts.begin()))
+		return false;
+
+	numFields = ParseCounts(line.c_str(), line.c_str() + line.size(), &counts[0], 10);
+	if(numFields != 11)
 		return false;
+
+	// only kept fields are set, in reverse order, including a kept field missing from the line
+	uint numColumns = expected.size() + 2;
+	uint numKept = (numColumns + 1) / 2;
+	std::vector<uint> columnToIndex(numColumns, 0);
+	std::vector<uint64> keptColumns((numColumns + 63) / 64, 0);
+	for(uint column = 0; column < numColumns; column += 2)
+	{
+		columnToIndex[column] = numKept - 1 - column/2;
+		keptColumns[column / 64] |= uint64(1) << (column % 64);
 	}
 
-	uint size;
-	dissIn >> size;
+	std::vector<double> keptCounts(numKept, -1);
+	numFields = ParseCounts(line.c_str(), line.c_str() + line.size(), &columnToIndex[0], &keptColumns[0], &keptCounts[0], numColumns);
+	if(numFields != expected.size() + 1)
+		return false;
 
-	for(uint i = 0; i < size; ++i)
+	for(uint column = 0; column < numColumns; column += 2)
 	{
-		std::string name;
-		dissIn >> name;
+		double value = (column < expected.size()) ? expected[column] : 0;
+		if(keptCounts[columnToIndex[column]] != value)
+			return false;
+	}
 
-		std::vector<double> row;
-		for(uint j = 0; j < i; ++j)
+	return true;
+}
+
+bool UnitTests::FormatValuesTest()
+{
+	// fixed precisions must match printf, including rounding of ties and switching to scientific notation
+	const double values[] = { 0, -0.0, 1, 0.5, 0.125, 2.5, 0.1, 1.0/3, 2.0/3, -0.75, 123456.5, 999999.5, 
+														1e-5, 0.0001, 1.5e-300, 6.02214076e23, 9.999999999999999e22, 4.9e-324 };
+	const uint precisions[] = { 1, 3, 6, 10, 15, 17 };
+	char buffer[TextMatrixWriter::MAX_VALUE_LEN + 1];
+	char expected[TextMatrixWriter::MAX_VALUE_LEN + 1];
+	for(uint i = 0; i < sizeof(values)/sizeof(values[0]); ++i)
+	{
+		for(uint j = 0; j < sizeof(precisions)/sizeof(precisions[0]); ++j)
 		{
-			double v;
-			dissIn >> v;
-			row.push_back(v);
+			uint len = TextMatrixWriter::FormatDouble(values[i], precisions[j], buffer);
+			buffer[len] = '\0';
+
+			char format[8];
+			sprintf(format, "%%.%ug", precisions[j]);
+			sprintf(expected, format, values[i]);
+			if(strcmp(buffer, expected) != 0)
+				return false;
 		}
 
-		dissMatrix.push_back(row);
+		// shortest representation must read back exactly
+		uint len = TextMatrixWriter::FormatDouble(values[i], 0, buffer);
+		if(ParseDouble(buffer, buffer + len) != values[i])
+			return false;
 	}
 
-	return true;
+	// undefined and infinite values are written as printf() writes them
+	const double special[] = { std::numeric_limits<double>::quiet_NaN(), std::numeric_limits<double>::infinity(), 
+														-std::numeric_limits<double>::infinity() };
+	for(uint i = 0; i < sizeof(special)/sizeof(special[0]); ++i)
+	{
+		for(uint j = 0; j < sizeof(precisions)/sizeof(precisions[0]); ++j)
+		{
+			uint len = TextMatrixWriter::FormatDouble(special[i], precisions[j], buffer);
+			buffer[len] = '\0';
+
+			char format[8];
+			sprintf(format, "%%.%ug", precisions[j]);
+			sprintf(expected, format, special[i]);
+			if(strcmp(buffer, expected) != 0)
+				return false;
+		}
+	}
+
+	uint len = TextMatrixWriter::FormatDouble(0.1, 0, buffer);
+	return std::string(buffer, len) == "0.1";
+}
+
+bool UnitTests::NpyMatrixFile()
+{
+	SplitSystem splitSystem;
+	if(!splitSystem.LoadData("", "../unit-tests/SimpleTree_ExplicitlyRooted.tre", "../unit-tests/SimpleTree_ExplicitlyRooted.env"))
+		return false;
+
+	DiversityCalculator BC(splitSystem, "Bray-Curtis", true);
+	if(!BC.IsGood())
+		return false;
+
+	// text matrix with exact values to compare against
+	MatrixFormat textFormat;
+	textFormat.precision = 0;
+	if(!BC.Dissimilarity(gTempDissFile, false, 60, textFormat))
+		return false;
+
+	std::vector< std::vector<double> > dissMatrix;
+	ReadDissMatrix(gTempDissFile, dissMatrix);
+
+	MatrixFormat npyFormat;
+	npyFormat.format = "npy";
+	npyFormat.valueType = "float64";
+	if(!BC.Dissimilarity(gTempNpyFile, false, 60, npyFormat))
+		return false;
+
+	std::ifstream npyIn(gTempNpyFile.c_str(), std::ios::binary);
+	char preamble[10];
+	npyIn.read(preamble, sizeof(preamble));
+	if(!npyIn.good() || std::string(preamble, 6) != "\x93NUMPY")
+		return false;
+
+	// values start on a 64 byte boundary
+	uint headerLen = (unsigned char)preamble[8] | ((unsigned char)preamble[9] << 8);
+	if((sizeof(preamble) + headerLen) % 64 != 0)
+		return false;
+
+	npyIn.seekg(sizeof(preamble) + headerLen);
+	for(uint i = 0; i < dissMatrix.size(); ++i)
+	{
+		for(uint j = 0; j < i; ++j)
+		{
+			double value;
+			npyIn.read((char*)&value, sizeof(value));
+			if(!npyIn.good() || value != dissMatrix[i][j])
+				return false;
+		}
+	}
+
+	// no values after the condensed triangle
+	npyIn.peek();
+	if(!npyIn.eof())
+		return false;
+
+	std::ifstream metadataIn(NpyMatrixWriter::GetMetadataFilename(gTempNpyFile).c_str());
+	return metadataIn.is_open();
+}
+
+bool UnitTests::MatrixLayouts()
+{
+	SplitSystem splitSystem;
+	if(!splitSystem.LoadData("", "../unit-tests/SimpleTree_ExplicitlyRooted.tre", "../unit-tests/SimpleTree_ExplicitlyRooted.env"))
+		return false;
+
+	// small blocks so the matrix is provided over several calls
+	DiversityCalculator BC(splitSystem, "Bray-Curtis", true, false, 2);
+	if(!BC.IsGood())
+		return false;
+
+	MatrixFormat matrixFormat;
+	matrixFormat.precision = 0;
+	if(!BC.Dissimilarity(gTempDissFile, false, 60, matrixFormat))
+		return false;
+
+	std::vector< std::vector<double> > dissMatrix;
+	ReadDissMatrix(gTempDissFile, dissMatrix);
+	uint numSamples = dissMatrix.size();
+
+	// square matrix is symmetric with a zero diagonal
+	matrixFormat.layout = "square";
+	if(!BC.Dissimilarity(gTempDissFile, false, 60, matrixFormat))
+		return false;
+
+	std::ifstream squareIn(gTempDissFile.c_str());
+	uint size;
+	squareIn >> size;
+	if(size != numSamples)
+		return false;
+
+	for(uint i = 0; i < numSamples; ++i)
+	{
+		std::string name;
+		squareIn >> name;
+		if(name != splitSystem.GetSampleName(i))
+			return false;
+
+		for(uint j = 0; j < numSamples; ++j)
+		{
+			double value;
+			squareIn >> value;
+
+			double expected = 0;
+			if(i != j)
+				expected = dissMatrix[std::max(i, j)][std::min(i, j)];
+
+			if(!squareIn.good() || value != expected)
+				return false;
+		}
+	}
+	squareIn.close();
+
+	// one line for each pair of samples
+	matrixFormat.layout = "pairs";
+	if(!BC.Dissimilarity(gTempDissFile, false, 60, matrixFormat))
+		return false;
+
+	std::ifstream pairsIn(gTempDissFile.c_str());
+	for(uint i = 0; i < numSamples; ++i)
+	{
+		for(uint j = 0; j < i; ++j)
+		{
+			std::string nameA, nameB;
+			double value;
+			pairsIn >> nameA >> nameB >> value;
+			if(!pairsIn.good() || nameA != splitSystem.GetSampleName(i) || nameB != splitSystem.GetSampleName(j) || value != dissMatrix[i][j])
+				return false;
+		}
+	}
+
+	std::string extra;
+	return !(pairsIn >> extra);
+}
+
+bool UnitTests::OutputStrips()
+{
+	SplitSystem splitSystem;
+	if(!splitSystem.LoadData("", "../unit-tests/SimpleTree_ExplicitlyRooted.tre", "../unit-tests/SimpleTree_ExplicitlyRooted.env"))
+		return false;
+
+	DiversityCalculator BC(splitSystem, "Bray-Curtis", true, false, 4);
+	if(!BC.IsGood())
+		return false;
+
+	MatrixFormat matrixFormat;
+	matrixFormat.precision = 0;
+	if(!BC.Dissimilarity(gTempDissFile, false, 60, matrixFormat))
+		return false;
+
+	std::vector< std::vector<double> > dissMatrix;
+	ReadDissMatrix(gTempDissFile, dissMatrix);
+
+	// no output memory, so each row is its own strip
+	if(!BC.Dissimilarity(gTempDissFile, false, 60, matrixFormat, 0))
+		return false;
+
+	std::vector< std::vector<double> > stripDissMatrix;
+	ReadDissMatrix(gTempDissFile, stripDissMatrix);
+
+	return stripDissMatrix == dissMatrix;
+}
+
+bool UnitTests::PositionalOutput()
+{
+	// fixed-width values match printf()
+	const double values[] = { 0, 1, 0.5, 0.123456789, 1234.5678, 1e-310, 9.9999996 };
+	for(uint i = 0; i < sizeof(values)/sizeof(values[0]); ++i)
+	{
+		char buffer[TextMatrixWriter::MAX_VALUE_LEN];
+		uint len = TextMatrixWriter::FormatFixed(values[i], 6, buffer);
+
+		char expected[TextMatrixWriter::MAX_VALUE_LEN];
+		sprintf(expected, "%*.5e", TextMatrixWriter::GetFixedWidth(6), values[i]);
+		if(std::string(buffer, len) != expected)
+			return false;
+	}
+
+	SplitSystem splitSystem;
+	if(!splitSystem.LoadData("", "../unit-tests/SimpleTree_ExplicitlyRooted.tre", "../unit-tests/SimpleTree_ExplicitlyRooted.env"))
+		return false;
+
+	// small blocks so rows are written in several segments
+	DiversityCalculator BC(splitSystem, "Bray-Curtis", true, false, 4);
+	if(!BC.IsGood())
+		return false;
+
+	MatrixFormat matrixFormat;
+	matrixFormat.precision = 0;
+	if(!BC.Dissimilarity(gTempDissFile, false, 60, matrixFormat))
+		return false;
+
+	std::vector< std::vector<double> > dissMatrix;
+	ReadDissMatrix(gTempDissFile, dissMatrix);
+
+	matrixFormat.bFixedWidth = true;
+	MatrixWriter* writer = MatrixWriter::Create(matrixFormat);
+	bool bPositional = writer->IsPositional();
+	delete writer;
+	if(!bPositional)
+		return false;
+
+	if(!BC.Dissimilarity(gTempDissFile, false, 60, matrixFormat))
+		return false;
+
+	std::vector< std::vector<double> > fixedDissMatrix;
+	ReadDissMatrix(gTempDissFile, fixedDissMatrix);
+	if(fixedDissMatrix != dissMatrix)
+		return false;
+
+	// every line of the file has the expected length
+	std::ifstream fixedIn(gTempDissFile.c_str());
+	std::string line;
+	std::getline(fixedIn, line);
+	for(uint i = 0; i < dissMatrix.size(); ++i)
+	{
+		std::getline(fixedIn, line);
+		if(line.size() != splitSystem.GetSampleName(i).size() + i*(TextMatrixWriter::GetFixedWidth(0) + 1))
+			return false;
+	}
+
+	return !std::getline(fixedIn, line);
+}
+
+bool UnitTests::CompressedOutput()
+{
+	SplitSystem splitSystem;
+	if(!splitSystem.LoadData("", "../unit-tests/SimpleTree_ExplicitlyRooted.tre", "../unit-tests/SimpleTree_ExplicitlyRooted.env"))
+		return false;
+
+	DiversityCalculator BC(splitSystem, "Bray-Curtis", true);
+	if(!BC.IsGood())
+		return false;
+
+	MatrixFormat matrixFormat;
+	if(!BC.Dissimilarity(gTempDissFile, false, 60, matrixFormat))
+		return false;
+
+	std::string text;
+	std::ifstream textIn(gTempDissFile.c_str(), std::ios::binary);
+	std::getline(textIn, text, '\0');
+
+	// gzip compressed text decompresses to the uncompressed text
+	matrixFormat.compression = "gzip";
+	if(!BC.Dissimilarity(gTempDissFile, false, 60, matrixFormat))
+		return false;
+
+	if(DecompressBuf::GetCompression(gTempDissFile) != DecompressBuf::GZIP_COMPRESSION)
+		return false;
+
+	std::string decompressedText;
+	CompressedStream compressedIn(gTempDissFile);
+	std::getline(compressedIn, decompressedText, '\0');
+	compressedIn.close();
+	if(decompressedText != text)
+		return false;
+
+	// quantized values are within half a step of the exact values
+	MatrixFormat exactFormat;
+	exactFormat.precision = 0;
+	if(!BC.Dissimilarity(gTempDissFile, false, 60, exactFormat))
+		return false;
+
+	std::vector< std::vector<double> > dissMatrix;
+	ReadDissMatrix(gTempDissFile, dissMatrix);
+
+	MatrixFormat npyFormat;
+	npyFormat.format = "npy";
+	npyFormat.valueType = "uint16";
+	if(!BC.Dissimilarity(gTempNpyFile, false, 60, npyFormat))
+		return false;
+
+	std::ifstream npyIn(gTempNpyFile.c_str(), std::ios::binary);
+	char preamble[10];
+	npyIn.read(preamble, sizeof(preamble));
+	uint headerLen = (unsigned char)preamble[8] | ((unsigned char)preamble[9] << 8);
+	npyIn.seekg(sizeof(preamble) + headerLen);
+	for(uint i = 0; i < dissMatrix.size(); ++i)
+	{
+		for(uint j = 0; j < i; ++j)
+		{
+			unsigned short value;
+			npyIn.read((char*)&value, sizeof(value));
+			if(!npyIn.good() || fabs(value / 65535.0 - dissMatrix[i][j]) > 0.5 / 65535.0)
+				return false;
+		}
+	}
+
+	npyIn.peek();
+	return npyIn.eof();
+}
+
+bool UnitTests::SparseOutput()
+{
+	SplitSystem splitSystem;
+	if(!splitSystem.LoadData("", "../unit-tests/SimpleTree_ExplicitlyRooted.tre", "../unit-tests/SimpleTree_ExplicitlyRooted.env"))
+		return false;
+
+	// small blocks so pairs are gathered over several column blocks
+	DiversityCalculator BC(splitSystem, "Bray-Curtis", true, false, 4);
+	if(!BC.IsGood())
+		return false;
+
+	MatrixFormat matrixFormat;
+	matrixFormat.precision = 0;
+	if(!BC.Dissimilarity(gTempDissFile, false, 60, matrixFormat))
+		return false;
+
+	std::vector< std::vector<double> > dissMatrix;
+	ReadDissMatrix(gTempDissFile, dissMatrix);
+	if(dissMatrix.size() < 3)
+		return false;
+
+	// threshold is one of the dissimilarities, which must be kept
+	matrixFormat.bSparse = true;
+	matrixFormat.maxDissimilarity = dissMatrix[2][1];
+	if(!BC.Dissimilarity(gTempDissFile, false, 60, matrixFormat))
+		return false;
+
+	std::ifstream sparseIn(gTempDissFile.c_str());
+	for(uint i = 0; i < dissMatrix.size(); ++i)
+	{
+		for(uint j = 0; j < i; ++j)
+		{
+			if(dissMatrix[i][j] > matrixFormat.maxDissimilarity)
+				continue;
+
+			std::string name1, name2;
+			double value;
+			sparseIn >> name1 >> name2 >> value;
+			if(!sparseIn.good() || name1 != splitSystem.GetSampleName(i) || name2 != splitSystem.GetSampleName(j) || value != dissMatrix[i][j])
+				return false;
+		}
+	}
+
+	std::string extra;
+	return !(sparseIn >> extra);
+}
+
+bool UnitTests::NearestNeighbors()
+{
+	SplitSystem splitSystem;
+	if(!splitSystem.LoadData("", "../unit-tests/SimpleTree_ExplicitlyRooted.tre", "../unit-tests/SimpleTree_ExplicitlyRooted.env"))
+		return false;
+
+	// small blocks so neighbors are found in both earlier and later blocks
+	DiversityCalculator BC(splitSystem, "Bray-Curtis", true, false, 4);
+	if(!BC.IsGood())
+		return false;
+
+	MatrixFormat matrixFormat;
+	matrixFormat.precision = 0;
+	if(!BC.Dissimilarity(gTempDissFile, false, 60, matrixFormat))
+		return false;
+
+	std::vector< std::vector<double> > dissMatrix;
+	ReadDissMatrix(gTempDissFile, dissMatrix);
+
+	matrixFormat.topK = 2;
+	if(!BC.NearestNeighbors(gTempDissFile, matrixFormat))
+		return false;
+
+	std::ifstream neighborsIn(gTempDissFile.c_str());
+	for(uint i = 0; i < dissMatrix.size(); ++i)
+	{
+		// expected neighbors ordered by dissimilarity, then by index
+		std::vector< std::pair<double, uint> > expected;
+		for(uint j = 0; j < dissMatrix.size(); ++j)
+		{
+			if(j != i)
+				expected.push_back(std::make_pair(j < i ? dissMatrix[i][j] : dissMatrix[j][i], j));
+		}
+		std::sort(expected.begin(), expected.end());
+		expected.resize(std::min<uint>(expected.size(), matrixFormat.topK));
+
+		std::string line;
+		std::getline(neighborsIn, line);
+		std::stringstream ss(line);
+		std::string name;
+		ss >> name;
+		if(name != splitSystem.GetSampleName(i))
+			return false;
+
+		for(uint n = 0; n < expected.size(); ++n)
+		{
+			double value;
+			ss >> name >> value;
+			if(!ss || name != splitSystem.GetSampleName(expected[n].second) || value != expected[n].first)
+				return false;
+		}
+
+		if(ss >> name)
+			return false;
+	}
+
+	return true;
+}
+
+bool UnitTests::ResumedMatrix()
+{
+	SplitSystem splitSystem;
+	if(!splitSystem.LoadData("", "../unit-tests/SimpleTree_ExplicitlyRooted.tre", "../unit-tests/SimpleTree_ExplicitlyRooted.env"))
+		return false;
+
+	// blocks of a single row, so a run can be interrupted after any row
+	const uint blockLen = 1;
+	DiversityCalculator BC(splitSystem, "Bray-Curtis", true, false, 2*blockLen);
+	if(!BC.IsGood())
+		return false;
+
+	uint64 numSamples = splitSystem.GetNumSamples();
+	uint64 numValues = numSamples*(numSamples-1)/2;
+
+	const char* formats[] = { "text", "npy", "npy" };
+	const char* layouts[] = { "condensed", "condensed", "square" };
+	for(uint f = 0; f < sizeof(formats)/sizeof(formats[0]); ++f)
+	{
+		MatrixFormat matrixFormat;
+		matrixFormat.format = formats[f];
+		matrixFormat.layout = layouts[f];
+		matrixFormat.valueType = "float64";
+
+		std::string expected;
+		if(!BC.Dissimilarity(gTempDissFile, false, 0, matrixFormat) || !ReadBytes(gTempDissFile, expected))
+			return false;
+
+		// rows are written to the matrix file, except for the square layout where the 
+		// lower triangular matrix is written to a working file of doubles
+		MatrixWriter* writer = MatrixWriter::Create(matrixFormat);
+		std::string progressFile = writer->GetProgressFilename(gTempDissFile);
+		delete writer;
+
+		std::string rows;
+		if(matrixFormat.layout == "square")
+		{
+			uint64 headerLen = expected.size() - numSamples*numSamples*sizeof(double);
+			for(uint64 i = 0; i < numSamples; ++i)
+				rows.append(expected, headerLen + i*numSamples*sizeof(double), i*sizeof(double));
+		}
+		else
+			rows = expected;
+
+		for(uint numBlocks = 0; numBlocks < numSamples; ++numBlocks)
+		{
+			// size of output once the rows of completed blocks are written
+			uint64 outputSize = 0;
+			if(matrixFormat.format == "text")
+			{
+				// header line gives the number of samples, followed by a line per row
+				for(uint lines = 0; lines < numBlocks*blockLen + 1; ++lines)
+					outputSize = rows.find('\n', outputSize) + 1;
+			}
+			else
+			{
+				// values of rows follow any header
+				uint64 headerLen = rows.size() - numValues*sizeof(double);
+				uint64 numRows = numBlocks*blockLen;
+				outputSize = headerLen + numRows*(numRows-(numRows > 0 ? 1 : 0))/2*sizeof(double);
+			}
+
+			// interrupted run wrote part of the next row after its last checkpoint
+			std::ofstream partialOut(progressFile.c_str(), std::ios::binary | std::ios::trunc);
+			partialOut.write(rows.data(), outputSize);
+			partialOut << "0.123";
+			partialOut.close();
+
+			Checkpoint checkpoint(gTempDissFile, BC.GetFingerprint(blockLen, matrixFormat));
+			if(!checkpoint.Record(numBlocks, outputSize))
+				return false;
+
+			std::string resumed;
+			if(!BC.Dissimilarity(gTempDissFile, true, 0, matrixFormat) || !ReadBytes(gTempDissFile, resumed))
+				return false;
+
+			if(resumed != expected)
+				return false;
+
+			// checkpoint is removed once the matrix is complete
+			std::ifstream checkpointIn(checkpoint.GetFilename().c_str());
+			if(checkpointIn.is_open())
+				return false;
+		}
+	}
+
+	return true;
+}
+
+bool UnitTests::MatrixStoreAppend()
+{
+	SplitSystem splitSystem;
+	if(!splitSystem.LoadData("", "../unit-tests/SimpleTree_ExplicitlyRooted.tre", "../unit-tests/SimpleTree_ExplicitlyRooted.env"))
+		return false;
+
+	DiversityCalculator BC(splitSystem, "Bray-Curtis", true);
+	if(!BC.IsGood())
+		return false;
+
+	MatrixFormat matrixFormat;
+	matrixFormat.format = "npy";
+	matrixFormat.valueType = "float64";
+	if(!BC.Dissimilarity(gTempNpyFile, false, 60, matrixFormat))
+		return false;
+
+	std::ifstream expectedIn(gTempNpyFile.c_str(), std::ios::binary);
+	std::stringstream expected;
+	expected << expectedIn.rdbuf();
+
+	// store starts with the first samples of the sample file
+	std::ifstream sampleIn("../unit-tests/SimpleTree_ExplicitlyRooted.env");
+	std::ofstream firstSamplesOut(gTempSampleFile.c_str());
+	std::string line;
+	for(uint i = 0; i < 3 && std::getline(sampleIn, line); ++i)
+		firstSamplesOut << line << std::endl;
+	firstSamplesOut.close();
+
+	remove(MatrixStore::GetIndexFilename(gTempStoreFile).c_str());
+
+	SplitSystem firstSplitSystem;
+	if(!firstSplitSystem.LoadData("", "../unit-tests/SimpleTree_ExplicitlyRooted.tre", gTempSampleFile))
+		return false;
+
+	// small blocks so new rows span blocks of stored and new samples
+	DiversityCalculator firstBC(firstSplitSystem, "Bray-Curtis", true, false, 2);
+	if(!firstBC.IsGood() || !firstBC.UpdateStore(gTempStoreFile, matrixFormat))
+		return false;
+
+	// remaining samples are appended, and an up to date store is left unchanged
+	DiversityCalculator allBC(splitSystem, "Bray-Curtis", true, false, 2);
+	if(!allBC.IsGood() || !allBC.UpdateStore(gTempStoreFile, matrixFormat) || !allBC.UpdateStore(gTempStoreFile, matrixFormat))
+		return false;
+
+	// order of taxa in the sample file does not matter
+	sampleIn.clear();
+	sampleIn.seekg(0);
+	std::ofstream reorderedOut(gTempSampleFile.c_str());
+	while(std::getline(sampleIn, line))
+	{
+		std::vector<std::string> fields;
+		std::stringstream ss(line);
+		std::string field;
+		while(std::getline(ss, field, '\t'))
+			fields.push_back(field);
+
+		reorderedOut << fields[0];
+		for(uint i = fields.size() - 1; i > 0; --i)
+			reorderedOut << '\t' << fields[i];
+		reorderedOut << std::endl;
+	}
+	reorderedOut.close();
+
+	SplitSystem reorderedSplitSystem;
+	if(!reorderedSplitSystem.LoadData("", "../unit-tests/SimpleTree_ExplicitlyRooted.tre", gTempSampleFile))
+		return false;
+
+	DiversityCalculator reorderedBC(reorderedSplitSystem, "Bray-Curtis", true, false, 2);
+	if(!reorderedBC.IsGood() || !reorderedBC.UpdateStore(gTempStoreFile, matrixFormat))
+		return false;
+
+	std::ifstream actualIn(gTempStoreFile.c_str(), std::ios::binary);
+	std::stringstream actual;
+	actual << actualIn.rdbuf();
+
+	return actual.str() == expected.str();
+}
+
+bool UnitTests::QuantizedValues()
+{
+	// values outside [0, 1] are clamped and undefined values become the largest element
+	const uint numFixed = 5;
+	double fixedValues[numFixed] = { 0.5, 0.25, 1.5, -0.25, std::numeric_limits<double>::quiet_NaN() };
+	unsigned char expectedNearest[numFixed] = { 128, 64, 255, 0, 255 };
+	unsigned char expectedDown[numFixed] = { 127, 63, 255, 0, 255 };
+	unsigned char expectedUp[numFixed] = { 128, 64, 255, 0, 255 };
+
+	char fixedData[numFixed];
+	QuantizationError error;
+	Quantizer nearest(Quantizer::UINT8, Quantizer::ROUND_NEAREST);
+	nearest.Quantize(fixedValues, numFixed, fixedData, error);
+	if(memcmp(fixedData, expectedNearest, numFixed) != 0 || error.numClamped != 2 || error.numUndefined != 1 || error.numValues != numFixed - 1)
+		return false;
+
+	if(!Compare(error.maxError, 0.5) || !Compare(nearest.Dequantize(fixedData), 128.0/255))
+		return false;
+
+	Quantizer(Quantizer::UINT8, Quantizer::ROUND_DOWN).Quantize(fixedValues, numFixed, fixedData, error);
+	if(memcmp(fixedData, expectedDown, numFixed) != 0)
+		return false;
+
+	Quantizer(Quantizer::UINT8, Quantizer::ROUND_UP).Quantize(fixedValues, numFixed, fixedData, error);
+	if(memcmp(fixedData, expectedUp, numFixed) != 0)
+		return false;
+
+	// normal, subnormal, negative, overflowing, and undefined values; ground truth determined by NumPy
+	const uint numHalf = 8;
+	double halfValues[numHalf] = { 1.0, 0.1, 65519.0, 65520.0, 3*ldexp(1.0, -26), -1.5, -0.1, std::numeric_limits<double>::quiet_NaN() };
+	unsigned short expectedHalfNearest[numHalf] = { 0x3C00, 0x2E66, 0x7BFF, 0x7C00, 0x0001, 0xBE00, 0xAE66, 0x7E00 };
+	unsigned short expectedHalfDown[numHalf] = { 0x3C00, 0x2E66, 0x7BFF, 0x7BFF, 0x0000, 0xBE00, 0xAE67, 0x7E00 };
+	unsigned short expectedHalfUp[numHalf] = { 0x3C00, 0x2E67, 0x7C00, 0x7C00, 0x0001, 0xBE00, 0xAE66, 0x7E00 };
+	unsigned short* expectedHalf[3] = { expectedHalfNearest, expectedHalfDown, expectedHalfUp };
+	Quantizer::ROUNDING roundings[3] = { Quantizer::ROUND_NEAREST, Quantizer::ROUND_DOWN, Quantizer::ROUND_UP };
+
+	for(uint r = 0; r < 3; ++r)
+	{
+		char halfData[2*numHalf];
+		Quantizer half(Quantizer::FLOAT16, roundings[r]);
+		half.Quantize(halfValues, numHalf, halfData, error);
+		for(uint i = 0; i < numHalf; ++i)
+		{
+			unsigned short bits = (unsigned char)halfData[2*i] | ((unsigned char)halfData[2*i + 1] << 8);
+			if(bits != expectedHalf[r][i])
+				return false;
+		}
+
+		// overflowing and undefined values have no error
+		if(error.numValues + error.numClamped + error.numUndefined != numHalf || error.numUndefined != 1 || error.maxError > 16)
+			return false;
+	}
+
+	return Compare(Quantizer::HalfToDouble(0x2E66), 0.0999755859375);
+}
+
+bool UnitTests::BinarySampleFile()
+{
+	// convert sample file with an outgroup sample between ingroup samples
+	SampleIO sampleIO;
+	if(!sampleIO.Read("../unit-tests/SimpleTree_ExplicitlyRooted.env"))
+		return false;
+
+	if(!sampleIO.WriteBinary(gTempSampleFile))
+		return false;
+
+	if(!SimpleTreeQual("", "../unit-tests/SimpleTree_ExplicitlyRooted.tre", gTempSampleFile))
+		return false;
+
+	if(!SimpleTreeQuan("", "../unit-tests/SimpleTree_ExplicitlyRooted.tre", gTempSampleFile))
+		return false;
+
+	return true;
+}
+
+bool UnitTests::StreamedSampleFile()
+{
+	// read sample file as it would be read from stdin or a pipe
+	std::ifstream in("../unit-tests/SimpleTree_ExplicitlyRooted.env");
+	StreamSampleTable table;
+	if(!table.Read(in, "../unit-tests/SimpleTree_ExplicitlyRooted.env"))
+		return false;
+
+	if(!BinarySampleTable::Write(table, gTempSampleFile))
+		return false;
+
+	if(!SimpleTreeQual("", "../unit-tests/SimpleTree_ExplicitlyRooted.tre", gTempSampleFile))
+		return false;
+
+	if(!SimpleTreeQuan("", "../unit-tests/SimpleTree_ExplicitlyRooted.tre", gTempSampleFile))
+		return false;
+
+	return true;
+}
+
+bool UnitTests::SpilledSampleFile()
+{
+	// read taxa-as-rows sample file without any memory for pending counts so every count is spilled
+	SampleIO sampleIO;
+	if(!sampleIO.Read("../unit-tests/SimpleTree_ExplicitlyRooted.otu", true, 0))
+		return false;
+
+	if(!sampleIO.WriteBinary(gTempSampleFile))
+		return false;
+
+	if(!SimpleTreeQual("", "../unit-tests/SimpleTree_ExplicitlyRooted.tre", gTempSampleFile))
+		return false;
+
+	if(!SimpleTreeQuan("", "../unit-tests/SimpleTree_ExplicitlyRooted.tre", gTempSampleFile))
+		return false;
+
+	// every count of a larger table is spilled as its own run, so runs are merged in several passes
+	const uint numTaxa = 100;
+	const uint numSamples = 5;
+	std::ofstream tableOut(gTempTableFile.c_str());
+	tableOut << "#OTU ID";
+	for(uint j = 0; j < numSamples; ++j)
+		tableOut << "\tS" << j;
+	tableOut << std::endl;
+	for(uint i = 0; i < numTaxa; ++i)
+	{
+		tableOut << "T" << i;
+		for(uint j = 0; j < numSamples; ++j)
+			tableOut << "\t" << (i*numSamples + j) % 7 + 1;
+		tableOut << std::endl;
+	}
+	tableOut.close();
+
+	SampleIO spilledIO;
+	SampleIO packedIO;
+	if(!spilledIO.Read(gTempTableFile, true, 0) || !packedIO.Read(gTempTableFile, true))
+		return false;
+
+	if(spilledIO.GetNumSamples() != numSamples || spilledIO.GetNumIngroupSeqs() != numTaxa)
+		return false;
+
+	for(uint j = 0; j < numSamples; ++j)
+	{
+		std::vector<double> spilledCount, packedCount;
+		double spilledTotal, packedTotal;
+		if(!spilledIO.GetData(j, spilledCount, spilledTotal) || !packedIO.GetData(j, packedCount, packedTotal))
+			return false;
+
+		if(spilledCount != packedCount || spilledTotal != packedTotal)
+			return false;
+	}
+
+	return true;
+}
+
+bool UnitTests::SampleIndexReuse()
+{
+	// sample file is larger than the 64 KB at its start and at its end which are hashed
+	const uint numTaxa = 10;
+	const uint numSamples = 6000;
+	std::string zeros;
+	for(uint i = 1; i < numTaxa; ++i)
+		zeros += "\t0";
+
+	std::ofstream tableOut(gTempEnvFile.c_str(), std::ios::binary);
+	for(uint i = 0; i < numTaxa; ++i)
+		tableOut << "\tT" << i;
+	tableOut << "\n";
+	for(uint j = 0; j < numSamples; ++j)
+	{
+		if(j == 0)
+			tableOut << "First";
+		else
+			tableOut << "S" << j;
+		tableOut << "\t1" << zeros << "\n";
+	}
+	tableOut.close();
+
+	uint64 fileSize;
+	if(tableOut.fail() || !GetFileSize(gTempEnvFile, fileSize))
+		return false;
+
+	// offsets of the first count of the first and last samples
+	uint64 firstCountOffset = numTaxa*3 + 1 + std::string("First\t").size();
+	std::ostringstream lastName;
+	lastName << "S" << numSamples-1 << "\t";
+	uint64 lastCountOffset = fileSize - (lastName.str().size() + 1 + zeros.size() + 1) + lastName.str().size();
+
+	std::string indexFile = gTempEnvFile + ".idx";
+	remove(indexFile.c_str());
+
+	std::string name;
+	uint num;
+	double firstCount, lastCount;
+	if(!ReadFirstSample(gTempEnvFile, name, num, firstCount, lastCount) || name != "First" || num != numSamples)
+		return false;
+
+	// changes to the sample file: its modification time only, a count at its start or end with the modification time restored, and its size
+	for(uint change = 0; change < 4; ++change)
+	{
+		// index is saved, and is reused as long as the sample file is unchanged so a name altered in it is reported
+		std::string index;
+		if(!ReadBytes(indexFile, index) || index.find("First") == std::string::npos)
+			return false;
+
+		index.replace(index.find("First"), 5, "Index");
+		std::ofstream indexOut(indexFile.c_str(), std::ios::binary | std::ios::trunc);
+		indexOut << index;
+		indexOut.close();
+
+		if(!ReadFirstSample(gTempEnvFile, name, num, firstCount, lastCount) || name != "Index")
+			return false;
+
+		struct stat fileInfo;
+		if(stat(gTempEnvFile.c_str(), &fileInfo) != 0)
+			return false;
+
+		struct utimbuf times;
+		times.actime = fileInfo.st_atime;
+		times.modtime = fileInfo.st_mtime;
+
+		uint expectedSamples = num;
+		double expectedFirst = firstCount;
+		double expectedLast = lastCount;
+		if(change == 0)
+			times.modtime += 10;
+		else if(change == 1 || change == 2)
+		{
+			std::fstream countOut(gTempEnvFile.c_str(), std::ios::binary | std::ios::in | std::ios::out);
+			countOut.seekp((change == 1) ? firstCountOffset : lastCountOffset);
+			countOut << '5';
+			if(change == 1)
+				expectedFirst = 5;
+			else
+				expectedLast = 5;
+		}
+		else
+		{
+			std::ofstream appendOut(gTempEnvFile.c_str(), std::ios::binary | std::ios::app);
+			appendOut << "Added\t7" << zeros << "\n";
+			expectedSamples++;
+			expectedLast = 7;
+		}
+
+		if(change != 3 && utime(gTempEnvFile.c_str(), &times) != 0)
+			return false;
+
+		// index is rebuilt from the changed sample file
+		if(!ReadFirstSample(gTempEnvFile, name, num, firstCount, lastCount) || name != "First")
+			return false;
+
+		if(num != expectedSamples || firstCount != expectedFirst || lastCount != expectedLast)
+			return false;
+	}
+
+	return true;
+}
+
+bool UnitTests::ReadFirstSample(const std::string& sampleFile, std::string& name, uint& numSamples, double& firstCount, double& lastCount)
+{
+	TextSampleTable table;
+	if(!table.Open(sampleFile) || table.GetNumSamples() == 0)
+		return false;
+
+	name = table.GetSampleName(0);
+	numSamples = table.GetNumSamples();
+
+	std::vector<double> count;
+	if(!table.GetCounts(0, count) || count.empty())
+		return false;
+	firstCount = count[0];
+
+	if(!table.GetCounts(numSamples-1, count) || count.empty())
+		return false;
+	lastCount = count[0];
+
+	return true;
+}
+
+bool UnitTests::ReadDissMatrix(const std::string& dissMatrixFile, std::vector< std::vector<double> >& dissMatrix)
+{
+	dissMatrix.clear();
+
+	// open dissimilarity file
+	std::ifstream dissIn(dissMatrixFile.c_str());
+	if(!dissIn.is_open())
+	{
+		std::cerr << "Unable to open dissimilarity matrix file: " << dissMatrixFile << std::endl;
+		return false;
+	}
+
+	uint size;
+	dissIn >> size;
+
+	for(uint i = 0; i < size; ++i)
+	{
+		std::string name;
+		dissIn >> name;
+
+		std::vector<double> row;
+		for(uint j = 0; j < i; ++j)
+		{
+			double v;
+			dissIn >> v;
+			row.push_back(v);
+		}
+
+		dissMatrix.push_back(row);
+	}
+
+	return true;
+}
+
+bool UnitTests::ReadBytes(const std::string& filename, std::string& bytes)
+{
+	std::ifstream in(filename.c_str(), std::ios::binary);
+	if(!in.is_open())
+		return false;
+
+	bytes.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+
+	return !in.bad();
 }
 
 bool UnitTests::Compare(double actual, double expected)
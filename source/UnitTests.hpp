@@ -35,6 +35,8 @@ public:
 private:
 	bool ReadDissMatrix(const std::string& dissMatrixFile, std::vector< std::vector<double> >& dissMatrix);
 	bool Compare(double actual, double expected);
+	bool ReadBytes(const std::string& filename, std::string& bytes);
+	bool ReadFirstSample(const std::string& sampleFile, std::string& name, uint& numSamples, double& firstCount, double& lastCount);
 
 	/** Test several variants of a simple tree. Ground truth determined by hand.
 	 *   a) implicitly rooted tree 
@@ -52,6 +54,60 @@ private:
 
 	/** Test tree with shared sequences. Ground truth determined by Chameleon and Fast UniFrac. */
 	bool SharedSeqs();
+
+	/** Test multiple calculators with different settings sharing a single split system. */
+	bool SharedSplitSystem();
+
+	/** Test processing samples in blocks smaller than the number of samples, with an outgroup sample between ingroup samples. */
+	bool SmallBlocks();
+
+	/** Test correctly rounded parsing of numbers and parsing of tab-delimited counts. */
+	bool ParseCountsTest();
+
+	/** Test formatting of dissimilarity values with a fixed precision and with the shortest exact representation. */
+	bool FormatValuesTest();
+
+	/** Test writing a dissimilarity matrix as a .npy condensed triangle. */
+	bool NpyMatrixFile();
+
+	/** Test writing a dissimilarity matrix in the square and pairs layouts. */
+	bool MatrixLayouts();
+
+	/** Test calculating and writing the rows of a block in several strips. */
+	bool OutputStrips();
+
+	/** Test writing rows of fixed-width text in segments at precomputed offsets. */
+	bool PositionalOutput();
+
+	/** Test writing gzip compressed text and 16-bit fixed-point .npy matrices. */
+	bool CompressedOutput();
+
+	/** Test writing only pairs of samples within a dissimilarity threshold. */
+	bool SparseOutput();
+
+	/** Test finding the nearest neighbors of each sample. */
+	bool NearestNeighbors();
+
+	/** Test resuming text, npy, and square matrices from a checkpoint recorded after each number of rows. */
+	bool ResumedMatrix();
+
+	/** Test appending samples to a matrix store in several runs. */
+	bool MatrixStoreAppend();
+
+	/** Test quantizing values to uint8 and float16 with each rounding. */
+	bool QuantizedValues();
+
+	/** Test converting a sample file to a binary sample file and calculating dissimilarity from it. */
+	bool BinarySampleFile();
+
+	/** Test reading a sample file in a single pass from a stream. */
+	bool StreamedSampleFile();
+
+	/** Test reading a taxa-as-rows sample file with counts spilled to disk. */
+	bool SpilledSampleFile();
+
+	/** Test reusing the saved index of a sample file, and rebuilding it once the size, modification time, or start or end of the file change. */
+	bool SampleIndexReuse();
 };
 
 #endif
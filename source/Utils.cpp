@@ -23,83 +23,144 @@
 
 #include "Utils.hpp"
 
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef WIN32
+	#include <io.h>
+	#include <fcntl.h>
+	#include <share.h>
+	#include <process.h>
+#else
+	#include <unistd.h>
+	#include <fcntl.h>
+#endif
+
 double fast_atof(const char *p)
 {
-    int frac = 0;
-    double sign, value, scale;
-
-    // Skip leading white space, if any.
-
-    while (white_space(*p) ) {
-        p += 1;
-    }
-
-    // Get sign, if any.
-
-    sign = 1.0;
-    if (*p == '-') {
-        sign = -1.0;
-        p += 1;
-
-    } else if (*p == '+') {
-        p += 1;
-    }
-
-    // Get digits before decimal point or exponent, if any.
-
-    value = 0.0;
-    while (valid_digit(*p)) {
-        value = value * 10.0 + (*p - '0');
-        p += 1;
-    }
-
-    // Get digits after decimal point, if any.
-
-    if (*p == '.') {
-        double pow10 = 10.0;
-        p += 1;
+	return ParseDouble(p, p + strlen(p));
+}
 
-        while (valid_digit(*p)) {
-            value += (*p - '0') / pow10;
-            pow10 *= 10.0;
-            p += 1;
-        }
-    }
+uint64 HashBytes(const void* data, size_t len, uint64 hash)
+{
+	const byte* bytes = (const byte*)data;
+	for(size_t i = 0; i < len; ++i)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ULL;
+	}
 
-    // Handle exponent, if any.
+	return hash;
+}
 
-    scale = 1.0;
-    if ((*p == 'e') || (*p == 'E')) {
-        unsigned int expon;
-        p += 1;
+uint64 HashString(const std::string& str, uint64 hash)
+{
+	// include length so consecutive strings cannot run together
+	uint64 len = str.size();
+	hash = HashBytes(&len, sizeof(len), hash);
+	return HashBytes(str.c_str(), str.size(), hash);
+}
 
-        // Get sign of exponent, if any.
+bool HashFileInfo(const std::string& filename, uint64& hash)
+{
+	struct stat fileInfo;
+	if(stat(filename.c_str(), &fileInfo) != 0)
+		return false;
 
-        frac = 0;
-        if (*p == '-') {
-            frac = 1;
-            p += 1;
+	uint64 size = fileInfo.st_size;
+	uint64 modTime = fileInfo.st_mtime;
+	hash = HashBytes(&size, sizeof(size), hash);
+	hash = HashBytes(&modTime, sizeof(modTime), hash);
 
-        } else if (*p == '+') {
-            p += 1;
-        }
+	return true;
+}
 
-        // Get digits of exponent, if any.
+bool GetFileSize(const std::string& filename, uint64& size)
+{
+	struct stat fileInfo;
+	if(stat(filename.c_str(), &fileInfo) != 0)
+		return false;
 
-        expon = 0;
-        while (valid_digit(*p)) {
-            expon = expon * 10 + (*p - '0');
-            p += 1;
-        }
-        if (expon > 308) expon = 308;
+	size = fileInfo.st_size;
 
-        // Calculate scaling factor.
+	return true;
+}
 
-        while (expon >= 50) { scale *= 1E50; expon -= 50; }
-        while (expon >=  8) { scale *= 1E8;  expon -=  8; }
-        while (expon >   0) { scale *= 10.0; expon -=  1; }
-    }
+namespace
+{
+	/** Get '.<process id>.<number>', which differs for every call in every process. */
+	std::string UniqueSuffix()
+	{
+		static uint fileNum = 0;
+
+		std::stringstream suffix;
+#ifdef WIN32
+		suffix << "." << _getpid();
+#else
+		suffix << "." << getpid();
+#endif
+		suffix << "." << fileNum++;
+
+		return suffix.str();
+	}
+}
+
+std::string TempFilename(const std::string& suffix)
+{
+	const char* tempDir = getenv("TMPDIR");
+	if(tempDir == NULL)
+		tempDir = getenv("TEMP");
+	if(tempDir == NULL)
+		tempDir = getenv("TMP");
+
+	std::stringstream filename;
+#ifdef WIN32
+	filename << (tempDir != NULL ? tempDir : ".") << "\\NetworkDiversity";
+#else
+	filename << (tempDir != NULL ? tempDir : "/tmp") << "/NetworkDiversity";
+#endif
+	filename << UniqueSuffix() << suffix;
+
+	return filename.str();
+}
+
+std::string TempSiblingFilename(const std::string& filename)
+{
+	return filename + UniqueSuffix() + ".tmp";
+}
 
-    // Return signed and scaled doubleing point result.
-		return sign * (frac ? (value / scale) : (value * scale));
-}
\ No newline at end of file
+bool TruncateFile(const std::string& filename, uint64 size)
+{
+#ifdef WIN32
+	int fd;
+	if(_sopen_s(&fd, filename.c_str(), _O_RDWR | _O_BINARY, _SH_DENYNO, _S_IREAD | _S_IWRITE) != 0)
+		return false;
+
+	bool bOK = (_chsize_s(fd, size) == 0);
+	_close(fd);
+	return bOK;
+#else
+	return truncate(filename.c_str(), size) == 0;
+#endif
+}
+
+bool SyncFile(const std::string& filename)
+{
+#ifdef WIN32
+	int fd;
+	if(_sopen_s(&fd, filename.c_str(), _O_RDWR | _O_BINARY, _SH_DENYNO, _S_IREAD | _S_IWRITE) != 0)
+		return false;
+
+	bool bOK = (_commit(fd) == 0);
+	_close(fd);
+	return bOK;
+#else
+	int fd = open(filename.c_str(), O_RDWR);
+	if(fd == -1)
+		return false;
+
+	bool bOK = (fsync(fd) == 0);
+	close(fd);
+	return bOK;
+#endif
+}
@@ -25,10 +25,39 @@
 #include "Precompiled.hpp"
 
 #include "SplitSystem.hpp"
+#include "TextParser.hpp"
 
 #define white_space(c) ((c) == ' ' || (c) == '\t')
 #define valid_digit(c) ((c) >= '0' && (c) <= '9')
 
+/** Parse a decimal number at the start of a string, correctly rounded (see ParseDouble()). */
 double fast_atof(const char *p);
 
+/** Initial value for 64-bit FNV-1a hashes. */
+const uint64 HASH_SEED = 14695981039346656037ULL;
+
+/** Add bytes to a 64-bit FNV-1a hash. */
+uint64 HashBytes(const void* data, size_t len, uint64 hash = HASH_SEED);
+
+/** Add string to a 64-bit FNV-1a hash. */
+uint64 HashString(const std::string& str, uint64 hash = HASH_SEED);
+
+/** Add file size and modification time to a 64-bit FNV-1a hash. Returns false if file does not exist. */
+bool HashFileInfo(const std::string& filename, uint64& hash);
+
+/** Get size of file in bytes. Returns false if file does not exist. */
+bool GetFileSize(const std::string& filename, uint64& size);
+
+/** Get path to a new file in the temporary directory (given by TMPDIR, TEMP, or TMP). */
+std::string TempFilename(const std::string& suffix);
+
+/** Get path to a new file beside the given file, unique to this process, which can replace the file by renaming it. */
+std::string TempSiblingFilename(const std::string& filename);
+
+/** Truncate file to the specified size in bytes. */
+bool TruncateFile(const std::string& filename, uint64 size);
+
+/** Force data of file held by the operating system to disk (i.e., fsync). */
+bool SyncFile(const std::string& filename);
+
 #endif
\ No newline at end of file